@@ -1323,38 +1323,48 @@ static bool adjust_wants_for_reqs(struct ai_type *ait,
 }
 
 /**************************************************************************
-  Calculates city want from some input values.  Set pimprove to NULL when
-  nothing in the city has changed, and you just want to know the
-  base want of a city.
+  Add the output of the worked tiles and specialists of the city to prod.
+  If outputs is not NULL, only output types marked in it are calculated.
+  This mostly duplicates get_worked_tile_output() and
+  add_specialist_output().
 **************************************************************************/
-adv_want dai_city_want(struct player *pplayer, struct city *acity, 
-                       struct adv_data *adv, struct impr_type *pimprove)
+static void dai_city_worked_output(const struct city *acity, int *prod,
+                                   const bool *outputs)
 {
-  adv_want want = 0;
-  int prod[O_LAST], bonus[O_LAST], waste[O_LAST];
+  struct tile *acenter = city_tile(acity);
+  bool celebrating = base_city_celebrating(acity);
 
-  memset(prod, 0, O_LAST * sizeof(*prod));
-  if (NULL != pimprove
-   && adv->impr_calc[improvement_index(pimprove)] == ADV_IMPR_CALCULATE_FULL) {
-    struct tile *acenter = city_tile(acity);
-    bool celebrating = base_city_celebrating(acity);
-
-    /* The below calculation mostly duplicates get_worked_tile_output().
-     * We do this only for buildings that we know may change tile
-     * outputs. */
-    city_tile_iterate(city_map_radius_sq_get(acity), acenter, ptile) {
-      if (tile_worked(ptile) == acity) {
-        output_type_iterate(o) {
+  city_tile_iterate(city_map_radius_sq_get(acity), acenter, ptile) {
+    if (tile_worked(ptile) == acity) {
+      output_type_iterate(o) {
+        if (NULL == outputs || outputs[o]) {
           prod[o] += city_tile_output(acity, ptile, celebrating, o);
-        } output_type_iterate_end;
+        }
+      } output_type_iterate_end;
+    }
+  } city_tile_iterate_end;
+
+  specialist_type_iterate(sp) {
+    int count = acity->specialists[sp];
+
+    output_type_iterate(o) {
+      if (NULL == outputs || outputs[o]) {
+        prod[o] += count * get_specialist_output(acity, sp, o);
       }
-    } city_tile_iterate_end;
+    } output_type_iterate_end;
+  } specialist_type_iterate_end;
+}
 
-    add_specialist_output(acity, prod);
-  } else {
-    fc_assert(sizeof(*prod) == sizeof(*acity->citizen_base));
-    memcpy(prod, acity->citizen_base, O_LAST * sizeof(*prod));
-  }
+/**************************************************************************
+  Calculates city want from the base production of the city (output of
+  worked tiles and specialists). prod gets modified.
+**************************************************************************/
+static adv_want dai_city_want_from_prod(struct player *pplayer,
+                                        struct city *acity,
+                                        struct adv_data *adv, int *prod)
+{
+  adv_want want = 0;
+  int bonus[O_LAST], waste[O_LAST];
 
   trade_routes_iterate(acity, proute) {
     prod[O_TRADE] += proute->value;
@@ -1389,9 +1399,38 @@ adv_want dai_city_want(struct player *pplayer, struct city *acity,
   return want;
 }
 
+/**************************************************************************
+  Calculates city want from some input values.  Set pimprove to NULL when
+  nothing in the city has changed, and you just want to know the
+  base want of a city.
+**************************************************************************/
+adv_want dai_city_want(struct player *pplayer, struct city *acity, 
+                       struct adv_data *adv, struct impr_type *pimprove)
+{
+  int prod[O_LAST];
+
+  memset(prod, 0, O_LAST * sizeof(*prod));
+  if (NULL != pimprove
+   && adv->impr_calc[improvement_index(pimprove)] == ADV_IMPR_CALCULATE_FULL) {
+    /* We do this only for buildings that we know may change tile
+     * outputs. */
+    dai_city_worked_output(acity, prod, NULL);
+  } else {
+    fc_assert(sizeof(*prod) == sizeof(*acity->citizen_base));
+    memcpy(prod, acity->citizen_base, O_LAST * sizeof(*prod));
+  }
+
+  return dai_city_want_from_prod(pplayer, acity, adv, prod);
+}
+
 /**************************************************************************
   Calculates want for some buildings by actually adding the building and
   measuring the effect.
+
+  For buildings that may change tile outputs, only the output types the
+  building can affect are recalculated with the building in place. The
+  other ones are taken from citizen_base, which city_refresh() keeps up
+  to date whenever the effects active in the city change.
 **************************************************************************/
 static adv_want base_want(struct ai_type *ait, struct player *pplayer,
                           struct city *pcity, struct impr_type *pimprove)
@@ -1400,8 +1439,10 @@ static adv_want base_want(struct ai_type *ait, struct player *pplayer,
   adv_want final_want = 0;
   int wonder_player_id = WONDER_NOT_OWNED;
   int wonder_city_id = WONDER_NOT_BUILT;
+  const int impr_idx = improvement_index(pimprove);
+  bool full;
 
-  if (adv->impr_calc[improvement_index(pimprove)] == ADV_IMPR_ESTIMATE) {
+  if (adv->impr_calc[impr_idx] == ADV_IMPR_ESTIMATE) {
     return 0; /* Nothing to calculate here. */
   }
 
@@ -1411,20 +1452,34 @@ static adv_want base_want(struct ai_type *ait, struct player *pplayer,
     return 0;
   }
 
+  full = (adv->impr_calc[impr_idx] == ADV_IMPR_CALCULATE_FULL);
+
   if (is_wonder(pimprove)) {
     if (is_great_wonder(pimprove)) {
       wonder_player_id =
-          game.info.great_wonder_owners[improvement_index(pimprove)];
+          game.info.great_wonder_owners[impr_idx];
     }
-    wonder_city_id = pplayer->wonders[improvement_index(pimprove)];
+    wonder_city_id = pplayer->wonders[impr_idx];
   }
   /* Add the improvement */
   city_add_improvement(pcity, pimprove);
 
   /* Stir, then compare notes */
   city_range_iterate(pcity, pplayer->cities,
-                     adv->impr_range[improvement_index(pimprove)], acity) {
-    final_want += dai_city_want(pplayer, acity, adv, pimprove)
+                     adv->impr_range[impr_idx], acity) {
+    int prod[O_LAST];
+
+    if (full) {
+      output_type_iterate(o) {
+        prod[o] = adv->impr_tile_outputs[impr_idx][o]
+                  ? 0 : acity->citizen_base[o];
+      } output_type_iterate_end;
+      dai_city_worked_output(acity, prod, adv->impr_tile_outputs[impr_idx]);
+    } else {
+      memcpy(prod, acity->citizen_base, O_LAST * sizeof(*prod));
+    }
+
+    final_want += dai_city_want_from_prod(pplayer, acity, adv, prod)
       - def_ai_city_data(acity, ait)->worth;
   } city_range_iterate_end;
 
@@ -1432,11 +1487,11 @@ static adv_want base_want(struct ai_type *ait, struct player *pplayer,
   city_remove_improvement(pcity, pimprove);
   if (is_wonder(pimprove)) {
     if (is_great_wonder(pimprove)) {
-      game.info.great_wonder_owners[improvement_index(pimprove)] =
+      game.info.great_wonder_owners[impr_idx] =
           wonder_player_id;
     }
 
-    pplayer->wonders[improvement_index(pimprove)] = wonder_city_id;
+    pplayer->wonders[impr_idx] = wonder_city_id;
   }
 
   return final_want;
@@ -1821,6 +1876,8 @@ void dai_build_adv_init(struct ai_type *ait, struct player *pplayer)
 void dai_build_adv_adjust(struct ai_type *ait, struct player *pplayer,
                           struct city *wonder_city)
 {
+  TIMING_LOG(AIT_BUILDING_WANTS, TIMER_START);
+
   /* Clear old building wants.
    * Do this separately from the iteration over improvement types
    * because each iteration could actually update more than one improvement,
@@ -1914,6 +1971,8 @@ void dai_build_adv_adjust(struct ai_type *ait, struct player *pplayer,
         + city_data->building_wait;
     }
   } city_list_iterate_end;
+
+  TIMING_LOG(AIT_BUILDING_WANTS, TIMER_STOP);
 }
 
 /************************************************************************** 
@@ -22,9 +22,13 @@
 #include "multipliers.h"
 #include "research.h"
 
+/* common/aicore */
+#include "path_finding.h"
+
 /* server */
 #include "cityturn.h"
 #include "plrhand.h"
+#include "srv_log.h"
 
 /* server/advisors */
 #include "advdata.h"
@@ -91,6 +95,10 @@ void dai_data_init(struct ai_type *ait, struct player *pplayer)
 
   ai->settler = NULL;
 
+  ai->budget.used = 0;
+  ai->budget.running = FALSE;
+  ai->budget.turn = -1;
+
   /* Initialise autosettler. */
   dai_auto_settler_init(ai);
 }
@@ -109,6 +117,8 @@ void dai_data_close(struct ai_type *ait, struct player *pplayer)
   /* Free autosettler. */
   dai_auto_settler_free(ai);
 
+  aiferry_transport_free();
+
   if (ai->diplomacy.player_intel_slots != NULL) {
     players_iterate(aplayer) {
       /* destroy the ai diplomacy states of this player with others ... */
@@ -122,6 +132,60 @@ void dai_data_close(struct ai_type *ait, struct player *pplayer)
   }
 }
 
+/**************************************************************************
+  Start counting path-finding work done by the AI for this player. The
+  count is reset when a new turn begins.
+**************************************************************************/
+void dai_budget_start(struct ai_type *ait, struct player *pplayer)
+{
+  struct ai_plr *ai = def_ai_player_data(pplayer, ait);
+
+  if (ai->budget.turn != game.info.turn) {
+    ai->budget.used = 0;
+    ai->budget.turn = game.info.turn;
+  }
+  ai->budget.started = pf_map_iterations();
+  ai->budget.running = TRUE;
+}
+
+/**************************************************************************
+  Stop counting path-finding work done by the AI for this player.
+**************************************************************************/
+void dai_budget_stop(struct ai_type *ait, struct player *pplayer)
+{
+  struct ai_plr *ai = def_ai_player_data(pplayer, ait);
+
+  if (ai->budget.running) {
+    ai->budget.used += pf_map_iterations() - ai->budget.started;
+    ai->budget.running = FALSE;
+  }
+}
+
+/**************************************************************************
+  Return whether the AI has already used up its path-finding budget for
+  this turn ('aipfbudget' server setting), in which case optional
+  expensive searches should be skipped or shortened. The budget counts
+  path-finding positions rather than time, so that the same game plays
+  out the same way on any machine.
+**************************************************************************/
+bool dai_budget_exceeded(struct ai_type *ait, struct player *pplayer)
+{
+  struct ai_plr *ai = def_ai_player_data(pplayer, ait);
+  unsigned int used;
+
+  if (game.server.ai_pf_budget <= 0
+      || ai->budget.turn != game.info.turn) {
+    return FALSE;
+  }
+
+  used = ai->budget.used;
+  if (ai->budget.running) {
+    used += pf_map_iterations() - ai->budget.started;
+  }
+
+  return used / 1000 >= (unsigned int) game.server.ai_pf_budget;
+}
+
 /**************************************************************************
   Return whether data phase is currently open. Data phase is open
   between dai_data_phase_begin() and dai_data_phase_finished() calls.
@@ -164,7 +228,9 @@ void dai_data_phase_begin(struct ai_type *ait, struct player *pplayer,
 
   /*** Diplomacy ***/
   if (is_ai(pplayer) && !is_barbarian(pplayer) && is_new_phase) {
+    TIMING_LOG(AIT_DIPLOMACY, TIMER_START);
     dai_diplomacy_begin_new_phase(ait, pplayer);
+    TIMING_LOG(AIT_DIPLOMACY, TIMER_STOP);
   }
 
   /* Set per-player variables. We must set all players, since players
@@ -19,6 +19,7 @@
 /* common */
 #include "fc_types.h"
 #include "tech.h"
+#include "unittype.h"
 
 /* server/advisors */
 #include "advtools.h"
@@ -100,6 +101,15 @@ struct ai_plr
   /* Cache map for AI settlers; defined in aisettler.c. */
   struct ai_settler *settler;
 
+  /* Path-finding positions iterated by this player during the current
+   * turn, compared against the 'aipfbudget' server setting. */
+  struct {
+    unsigned int used;
+    unsigned int started; /* pf_map_iterations() when counting started */
+    bool running;
+    int turn;
+  } budget;
+
   /* The units of tech_want seem to be shields */
   adv_want tech_want[A_LAST+1];
 };
@@ -112,6 +122,10 @@ void dai_data_phase_begin(struct ai_type *ait, struct player *pplayer,
 void dai_data_phase_finished(struct ai_type *ait, struct player *pplayer);
 bool is_ai_data_phase_open(struct ai_type *ait, struct player *pplayer);
 
+void dai_budget_start(struct ai_type *ait, struct player *pplayer);
+void dai_budget_stop(struct ai_type *ait, struct player *pplayer);
+bool dai_budget_exceeded(struct ai_type *ait, struct player *pplayer);
+
 struct ai_plr *dai_plr_data_get(struct ai_type *ait, struct player *pplayer,
                                 bool *caller_closes);
 
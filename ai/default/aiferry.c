@@ -17,6 +17,7 @@
 
 /* utility */
 #include "log.h"
+#include "mem.h"
 
 /* common */
 #include "game.h"
@@ -86,6 +87,15 @@
 #define LOGLEVEL_FERRY_STATS LOG_NORMAL
 #endif
 
+/* Which oceans touch which continents, so that the ferry code can rule
+ * out boats no passenger path could reach. It depends only on the map,
+ * so it is shared by all AI players; see aiferry_transport_graph(). */
+static struct {
+  bool *touches;    /* [continent * (oceans + 1) + ocean] */
+  bv_unit_classes ocean_native; /* classes able to walk on some ocean */
+  int generation;   /* wld.map.continent_generation when built */
+  int turn;
+} transport;
 
 /* ========= managing statistics and boat/passanger assignments ======== */
 
@@ -478,6 +488,117 @@ bool is_boss_of_boat(struct ai_type *ait, struct unit *punit)
   return FALSE;
 }
 
+/****************************************************************************
+  Free the continent/ocean transport graph.
+****************************************************************************/
+void aiferry_transport_free(void)
+{
+  if (transport.touches != NULL) {
+    free(transport.touches);
+    transport.touches = NULL;
+  }
+  transport.turn = -1;
+}
+
+/****************************************************************************
+  Return the continent/ocean transport graph, rebuilding it once per turn
+  or when the continents have been renumbered since. Entry
+  [continent * (oceans + 1) + ocean] tells whether a land unit on the
+  continent can step onto the ocean. Unit classes that can move on some
+  ocean tile of the map are marked in transport.ocean_native.
+****************************************************************************/
+static const bool *aiferry_transport_graph(void)
+{
+  int oceans;
+
+  if (transport.touches != NULL
+      && transport.turn == game.info.turn
+      && transport.generation == wld.map.continent_generation) {
+    return transport.touches;
+  }
+
+  aiferry_transport_free();
+  oceans = wld.map.num_oceans;
+  transport.generation = wld.map.continent_generation;
+  transport.turn = game.info.turn;
+  transport.touches
+    = fc_calloc((wld.map.num_continents + 1) * (oceans + 1),
+                sizeof(*transport.touches));
+  BV_CLR_ALL(transport.ocean_native);
+
+  whole_map_iterate(&(wld.map), ptile) {
+    Continent_id cont = tile_continent(ptile);
+
+    if (cont <= 0) {
+      if (is_ocean_tile(ptile)) {
+        unit_class_iterate(pclass) {
+          if (tile_city(ptile) != NULL
+              || is_native_tile_to_class(pclass, ptile)) {
+            BV_SET(transport.ocean_native, uclass_index(pclass));
+          }
+        } unit_class_iterate_end;
+      }
+      continue;
+    }
+    adjc_iterate(ptile, adjc_tile) {
+      Continent_id ocean = -tile_continent(adjc_tile);
+
+      if (ocean > 0 && ocean <= oceans) {
+        transport.touches[cont * (oceans + 1) + ocean] = TRUE;
+      }
+    } adjc_iterate_end;
+  } whole_map_iterate_end;
+
+  return transport.touches;
+}
+
+/****************************************************************************
+  Check whether any boat able to carry punit could be met by a passenger
+  starting from its current tile. A passenger on land that can walk on
+  all land and on no ocean never leaves its continent except by stepping
+  onto an ocean touching it, so boats elsewhere cannot be found by
+  aiferry_find_boat() anyway. Other passengers are not checked.
+****************************************************************************/
+static bool aiferry_boat_in_reach(struct ai_type *ait, struct unit *punit,
+                                  int cap)
+{
+  struct player *pplayer = unit_owner(punit);
+  struct unit_class *pclass = unit_class_get(punit);
+  Continent_id cont = tile_continent(unit_tile(punit));
+  const bool *touches = NULL;
+  int oceans = wld.map.num_oceans;
+
+  if (cont > 0 && cont <= wld.map.num_continents
+      && pclass->adv.land_move == MOVE_FULL
+      && pclass->adv.sea_move == MOVE_NONE) {
+    const bool *graph = aiferry_transport_graph();
+
+    if (!BV_ISSET(transport.ocean_native, uclass_index(pclass))) {
+      touches = graph + cont * (oceans + 1);
+    }
+  }
+
+  unit_list_iterate(pplayer->units, aunit) {
+    struct tile *btile = unit_tile(aunit);
+
+    if (!is_boat_free(ait, aunit, punit, cap)) {
+      continue;
+    }
+    if (touches == NULL || tile_continent(btile) == cont) {
+      return TRUE;
+    }
+    square_iterate(btile, 1, ptile) {
+      Continent_id ocean = -tile_continent(ptile);
+
+      if (ocean > 0 && ocean <= oceans && touches[ocean]) {
+        return TRUE;
+      }
+    } square_iterate_end;
+  } unit_list_iterate_end;
+
+  return FALSE;
+}
+
 /****************************************************************************
   Proper and real PF function for finding a boat.  If you don't require
   the path to the ferry, pass path=NULL.
@@ -518,6 +639,12 @@ int aiferry_find_boat(struct ai_type *ait, struct unit *punit,
     return 0;
   }
 
+  if (!aiferry_boat_in_reach(ait, punit, cap)) {
+    /* Spare the search of the whole continent and its seas. */
+    UNIT_LOG(LOGLEVEL_FINDFERRY, punit, "no free boat within reach");
+    return 0;
+  }
+
   pft_fill_unit_parameter(&param, punit);
   param.omniscience = !has_handicap(pplayer, H_MAP);
   param.get_TB = no_fights_or_unknown;
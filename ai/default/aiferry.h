@@ -17,6 +17,7 @@
 
 #include "fc_types.h"
 
+struct ai_plr;
 struct pf_path;
 struct pft_amphibious;
 
@@ -28,6 +29,11 @@ bool dai_is_ferry(struct unit *pferry, struct ai_type *ait);
  */
 void aiferry_init_stats(struct ai_type *ait, struct player *pplayer);
 
+/*
+ * Free the continent/ocean transport graph.
+ */
+void aiferry_transport_free(void);
+
 /* 
  * Find the nearest boat.  Can be called from inside the continents too 
  */
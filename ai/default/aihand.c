@@ -735,6 +735,7 @@ static void dai_manage_government(struct ai_type *ait, struct player *pplayer)
 **************************************************************************/
 void dai_do_first_activities(struct ai_type *ait, struct player *pplayer)
 {
+  dai_budget_start(ait, pplayer);
   TIMING_LOG(AIT_ALL, TIMER_START);
   dai_assess_danger_player(ait, pplayer);
   /* TODO: Make assess_danger save information on what is threatening
@@ -747,6 +748,7 @@ void dai_do_first_activities(struct ai_type *ait, struct player *pplayer)
   /* STOP.  Everything else is at end of turn. */
 
   TIMING_LOG(AIT_ALL, TIMER_STOP);
+  dai_budget_stop(ait, pplayer);
 
   flush_packets(); /* AIs can be such spammers... */
 }
@@ -761,6 +763,7 @@ void dai_do_first_activities(struct ai_type *ait, struct player *pplayer)
 **************************************************************************/
 void dai_do_last_activities(struct ai_type *ait, struct player *pplayer)
 {
+  dai_budget_start(ait, pplayer);
   TIMING_LOG(AIT_ALL, TIMER_START);
   dai_clear_tech_wants(ait, pplayer);
 
@@ -778,4 +781,5 @@ void dai_do_last_activities(struct ai_type *ait, struct player *pplayer)
   dai_manage_spaceship(pplayer);
 
   TIMING_LOG(AIT_ALL, TIMER_STOP);
+  dai_budget_stop(ait, pplayer);
 }
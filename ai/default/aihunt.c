@@ -48,6 +48,7 @@
 
 /* ai/default */
 #include "aicity.h"
+#include "aidata.h"
 #include "ailog.h"
 #include "aiplayer.h"
 #include "aitools.h"
@@ -431,6 +432,11 @@ int dai_hunter_manage(struct ai_type *ait, struct player *pplayer,
   fc_assert_ret_val(!is_barbarian(pplayer), 0);
   fc_assert_ret_val(pplayer->is_alive, 0);
 
+  if (dai_budget_exceeded(ait, pplayer)) {
+    /* Over the path-finding budget for this turn; look only nearby. */
+    limit /= 2;
+  }
+
   pft_fill_unit_parameter(&parameter, punit);
   parameter.omniscience = !has_handicap(pplayer, H_MAP);
   pfm = pf_map_new(&parameter);
@@ -116,6 +116,11 @@
  * This is % of defense % to increase want by. */
 #define DEFENSE_EMPHASIS 20
 
+/* How many turns away city placements are still considered once the
+ * AI player is over its path-finding budget ('aipfbudget') for the
+ * turn. */
+#define SETTLER_BUDGET_TURNS 4
+
 struct tile_data_cache {
   char food;    /* food output of the tile */
   char trade;   /* trade output of the tile */
@@ -784,10 +789,16 @@ static struct cityresult *settler_map_iterate(struct ai_type *ait,
   int best_turn = 0; /* Which turn we found the best fit */
   struct player *pplayer = unit_owner(punit);
   struct pf_map *pfm;
+  bool over_budget = dai_budget_exceeded(ait, pplayer);
 
   pfm = pf_map_new(parameter);
   pf_map_move_costs_iterate(pfm, ptile, move_cost, FALSE) {
-    int turns;
+    int turns = move_cost / parameter->move_rate;
+
+    if (over_budget && turns > SETTLER_BUDGET_TURNS) {
+      /* Over the path-finding budget for this turn; look only nearby. */
+      break;
+    }
 
     if (boat_cost == 0 && unit_class_get(punit)->adv.sea_move == MOVE_NONE
         && tile_continent(ptile) != tile_continent(unit_tile(punit))) {
@@ -814,7 +825,6 @@ static struct cityresult *settler_map_iterate(struct ai_type *ait,
     }
 
     /* This algorithm punishes long treks */
-    turns = move_cost / parameter->move_rate;
     cr->result = amortize(cr->total, PERFECTION * turns);
 
     /* Reduce want by settler cost. Easier than amortize, but still
@@ -903,6 +913,12 @@ static struct cityresult *find_best_city_placement(struct ai_type *ait,
 
   /* Phase 2: Consider travelling to another continent */
 
+  if (dai_budget_exceeded(ait, pplayer)) {
+    /* Boat searches are expensive; skip them when over the path-finding
+     * budget for this turn. */
+    return cr1;
+  }
+
   if (look_for_boat) {
     int ferry_id = aiferry_find_boat(ait, punit, 1, NULL);
 
@@ -1115,6 +1115,7 @@ int find_something_to_kill(struct ai_type *ait, struct player *pplayer,
   bool handicap = has_handicap(pplayer, H_TARGETS);
   bool unhap = FALSE;   /* Do we make unhappy citizen. */
   bool harbor = FALSE;  /* Do we have access to sea? */
+  bool over_budget;     /* Out of AI path finding for this turn? */
   bool go_by_boat;      /* Whether we need a boat or not. */
   int vulnerability;    /* Enemy defence rating. */
   int benefit;          /* Benefit from killing the target. */
@@ -1254,13 +1255,18 @@ int find_something_to_kill(struct ai_type *ait, struct player *pplayer,
       ferryboat = NULL;
     }
 
-    if (NULL == ferryboat) {
+    /* Looking for a boat, or simulating one, is expensive. Skip it when
+     * over the path-finding budget for this turn. */
+    over_budget = dai_budget_exceeded(ait, pplayer);
+
+    if (NULL == ferryboat && !over_budget) {
       /* Try to find new boat */
       ferryboat = player_unit_by_number(pplayer,
                                         aiferry_find_boat(ait, punit, 1, NULL));
     }
 
-    if (0 == punit->id && is_terrain_class_near_tile(punit_tile, TC_OCEAN)) {
+    if (0 == punit->id && !over_budget
+        && is_terrain_class_near_tile(punit_tile, TC_OCEAN)) {
       harbor = TRUE;
     }
   }
@@ -88,6 +88,7 @@ static void dai_incident_nuclear_self(struct player *violator,
 				      struct player *victim);
 static void dai_incident_pillage(struct player *violator, struct player *victim);
 static void clear_old_treaty(struct player *pplayer, struct player *aplayer);
+static void diplomacy_actions(struct ai_type *ait, struct player *pplayer);
 
 /**********************************************************************
   Send a diplomatic message. Use this instead of notify directly
@@ -1491,6 +1492,16 @@ void static war_countdown(struct ai_type *ait, struct player *pplayer,
   Only ever called for AI players.
 ***********************************************************************/
 void dai_diplomacy_actions(struct ai_type *ait, struct player *pplayer)
+{
+  TIMING_LOG(AIT_DIPLOMACY, TIMER_START);
+  diplomacy_actions(ait, pplayer);
+  TIMING_LOG(AIT_DIPLOMACY, TIMER_STOP);
+}
+
+/********************************************************************** 
+  Do the actual diplomatic actions for dai_diplomacy_actions().
+***********************************************************************/
+static void diplomacy_actions(struct ai_type *ait, struct player *pplayer)
 {
   struct ai_plr *ai = dai_plr_data_get(ait, pplayer, NULL);
   bool need_targets = TRUE;
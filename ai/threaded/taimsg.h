@@ -45,10 +45,12 @@ struct tai_req
 
 #define SPECLIST_TAG taimsg
 #define SPECLIST_TYPE struct tai_msg
+#define SPECLIST_MUTEXED
 #include "speclist.h"
 
 #define SPECLIST_TAG taireq
 #define SPECLIST_TYPE struct tai_req
+#define SPECLIST_MUTEXED
 #include "speclist.h"
 
 void tai_send_msg(enum taimsgtype type, struct player *pplayer,
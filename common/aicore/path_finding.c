@@ -96,6 +96,9 @@ struct pf_map {
 /* Down-cast macro. */
 #define PF_MAP(pfm) ((struct pf_map *) (pfm))
 
+/* Number of positions iterated by all maps, see pf_map_iterations(). */
+static unsigned int pf_iterations = 0;
+
 /* ========================== Common functions =========================== */
 
 /****************************************************************************
@@ -3250,9 +3253,23 @@ bool pf_map_iterate(struct pf_map *pfm)
     return FALSE;
   }
 
+  pf_iterations++;
+
   return TRUE;
 }
 
+/****************************************************************************
+  Return the number of positions iterated by all path-finding maps so
+  far, including the iterations done by pf_map_move_cost(), pf_map_path()
+  and pf_map_position(). This is a deterministic measure of the work done
+  by path finding. The counter wraps around, so only differences between
+  two values are meaningful.
+****************************************************************************/
+unsigned int pf_map_iterations(void)
+{
+  return pf_iterations;
+}
+
 /****************************************************************************
   Return the current tile.
 ****************************************************************************/
@@ -493,6 +493,7 @@ void pf_map_iter_position(struct pf_map *pfm, struct pf_position *pos);
 
 /* Other related functions. */
 const struct pf_parameter *pf_map_parameter(const struct pf_map *pfm);
+unsigned int pf_map_iterations(void);
 
 
 /* Paths functions. */
@@ -65,6 +65,14 @@ static int city_map_xy[CITY_MAP_MAX_SIZE][CITY_MAP_MAX_SIZE];
 /* number of tiles of a city; depends on the squared city radius */
 static int city_map_numtiles[CITY_MAP_MAX_RADIUS_SQ + 1];
 
+/* Tile index deltas from the city center to the tiles of city_map_index,
+ * for city centers with even and odd native y which are away from the
+ * map edges; see city_map_tile_deltas(). */
+static int city_map_deltas[2][CITY_MAP_MAX_SIZE * CITY_MAP_MAX_SIZE];
+/* Greatest real distance of a city tile; depends on the squared city
+ * radius. */
+static int city_map_real_radius[CITY_MAP_MAX_RADIUS_SQ + 1];
+
 /* definitions and functions for the tile_cache */
 struct tile_cache {
   int output[O_LAST];
@@ -301,6 +309,43 @@ struct tile *city_map_to_tile(const struct tile *city_center,
   return map_pos_to_tile(tile_x, tile_y);
 }
 
+/**************************************************************************
+  Finds the map position of the city tile with the given index, like
+  city_map_to_tile() does for city map coordinates. Returns NULL if the
+  position is not real.
+**************************************************************************/
+struct tile *city_map_index_to_tile(const struct tile *city_center,
+                                    int city_tile_index)
+{
+  int tile_x, tile_y;
+
+  index_to_map_pos(&tile_x, &tile_y, tile_index(city_center));
+  tile_x += city_map_index[city_tile_index].dx;
+  tile_y += city_map_index[city_tile_index].dy;
+
+  return map_pos_to_tile(tile_x, tile_y);
+}
+
+/**************************************************************************
+  Returns the tile index deltas from the city center to the city tiles,
+  in city tile index order, or NULL if the city center is too near the
+  map edges for them (or the radius is invalid). Used by the city tile
+  iterators.
+**************************************************************************/
+const int *city_map_tile_deltas(const struct tile *city_center,
+                                int city_radius_sq)
+{
+  if (city_radius_sq < CITY_MAP_MIN_RADIUS_SQ
+      || city_radius_sq > CITY_MAP_MAX_RADIUS_SQ
+      || is_border_tile(city_center,
+                        city_map_real_radius[city_radius_sq])) {
+    return NULL;
+  }
+
+  return city_map_deltas[index_to_native_pos_y(tile_index(city_center))
+                         & 1];
+}
+
 /**************************************************************************
   Compare two integer values, as required by qsort.
 ***************************************************************************/
@@ -562,6 +607,25 @@ void generate_city_map_indices(void)
     city_map_xy[city_x][city_y] = i;
   }
 
+  /* set the static variables for city_map_tile_deltas() */
+  for (i = 0; i <= CITY_MAP_MAX_RADIUS_SQ; i++) {
+    city_map_real_radius[i] = 0;
+  }
+  for (i = 0; i < city_count_tiles; i++) {
+    int radius_sq;
+
+    dx = city_map_index[i].dx;
+    dy = city_map_index[i].dy;
+    dist = map_vector_to_real_distance(dx, dy);
+    for (radius_sq = MAX(city_map_index[i].dist, 0);
+         radius_sq <= CITY_MAP_MAX_RADIUS_SQ; radius_sq++) {
+      city_map_real_radius[radius_sq] =
+          MAX(city_map_real_radius[radius_sq], dist);
+    }
+    city_map_deltas[0][i] = map_vector_to_index_delta(dx, dy, FALSE);
+    city_map_deltas[1][i] = map_vector_to_index_delta(dx, dy, TRUE);
+  }
+
 #ifdef FREECIV_DEBUG
   citylog_map_radius_sq(LOG_DEBUG);
   citylog_map_index(LOG_DEBUG);
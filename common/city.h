@@ -185,26 +185,42 @@ void citylog_map_workers(enum log_level level, struct city *pcity);
  * _radius_sq is the squared city radius.
  * _city_tile is the center of the (possible) city.
  * (_index) will be the city tile index in the intervall
- * [0, city_map_tiles(_radius_sq)] */
+ * [0, city_map_tiles(_radius_sq)]
+ * For cities away from the map edges the tiles are found by adding the
+ * deltas of city_map_tile_deltas() to the index of the center tile. */
 #define city_tile_iterate_index(_radius_sq, _city_tile, _tile,		\
                                 _index) {				\
-  city_map_iterate_outwards_radius_sq_index(CITY_MAP_CENTER_RADIUS_SQ,	\
-                                            _radius_sq, _index, _x, _y)	\
-  struct tile *_tile = city_map_to_tile(_city_tile, _radius_sq,         \
-                                        _x, _y);			\
-  if (NULL != _tile) {
+  const struct tile *_tile##_center = (_city_tile);			\
+  const int _tile##_city_rsq = (_radius_sq);				\
+  const int *_tile##_deltas = city_map_tile_deltas(_tile##_center,	\
+                                                   _tile##_city_rsq);	\
+  const int _tile##_count = city_map_tiles(_tile##_city_rsq);		\
+  int _index;								\
+  for (_index = 0; _index < _tile##_count; _index++) {			\
+    struct tile *_tile = (NULL != _tile##_deltas			\
+                          ? wld.map.tiles + tile_index(_tile##_center)	\
+                            + _tile##_deltas[_index]			\
+                          : city_map_index_to_tile(_tile##_center,	\
+                                                   _index));		\
+    if (NULL != _tile) {
 
 #define city_tile_iterate_index_end					\
     }									\
-  } city_map_iterate_outwards_radius_sq_index_end;
+  }									\
+}
 
 /* simple extension to skip is_free_worked() tiles. */
 #define city_tile_iterate_skip_free_worked(_radius_sq, _city_tile,	\
                                            _tile, _index, _x, _y) {	\
+  const int *_tile##_deltas = city_map_tile_deltas(_city_tile,		\
+                                                   _radius_sq);		\
   city_map_iterate(_radius_sq, _index, _x, _y) {			\
     if (!is_free_worked_index(_index)) {				\
-      struct tile *_tile = city_map_to_tile(_city_tile, _radius_sq,	\
-                                            _x, _y);			\
+      struct tile *_tile = (NULL != _tile##_deltas			\
+                            ? wld.map.tiles + tile_index(_city_tile)	\
+                              + _tile##_deltas[_index]			\
+                            : city_map_to_tile(_city_tile, _radius_sq,	\
+                                               _x, _y));		\
       if (NULL != _tile) {
 
 #define city_tile_iterate_skip_free_worked_end				\
@@ -215,16 +231,11 @@ void citylog_map_workers(enum log_level level, struct city *pcity);
 
 /* Does the same thing as city_tile_iterate_index, but keeps the city
  * coordinates hidden. */
-#define city_tile_iterate(_radius_sq, _city_tile, _tile) {              \
-  city_map_iterate_outwards_radius_sq(CITY_MAP_CENTER_RADIUS_SQ,	\
-                                      _radius_sq, _x, _y)	        \
-  struct tile *_tile = city_map_to_tile(_city_tile, _radius_sq,         \
-                                        _x, _y);			\
-  if (NULL != _tile) {
-
-#define city_tile_iterate_end					        \
-    }									\
-  } city_map_iterate_outwards_radius_sq_end;
+#define city_tile_iterate(_radius_sq, _city_tile, _tile)		\
+  city_tile_iterate_index(_radius_sq, _city_tile, _tile, _tile##_index)
+
+#define city_tile_iterate_end						\
+  city_tile_iterate_index_end
 
 /* Improvement status (for cities' lists of improvements)
  * (replaced Impr_Status) */
@@ -622,6 +633,10 @@ bool city_tile_to_city_map(int *city_map_x, int *city_map_y,
 struct tile *city_map_to_tile(const struct tile *city_center,
                               int city_radius_sq, int city_map_x,
                               int city_map_y);
+struct tile *city_map_index_to_tile(const struct tile *city_center,
+                                    int city_tile_index);
+const int *city_map_tile_deltas(const struct tile *city_center,
+                                int city_radius_sq);
 
 /* Initialization functions */
 int compare_iter_index(const void *a, const void *b);
@@ -16,9 +16,11 @@
 #endif
 
 #include <math.h>
+#include <string.h>
 
 /* utility */
 #include "bitvector.h"
+#include "fcthread.h"
 #include "rand.h"
 #include "log.h"
 
@@ -34,6 +36,28 @@
 
 #include "combat.h"
 
+/* Cache of win_chance() results. The chance only depends on the
+ * strengths and on the number of rounds each side survives, and the
+ * same combinations come up again and again (every unit of a stack
+ * is checked for every attacker considered), so those are used as
+ * the key. The cache is shared between threads. */
+#define WIN_CHANCE_CACHE_SIZE 4096 /* must be a power of two */
+
+struct win_chance_cache_entry {
+  int as, ds;
+  int att_N_lose, def_N_lose;
+  double chance;
+  bool valid;
+};
+
+static struct {
+  bool initialized;
+  fc_mutex mutex;
+  struct win_chance_cache_entry entries[WIN_CHANCE_CACHE_SIZE];
+} win_chance_cache = { .initialized = FALSE };
+
+static double win_chance_calc(int as, int att_N_lose, int ds, int def_N_lose);
+
 /***********************************************************************
   Checks if player is restricted diplomatically from attacking the tile.
   Returns FLASE if
@@ -226,6 +250,45 @@ bool can_unit_attack_tile(const struct unit *punit,
           && unit_attack_units_at_tile_result(punit, dest_tile) == ATT_OK);
 }
 
+/***********************************************************************
+  Initialize the win_chance() cache.
+***********************************************************************/
+void combat_cache_init(void)
+{
+  if (!win_chance_cache.initialized) {
+    fc_init_mutex(&win_chance_cache.mutex);
+    win_chance_cache.initialized = TRUE;
+  }
+  memset(win_chance_cache.entries, 0, sizeof(win_chance_cache.entries));
+}
+
+/***********************************************************************
+  Free the win_chance() cache.
+***********************************************************************/
+void combat_cache_free(void)
+{
+  if (win_chance_cache.initialized) {
+    fc_destroy_mutex(&win_chance_cache.mutex);
+    win_chance_cache.initialized = FALSE;
+  }
+}
+
+/***********************************************************************
+  Slot of the win_chance() cache for the given key.
+***********************************************************************/
+static inline int win_chance_cache_slot(int as, int ds,
+                                        int att_N_lose, int def_N_lose)
+{
+  unsigned int hash = (unsigned int) as;
+
+  hash = hash * 31 + (unsigned int) ds;
+  hash = hash * 31 + (unsigned int) att_N_lose;
+  hash = hash * 31 + (unsigned int) def_N_lose;
+  hash ^= hash >> 13;
+
+  return hash & (WIN_CHANCE_CACHE_SIZE - 1);
+}
+
 /***********************************************************************
 Returns the chance of the attacker winning, a number between 0 and 1.
 If you want the chance that the defender wins just use 1-chance(...)
@@ -243,6 +306,52 @@ double win_chance(int as, int ahp, int afp, int ds, int dhp, int dfp)
   /* number of rounds a unit can fight without dying */
   int att_N_lose = (ahp + dfp - 1) / dfp;
   int def_N_lose = (dhp + afp - 1) / afp;
+  struct win_chance_cache_entry *pentry = NULL;
+  double chance;
+
+  if (win_chance_cache.initialized) {
+    bool found;
+
+    pentry = &win_chance_cache.entries[win_chance_cache_slot(as, ds,
+                                                             att_N_lose,
+                                                             def_N_lose)];
+    fc_allocate_mutex(&win_chance_cache.mutex);
+    found = (pentry->valid
+             && pentry->as == as && pentry->ds == ds
+             && pentry->att_N_lose == att_N_lose
+             && pentry->def_N_lose == def_N_lose);
+    if (found) {
+      chance = pentry->chance;
+    }
+    fc_release_mutex(&win_chance_cache.mutex);
+
+    if (found) {
+      return chance;
+    }
+  }
+
+  chance = win_chance_calc(as, att_N_lose, ds, def_N_lose);
+
+  if (NULL != pentry) {
+    fc_allocate_mutex(&win_chance_cache.mutex);
+    pentry->as = as;
+    pentry->ds = ds;
+    pentry->att_N_lose = att_N_lose;
+    pentry->def_N_lose = def_N_lose;
+    pentry->chance = chance;
+    pentry->valid = TRUE;
+    fc_release_mutex(&win_chance_cache.mutex);
+  }
+
+  return chance;
+}
+
+/***********************************************************************
+  The actual calculation behind win_chance(), given the number of rounds
+  each side can lose.
+***********************************************************************/
+static double win_chance_calc(int as, int att_N_lose, int ds, int def_N_lose)
+{
   /* Probability of losing one round */
   double att_P_lose1 = (as + ds == 0) ? 0.5 : (double) ds / (as + ds);
   double def_P_lose1 = 1 - att_P_lose1;
@@ -631,13 +740,10 @@ A number indicating the defense strength.
 Unlike the one got from win chance this doesn't potentially get insanely
 small if the units are unevenly matched, unlike win_chance.
 **************************************************************************/
-static int get_defense_rating(const struct unit *attacker,
-			      const struct unit *defender)
+static int get_defense_rating(const struct unit *defender, int def_power,
+                              int afp, int dfp)
 {
-  int afp, dfp;
-
-  int rating = get_total_defense_power(attacker, defender);
-  get_modified_firepower(attacker, defender, &afp, &dfp);
+  int rating = def_power;
 
   /* How many rounds the defender will last */
   rating *= (defender->hp + afp-1)/afp;
@@ -657,6 +763,8 @@ struct unit *get_defender(const struct unit *attacker,
 {
   struct unit *bestdef = NULL;
   int bestvalue = -99, best_cost = 0, rating_of_best = 0;
+  /* The attack power only depends on the attacker and the tile. */
+  int att_power = -1;
 
   /* Simply call win_chance with all the possible defenders in turn, and
    * take the best one.  It currently uses build cost as a tiebreaker in
@@ -674,10 +782,21 @@ struct unit *get_defender(const struct unit *attacker,
         && unit_attack_unit_at_tile_result(attacker, defender, ptile) == ATT_OK) {
       bool change = FALSE;
       int build_cost = unit_build_shield_cost(defender);
-      int defense_rating = get_defense_rating(attacker, defender);
+      int def_power = get_total_defense_power(attacker, defender);
+      int att_fp, def_fp;
+      int defense_rating;
+      int unit_def;
+
+      if (att_power < 0) {
+        att_power = get_total_attack_power(attacker, defender);
+      }
+      get_modified_firepower(attacker, defender, &att_fp, &def_fp);
+      defense_rating = get_defense_rating(defender, def_power,
+                                          att_fp, def_fp);
       /* This will make units roughly evenly good defenders look alike. */
-      int unit_def 
-        = (int) (100000 * (1 - unit_win_chance(attacker, defender)));
+      unit_def = (int) (100000 * (1 - win_chance(att_power, attacker->hp,
+                                                 att_fp, def_power,
+                                                 defender->hp, def_fp)));
 
       fc_assert_action(0 <= unit_def, continue);
 
@@ -49,6 +49,9 @@ enum unit_attack_result unit_attack_units_at_tile_result(const struct unit *puni
 bool can_unit_attack_tile(const struct unit *punit,
 			  const struct tile *ptile);
 
+void combat_cache_init(void);
+void combat_cache_free(void);
+
 double win_chance(int as, int ahp, int afp, int ds, int dhp, int dfp);
 
 void get_modified_firepower(const struct unit *attacker,
@@ -31,6 +31,7 @@
 #include "achievements.h"
 #include "actions.h"
 #include "city.h"
+#include "combat.h"
 #include "connection.h"
 #include "disaster.h"
 #include "extras.h"
@@ -341,6 +342,7 @@ static void game_defaults(void)
     /* All settings only used by the server (./server/ and ./ai/ */
     sz_strlcpy(game.server.allow_take, GAME_DEFAULT_ALLOW_TAKE);
     game.server.allowed_city_names = GAME_DEFAULT_ALLOWED_CITY_NAMES;
+    game.server.ai_pf_budget      = GAME_DEFAULT_AI_PF_BUDGET;
     game.server.aqueductloss      = GAME_DEFAULT_AQUEDUCTLOSS;
     game.server.auto_ai_toggle    = GAME_DEFAULT_AUTO_AI_TOGGLE;
     game.server.autoattack        = GAME_DEFAULT_AUTOATTACK;
@@ -405,6 +407,7 @@ static void game_defaults(void)
     game.server.savepalace        = GAME_DEFAULT_SAVEPALACE;
     game.server.scorelog          = GAME_DEFAULT_SCORELOG;
     game.server.scoreloglevel     = GAME_DEFAULT_SCORELOGLEVEL;
+    game.server.scorelogformat    = GAME_DEFAULT_SCORELOGFORMAT;
     game.server.scoreturn         = GAME_DEFAULT_SCORETURN - 1;
     game.server.seed              = GAME_DEFAULT_SEED;
     sz_strlcpy(game.server.start_units, GAME_DEFAULT_START_UNITS);
@@ -443,6 +446,7 @@ void game_init(void)
   cm_init();
   researches_init();
   universal_found_functions_init();
+  combat_cache_init();
 }
 
 /****************************************************************************
@@ -472,6 +476,7 @@ void game_free(void)
   game_ruleset_free();
   researches_free();
   cm_free();
+  combat_cache_free();
 }
 
 /***************************************************************
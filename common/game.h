@@ -33,6 +33,7 @@ extern "C" {
 #include "fc_types.h"
 #include "player.h"
 #include "packets.h"
+#include "scorelog.h"		/* enum scorelog_format */
 #include "world_object.h"
 
 enum debug_globals {
@@ -123,6 +124,7 @@ struct civ_game {
 
       enum city_names_mode allowed_city_names;
       enum plrcolor_mode plrcolormode;
+      int ai_pf_budget; /* 1000s of pf positions per AI player and turn */
       int aqueductloss;
       bool auto_ai_toggle;
       bool autoattack;
@@ -212,6 +214,7 @@ struct civ_game {
       char save_name[MAX_LEN_NAME];
       bool scorelog;
       enum scorelog_level scoreloglevel;
+      enum scorelog_format scorelogformat;
       char scorefile[MAX_LEN_NAME];
       int scoreturn;    /* next make_history_report() */
       int seed_setting;
@@ -505,6 +508,7 @@ extern struct world wld;
 
 #define GAME_DEFAULT_SCORELOG        FALSE
 #define GAME_DEFAULT_SCORELOGLEVEL   SL_ALL
+#define GAME_DEFAULT_SCORELOGFORMAT  SLF_TEXT
 #define GAME_DEFAULT_SCOREFILE       "freeciv-score.log"
 
 /* Turns between reports is random between SCORETURN and (2 x SCORETURN).
@@ -541,6 +545,10 @@ extern struct world wld;
 #define GAME_MAX_UNITWAITTIME        GAME_MAX_TIMEOUT
 #define GAME_DEFAULT_UNITWAITTIME    0
 
+#define GAME_MIN_AI_PF_BUDGET        0
+#define GAME_MAX_AI_PF_BUDGET        1000000
+#define GAME_DEFAULT_AI_PF_BUDGET    0
+
 #define GAME_DEFAULT_PHASE_MODE 0
 
 #define GAME_DEFAULT_TCPTIMEOUT      10
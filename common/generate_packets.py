@@ -1083,8 +1083,8 @@ static char *stats_%(name)s_names[] = {%(names)s};
         intro='''
 #ifdef FREECIV_DELTA_PROTOCOL
   if (NULL == *hash) {
-    *hash = genhash_new_full(hash_%(name)s, cmp_%(name)s,
-                             NULL, NULL, NULL, free);
+    *hash = genhash_new_flat_full(hash_%(name)s, cmp_%(name)s,
+                                  NULL, NULL, NULL, free, 0);
   }
   BV_CLR_ALL(fields);
 
@@ -1227,8 +1227,8 @@ static char *stats_%(name)s_names[] = {%(names)s};
         body='''
 #ifdef FREECIV_DELTA_PROTOCOL
   if (NULL == *hash) {
-    *hash = genhash_new_full(hash_%(name)s, cmp_%(name)s,
-                             NULL, NULL, NULL, free);
+    *hash = genhash_new_flat_full(hash_%(name)s, cmp_%(name)s,
+                                  NULL, NULL, NULL, free, 0);
   }
 
   if (genhash_lookup(*hash, real_packet, (void **) &old)) {
@@ -15,11 +15,13 @@
    idex = ident index: a lookup table for quick mapping of unit and city
    id values to unit and city pointers.
 
-   Method: use separate hash tables for each type.
+   Method: ids are small numbers handed out in sequence by the server
+   (below 250000), so each type has an array indexed directly by the id,
+   grown as bigger ids get registered. The few ids which would make the
+   array too big go to a hash table instead.
    Means code duplication for city/unit cases, but simplicity advantages.
    Don't have to manage memory at all: store pointers to unit and city
-   structs allocated elsewhere, and keys are pointers to id values inside
-   the structs.
+   structs allocated elsewhere.
 
    Note id values should probably be unsigned int: here leave as plain int
    so can use pointers to pcity->id etc.
@@ -29,8 +31,11 @@
 #include <fc_config.h>
 #endif
 
+#include <string.h>
+
 /* utility */
 #include "log.h"
+#include "mem.h"
 
 /* common */
 #include "city.h"
@@ -42,20 +47,86 @@
 /* struct city_hash. */
 #define SPECHASH_TAG city
 #define SPECHASH_INT_KEY_TYPE
+#define SPECHASH_FLAT
 #define SPECHASH_IDATA_TYPE struct city *
 #include "spechash.h"
 
 /* struct unit_hash. */
 #define SPECHASH_TAG unit
 #define SPECHASH_INT_KEY_TYPE
+#define SPECHASH_FLAT
 #define SPECHASH_IDATA_TYPE struct unit *
 #include "spechash.h"
 
+/* Ids from 0 to IDEX_DIRECT_IDS - 1 are stored in the arrays. */
+#define IDEX_DIRECT_IDS (1 << 20)
+#define IDEX_MIN_SIZE 1024
+
+struct idex_array {
+  void **objs;
+  int size;
+};
 
 /* "Global" data: */
+static struct idex_array idex_city_array = { NULL, 0 };
+static struct idex_array idex_unit_array = { NULL, 0 };
 static struct city_hash *idex_city_hash = NULL;
 static struct unit_hash *idex_unit_hash = NULL;
 
+/**************************************************************************
+   Is the id stored in the arrays rather than the hash tables?
+***************************************************************************/
+static inline bool idex_is_direct(int id)
+{
+  return 0 <= id && id < IDEX_DIRECT_IDS;
+}
+
+/**************************************************************************
+   Return the object stored for a direct id, or NULL.
+***************************************************************************/
+static inline void *idex_array_get(const struct idex_array *parray, int id)
+{
+  return id < parray->size ? parray->objs[id] : NULL;
+}
+
+/**************************************************************************
+   Store the object for a direct id, growing the array if needed.
+   Returns the object previously stored there.
+***************************************************************************/
+static void *idex_array_set(struct idex_array *parray, int id, void *obj)
+{
+  void *old;
+
+  if (id >= parray->size) {
+    int new_size = MAX(parray->size, IDEX_MIN_SIZE);
+
+    while (new_size <= id) {
+      new_size *= 2;
+    }
+    new_size = MIN(new_size, IDEX_DIRECT_IDS);
+    parray->objs = fc_realloc(parray->objs,
+                              new_size * sizeof(*parray->objs));
+    memset(parray->objs + parray->size, 0,
+           (new_size - parray->size) * sizeof(*parray->objs));
+    parray->size = new_size;
+  }
+
+  old = parray->objs[id];
+  parray->objs[id] = obj;
+
+  return old;
+}
+
+/**************************************************************************
+   Free the memory of the array.
+***************************************************************************/
+static void idex_array_free(struct idex_array *parray)
+{
+  free(parray->objs);
+  parray->objs = NULL;
+  parray->size = 0;
+}
+
 /**************************************************************************
    Initialize.  Should call this at the start before use.
 ***************************************************************************/
@@ -73,9 +144,11 @@ void idex_init(void)
 ***************************************************************************/
 void idex_free(void)
 {
+  idex_array_free(&idex_city_array);
   city_hash_destroy(idex_city_hash);
   idex_city_hash = NULL;
 
+  idex_array_free(&idex_unit_array);
   unit_hash_destroy(idex_unit_hash);
   idex_unit_hash = NULL;
 }
@@ -88,7 +161,11 @@ void idex_register_city(struct city *pcity)
 {
   struct city *old;
 
-  city_hash_replace_full(idex_city_hash, pcity->id, pcity, NULL, &old);
+  if (idex_is_direct(pcity->id)) {
+    old = idex_array_set(&idex_city_array, pcity->id, pcity);
+  } else {
+    city_hash_replace_full(idex_city_hash, pcity->id, pcity, NULL, &old);
+  }
   fc_assert_ret_msg(NULL == old,
                     "IDEX: city collision: new %d %p %s, old %d %p %s",
                     pcity->id, (void *) pcity, city_name_get(pcity),
@@ -103,7 +180,11 @@ void idex_register_unit(struct unit *punit)
 {
   struct unit *old;
 
-  unit_hash_replace_full(idex_unit_hash, punit->id, punit, NULL, &old);
+  if (idex_is_direct(punit->id)) {
+    old = idex_array_set(&idex_unit_array, punit->id, punit);
+  } else {
+    unit_hash_replace_full(idex_unit_hash, punit->id, punit, NULL, &old);
+  }
   fc_assert_ret_msg(NULL == old,
                     "IDEX: unit collision: new %d %p %s, old %d %p %s",
                     punit->id, (void *) punit, unit_rule_name(punit),
@@ -118,7 +199,14 @@ void idex_unregister_city(struct city *pcity)
 {
   struct city *old;
 
-  city_hash_remove_full(idex_city_hash, pcity->id, NULL, &old);
+  if (idex_is_direct(pcity->id)) {
+    old = idex_array_get(&idex_city_array, pcity->id);
+    if (NULL != old) {
+      idex_city_array.objs[pcity->id] = NULL;
+    }
+  } else {
+    city_hash_remove_full(idex_city_hash, pcity->id, NULL, &old);
+  }
   fc_assert_ret_msg(NULL != old,
                     "IDEX: city unreg missing: %d %p %s",
                     pcity->id, (void *) pcity, city_name_get(pcity));
@@ -136,7 +224,14 @@ void idex_unregister_unit(struct unit *punit)
 {
   struct unit *old;
 
-  unit_hash_remove_full(idex_unit_hash, punit->id, NULL, &old);
+  if (idex_is_direct(punit->id)) {
+    old = idex_array_get(&idex_unit_array, punit->id);
+    if (NULL != old) {
+      idex_unit_array.objs[punit->id] = NULL;
+    }
+  } else {
+    unit_hash_remove_full(idex_unit_hash, punit->id, NULL, &old);
+  }
   fc_assert_ret_msg(NULL != old,
                     "IDEX: unit unreg missing: %d %p %s",
                     punit->id, (void *) punit, unit_rule_name(punit));
@@ -154,6 +249,10 @@ struct city *idex_lookup_city(int id)
 {
   struct city *pcity;
 
+  if (idex_is_direct(id)) {
+    return idex_array_get(&idex_city_array, id);
+  }
+
   city_hash_lookup(idex_city_hash, id, &pcity);
   return pcity;
 }
@@ -166,6 +265,10 @@ struct unit *idex_lookup_unit(int id)
 {
   struct unit *punit;
 
+  if (idex_is_direct(id)) {
+    return idex_array_get(&idex_unit_array, id);
+  }
+
   unit_hash_lookup(idex_unit_hash, id, &punit);
   return punit;
 }
@@ -157,9 +157,12 @@ void map_init(struct civ_map *imap, bool server_side)
   imap->topology_id = MAP_DEFAULT_TOPO;
   imap->num_continents = 0;
   imap->num_oceans = 0;
+  imap->continent_generation = 0;
   imap->tiles = NULL;
   imap->startpos_table = NULL;
   imap->iterate_outwards_indices = NULL;
+  imap->iterate_outwards_deltas[0] = NULL;
+  imap->iterate_outwards_deltas[1] = NULL;
 
   /* The [xy]size values are set in map_init_topology.  It is initialized
    * to a non-zero value because some places erronously use these values
@@ -198,7 +201,7 @@ void map_init(struct civ_map *imap, bool server_side)
 ***************************************************************************/
 static void generate_map_indices(void)
 {
-  int i = 0, nat_x, nat_y, tiles;
+  int i = 0, nat_x, nat_y, tiles, fast, odd;
   int nat_center_x, nat_center_y, nat_min_x, nat_min_y, nat_max_x, nat_max_y;
   int map_center_x, map_center_y;
 
@@ -287,6 +290,41 @@ static void generate_map_indices(void)
 #endif
 
   wld.map.num_iterate_outwards_indices = tiles;
+
+  /* Index deltas for the positions iterate_outward_dxy() visits most. */
+  for (fast = 0; fast < tiles; fast++) {
+    if (wld.map.iterate_outwards_indices[fast].dist > MAP_ITERATE_FAST_DIST) {
+      break;
+    }
+  }
+  for (odd = 0; odd < 2; odd++) {
+    fc_assert(NULL == wld.map.iterate_outwards_deltas[odd]);
+    wld.map.iterate_outwards_deltas[odd] =
+        fc_malloc(MAX(fast, 1) * sizeof(*wld.map.iterate_outwards_deltas[odd]));
+    for (i = 0; i < fast; i++) {
+      wld.map.iterate_outwards_deltas[odd][i] =
+          map_vector_to_index_delta(wld.map.iterate_outwards_indices[i].dx,
+                                    wld.map.iterate_outwards_indices[i].dy,
+                                    odd);
+    }
+  }
+}
+
+/****************************************************************************
+  Return the difference of the tile indices of a tile and of the tile at
+  the map vector (dx, dy) from it, when the vector doesn't cross a map
+  edge (see is_border_tile()). The difference is the same for all such
+  tiles, except that in isometric maps it depends on whether their native
+  y coordinate is odd, given as nat_y_odd.
+****************************************************************************/
+int map_vector_to_index_delta(int dx, int dy, bool nat_y_odd)
+{
+  int map_x, map_y, nat_x, nat_y;
+
+  NATIVE_TO_MAP_POS(&map_x, &map_y, 0, nat_y_odd ? 1 : 0);
+  MAP_TO_NATIVE_POS(&nat_x, &nat_y, map_x + dx, map_y + dy);
+
+  return (nat_y - (nat_y_odd ? 1 : 0)) * wld.map.xsize + nat_x;
 }
 
 /****************************************************************************
@@ -511,6 +549,10 @@ void map_allocate(struct civ_map *amap)
 void main_map_allocate(void)
 {
   map_allocate(&(wld.map));
+  players_iterate(pplayer) {
+    /* No tile is owned yet. */
+    pplayer->owned_tiles = 0;
+  } players_iterate_end;
   generate_city_map_indices();
   generate_map_indices();
 }
@@ -536,6 +578,8 @@ void map_free(struct civ_map *fmap)
     }
 
     FC_FREE(fmap->iterate_outwards_indices);
+    FC_FREE(fmap->iterate_outwards_deltas[0]);
+    FC_FREE(fmap->iterate_outwards_deltas[1]);
   }
 }
 
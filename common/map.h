@@ -243,6 +243,7 @@ struct tile *mapstep(const struct tile *ptile, enum direction8 dir);
 
 struct tile *map_pos_to_tile(int x, int y);
 struct tile *native_pos_to_tile(int nat_x, int nat_y);
+int map_vector_to_index_delta(int dx, int dy, bool nat_y_odd);
 struct tile *index_to_tile(struct civ_map *imap, int mindex);
 
 bool is_real_map_pos(int x, int y);
@@ -323,6 +324,8 @@ extern struct terrain_misc terrain_control;
   const struct tile *_tile##_start = (start_tile);			    \
   int _tile##_max = (max_dist);						    \
   int _tile##_index = 0;						    \
+  const int *_tile##_deltas = iterate_outward_deltas(_tile##_start,         \
+                                                     _tile##_max);          \
   index_to_map_pos(&_start##_x, &_start##_y, tile_index(_tile##_start));    \
   for (;								    \
        _tile##_index < wld.map.num_iterate_outwards_indices;		    \
@@ -332,17 +335,30 @@ extern struct terrain_misc terrain_control;
     }									    \
     _x = wld.map.iterate_outwards_indices[_tile##_index].dx;		    \
     _y = wld.map.iterate_outwards_indices[_tile##_index].dy;		    \
-    _tile##_x = _x + _start##_x;                                            \
-    _tile##_y = _y + _start##_y;                                            \
-    _tile = map_pos_to_tile(_tile##_x, _tile##_y);                          \
-    if (NULL == _tile) {                                                    \
-      continue;                                                             \
+    if (NULL != _tile##_deltas) {                                           \
+      /* Away from the map edges: no normalization needed. */               \
+      _tile = wld.map.tiles + tile_index(_tile##_start)                     \
+              + _tile##_deltas[_tile##_index];                              \
+    } else {                                                                \
+      _tile##_x = _x + _start##_x;                                          \
+      _tile##_y = _y + _start##_y;                                          \
+      _tile = map_pos_to_tile(_tile##_x, _tile##_y);                        \
+      if (NULL == _tile) {                                                  \
+        continue;                                                           \
+      }                                                                     \
     }
 
 #define iterate_outward_dxy_end						    \
   }									    \
 }
 
+/* Up to this real distance, iterate_outward_dxy() steps from tiles away
+ * from the map edges by adding precomputed index deltas. */
+#define MAP_ITERATE_FAST_DIST 10
+
+static inline const int *iterate_outward_deltas(const struct tile *ptile,
+                                                int max_dist);
+
 /* See iterate_outward_dxy() */
 #define iterate_outward(start_tile, max_dist, itr_tile)			    \
   iterate_outward_dxy(start_tile, max_dist, itr_tile, _dx_itr, _dy_itr)
@@ -710,6 +726,24 @@ static inline bool is_border_tile(const struct tile *ptile, int dist)
           || nat_y >= wld.map.ysize - ydist);
 }
 
+/****************************************************************************
+  Return the tile index deltas iterate_outward_dxy() can use to iterate
+  up to max_dist around ptile, or NULL if it has to step through
+  map_pos_to_tile() because ptile is too near the map edges or max_dist
+  is too large.
+****************************************************************************/
+static inline const int *iterate_outward_deltas(const struct tile *ptile,
+                                                int max_dist)
+{
+  if (max_dist < 0 || max_dist > MAP_ITERATE_FAST_DIST
+      || is_border_tile(ptile, max_dist)) {
+    return NULL;
+  }
+
+  return wld.map.iterate_outwards_deltas[index_to_native_pos_y(tile_index(ptile))
+                                         & 1];
+}
+
 enum direction8 rand_direction(void);
 enum direction8 opposite_direction(enum direction8 dir);
 
@@ -71,9 +71,14 @@ struct civ_map {
   int num_valid_dirs, num_cardinal_dirs;
   struct iter_index *iterate_outwards_indices;
   int num_iterate_outwards_indices;
+  /* Tile index deltas of the first iterate_outwards_indices, for tiles
+   * with even and odd native y; see iterate_outward_deltas(). */
+  int *iterate_outwards_deltas[2];
   int xsize, ysize; /* native dimensions */
   int num_continents;
   int num_oceans;               /* not updated at the client */
+  int continent_generation;     /* bumped when continents are renumbered;
+                                 * not updated at the client */
   struct tile *tiles;
   struct startpos_hash *startpos_table;
 
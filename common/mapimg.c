@@ -21,6 +21,10 @@
   #include <wand/MagickWand.h>
 #endif /* HAVE_MAPIMG_MAGICKWAND */
 
+#ifdef FREECIV_HAVE_LIBZ
+#include <zlib.h>
+#endif /* FREECIV_HAVE_LIBZ */
+
 /* utility */
 #include "astring.h"
 #include "bitvector.h"
@@ -265,6 +269,8 @@ BV_DEFINE(bv_mapdef_arg, MAPDEF_COUNT);
 #define SPECENUM_VALUE0NAME "ppm"
 #define SPECENUM_VALUE1     IMGTOOL_MAGICKWAND
 #define SPECENUM_VALUE1NAME "magick"
+#define SPECENUM_VALUE2     IMGTOOL_PNG
+#define SPECENUM_VALUE2NAME "png"
 #include "specenum_gen.h"
 
 /* player definitions */
@@ -399,7 +405,11 @@ static void img_plot_tile(struct img *pimg, const struct tile *ptile,
                           const struct rgbcolor *pcolor, const bv_pixel pixel);
 static bool img_save(const struct img *pimg, const char *mapimgfile,
                      const char *path);
+static void img_row_rgb(const struct img *pimg, int y, unsigned char *row);
 static bool img_save_ppm(const struct img *pimg, const char *mapimgfile);
+#ifdef FREECIV_HAVE_LIBZ
+static bool img_save_png(const struct img *pimg, const char *mapimgfile);
+#endif /* FREECIV_HAVE_LIBZ */
 #ifdef HAVE_MAPIMG_MAGICKWAND
 static bool img_save_magickwand(const struct img *pimg,
                                 const char *mapimgfile);
@@ -427,6 +437,11 @@ static struct toolkit img_toolkits[] = {
   GEN_TOOLKIT(IMGTOOL_PPM, IMGFORMAT_PPM, IMGFORMAT_PPM,
               img_save_ppm,
               N_("Standard ppm files"))
+#ifdef FREECIV_HAVE_LIBZ
+  GEN_TOOLKIT(IMGTOOL_PNG, IMGFORMAT_PNG, IMGFORMAT_PNG,
+              img_save_png,
+              N_("Built-in png files"))
+#endif /* FREECIV_HAVE_LIBZ */
 #ifdef HAVE_MAPIMG_MAGICKWAND
   GEN_TOOLKIT(IMGTOOL_MAGICKWAND, IMGFORMAT_GIF,
               IMGFORMAT_GIF + IMGFORMAT_PNG + IMGFORMAT_PPM + IMGFORMAT_JPG,
@@ -2275,6 +2290,24 @@ static bool img_save_magickwand(const struct img *pimg,
 #undef SET_COLOR
 #endif /* HAVE_MAPIMG_MAGICKWAND */
 
+/****************************************************************************
+  Write 'val' as decimal number followed by 'sep' to 'buf'. Returns the
+  position after the written text.
+****************************************************************************/
+static char *ppm_put_value(char *buf, unsigned char val, char sep)
+{
+  if (val >= 100) {
+    *buf++ = '0' + val / 100;
+  }
+  if (val >= 10) {
+    *buf++ = '0' + (val / 10) % 10;
+  }
+  *buf++ = '0' + val % 10;
+  *buf++ = sep;
+
+  return buf;
+}
+
 /****************************************************************************
   Save an image as ppm file (toolkit: ppm).
 ****************************************************************************/
@@ -2282,8 +2315,9 @@ static bool img_save_ppm(const struct img *pimg, const char *mapimgfile)
 {
   char ppmname[MAX_LEN_PATH];
   FILE *fp;
-  int x, y, xxx, yyy, mindex;
-  const struct rgbcolor *pcolor;
+  unsigned char *row;
+  char *text;
+  int row_len, x, y, yyy;
 
   if (pimg->def->format != IMGFORMAT_PPM) {
     MAPIMG_LOG(_("the ppm toolkit can only create images in the ppm "
@@ -2314,7 +2348,6 @@ static bool img_save_ppm(const struct img *pimg, const char *mapimgfile)
         continue;
       }
 
-      pcolor = imgcolor_player(player_index(pplayer));
       fprintf(fp, "# %s\n", img_playerstr(pplayer));
     } players_iterate_end;
   } else {
@@ -2325,31 +2358,234 @@ static bool img_save_ppm(const struct img *pimg, const char *mapimgfile)
           pimg->imgsize.y * pimg->def->zoom);
   fprintf(fp, "255\n");
 
+  /* Each row is formatted once and written 'zoom' times. A pixel needs at
+   * most 12 characters ("255 255 255\n"). */
+  row_len = pimg->imgsize.x * pimg->def->zoom;
+  row = fc_malloc(row_len * 3);
+  text = fc_malloc(row_len * 12);
+
   /* y coordinate */
   for (y = 0; y < pimg->imgsize.y; y++) {
+    char *ptext = text;
+
+    img_row_rgb(pimg, y, row);
+    for (x = 0; x < row_len * 3; x++) {
+      ptext = ppm_put_value(ptext, row[x], (x % 3 == 2) ? '\n' : ' ');
+    }
+
     /* zoom for y */
     for (yyy = 0; yyy < pimg->def->zoom; yyy++) {
-      /* x coordinate */
-      for (x = 0; x < pimg->imgsize.x; x++) {
-        mindex = img_index(x, y, pimg);
-        pcolor = pimg->map[mindex];
+      fwrite(text, 1, ptext - text, fp);
+    }
+  }
 
-        /* zoom for x */
-        for (xxx = 0; xxx < pimg->def->zoom; xxx++) {
-          if (pcolor == NULL) {
-            pcolor = imgcolor_special(IMGCOLOR_BACKGROUND);
-          }
-          fprintf(fp, "%d %d %d\n", pcolor->r, pcolor->g, pcolor->b);
+  free(row);
+  free(text);
+
+  if (ferror(fp) || fclose(fp) != 0) {
+    MAPIMG_LOG(_("could not write file: %s"), ppmname);
+    return FALSE;
+  }
+
+  log_verbose("Map image saved as '%s'.", ppmname);
+
+  return TRUE;
+}
+
+#ifdef FREECIV_HAVE_LIBZ
+/****************************************************************************
+  Write a 32 bit value in network byte order as used by png files.
+****************************************************************************/
+static void png_put_uint32(unsigned char *buf, unsigned long val)
+{
+  buf[0] = (val >> 24) & 0xff;
+  buf[1] = (val >> 16) & 0xff;
+  buf[2] = (val >> 8) & 0xff;
+  buf[3] = val & 0xff;
+}
+
+/****************************************************************************
+  Write one png chunk (length, type, data and crc).
+****************************************************************************/
+static void png_write_chunk(FILE *fp, const char *type,
+                            const unsigned char *data, size_t len)
+{
+  unsigned char buf[4];
+  uLong crc;
+
+  png_put_uint32(buf, len);
+  fwrite(buf, 1, 4, fp);
+  fwrite(type, 1, 4, fp);
+  if (len > 0) {
+    fwrite(data, 1, len, fp);
+  }
+
+  crc = crc32(0L, (const Bytef *) type, 4);
+  if (len > 0) {
+    crc = crc32(crc, data, len);
+  }
+  png_put_uint32(buf, crc);
+  fwrite(buf, 1, 4, fp);
+}
+
+/****************************************************************************
+  Write a png text chunk.
+****************************************************************************/
+static void png_write_text(FILE *fp, const char *key, const char *text)
+{
+  size_t key_len = strlen(key), text_len = strlen(text);
+  unsigned char *data = fc_malloc(key_len + 1 + text_len);
+
+  /* keyword, null separator, text (no trailing null) */
+  memcpy(data, key, key_len + 1);
+  memcpy(data + key_len + 1, text, text_len);
+  png_write_chunk(fp, "tEXt", data, key_len + 1 + text_len);
+
+  free(data);
+}
+
+/****************************************************************************
+  Save an image as png file (toolkit: png). The image rows are compressed
+  with zlib and written as they are generated, so no full copy of the
+  zoomed image is needed.
+****************************************************************************/
+static bool img_save_png(const struct img *pimg, const char *mapimgfile)
+{
+  static const unsigned char png_signature[8]
+    = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+  char pngname[MAX_LEN_PATH];
+  unsigned char header[13], zbuf[65536];
+  unsigned char *row;
+  size_t row_len;
+  z_stream zs;
+  FILE *fp;
+  int y, yyy, zret = Z_OK;
+
+  if (pimg->def->format != IMGFORMAT_PNG) {
+    MAPIMG_LOG(_("the png toolkit can only create images in the png "
+                 "format"));
+    return FALSE;
+  }
+
+  if (!img_filename(mapimgfile, IMGFORMAT_PNG, pngname, sizeof(pngname))) {
+    MAPIMG_LOG(_("error generating the file name"));
+    return FALSE;
+  }
+
+  memset(&zs, 0, sizeof(zs));
+  if (deflateInit(&zs, Z_BEST_SPEED) != Z_OK) {
+    MAPIMG_LOG(_("could not initialise zlib"));
+    return FALSE;
+  }
+
+  fp = fopen(pngname, "wb");
+  if (!fp) {
+    MAPIMG_LOG(_("could not open file: %s"), pngname);
+    deflateEnd(&zs);
+    return FALSE;
+  }
+
+  fwrite(png_signature, 1, sizeof(png_signature), fp);
+
+  /* width, height, bit depth 8, color type 2 (RGB), compression 0,
+   * filter 0, no interlace */
+  png_put_uint32(header, pimg->imgsize.x * pimg->def->zoom);
+  png_put_uint32(header + 4, pimg->imgsize.y * pimg->def->zoom);
+  header[8] = 8;
+  header[9] = 2;
+  header[10] = 0;
+  header[11] = 0;
+  header[12] = 0;
+  png_write_chunk(fp, "IHDR", header, sizeof(header));
+
+  png_write_text(fp, "Title", pimg->title);
+  png_write_text(fp, "Comment", pimg->def->maparg);
+  png_write_text(fp, "Software", freeciv_name_version());
+
+  /* Each row starts with the filter type (0: none). */
+  row_len = 1 + pimg->imgsize.x * pimg->def->zoom * 3;
+  row = fc_malloc(row_len);
+  row[0] = 0;
+
+  zs.next_out = zbuf;
+  zs.avail_out = sizeof(zbuf);
+
+  for (y = 0; y <= pimg->imgsize.y && zret == Z_OK; y++) {
+    /* One more round after the last row to flush the stream. */
+    bool finish = (y == pimg->imgsize.y);
+
+    if (!finish) {
+      img_row_rgb(pimg, y, row + 1);
+    }
+
+    /* zoom for y */
+    for (yyy = 0; yyy < (finish ? 1 : pimg->def->zoom); yyy++) {
+      zs.next_in = row;
+      zs.avail_in = finish ? 0 : row_len;
+
+      do {
+        if (zs.avail_out == 0) {
+          png_write_chunk(fp, "IDAT", zbuf, sizeof(zbuf));
+          zs.next_out = zbuf;
+          zs.avail_out = sizeof(zbuf);
         }
-      }
+        zret = deflate(&zs, finish ? Z_FINISH : Z_NO_FLUSH);
+      } while (zret == Z_OK && (zs.avail_in > 0 || zs.avail_out == 0
+                                || (finish && zret != Z_STREAM_END)));
     }
   }
 
-  log_verbose("Map image saved as '%s'.", ppmname);
-  fclose(fp);
+  if (zret == Z_STREAM_END && zs.avail_out < sizeof(zbuf)) {
+    png_write_chunk(fp, "IDAT", zbuf, sizeof(zbuf) - zs.avail_out);
+  }
+  png_write_chunk(fp, "IEND", NULL, 0);
+
+  deflateEnd(&zs);
+  free(row);
+
+  if (zret != Z_STREAM_END) {
+    fclose(fp);
+    MAPIMG_LOG(_("error compressing the image: %s"), pngname);
+    return FALSE;
+  }
+
+  if (ferror(fp) || fclose(fp) != 0) {
+    MAPIMG_LOG(_("could not write file: %s"), pngname);
+    return FALSE;
+  }
+
+  log_verbose("Map image saved as '%s'.", pngname);
 
   return TRUE;
 }
+#endif /* FREECIV_HAVE_LIBZ */
+
+/****************************************************************************
+  Fill 'row' with the RGB values of the image row 'y', already zoomed in
+  x direction. 'row' must hold 3 * imgsize.x * zoom bytes.
+****************************************************************************/
+static void img_row_rgb(const struct img *pimg, int y, unsigned char *row)
+{
+  const struct rgbcolor *background = imgcolor_special(IMGCOLOR_BACKGROUND);
+  const struct rgbcolor **map_row = pimg->map + img_index(0, y, pimg);
+  int x, xxx;
+
+  /* x coordinate */
+  for (x = 0; x < pimg->imgsize.x; x++) {
+    const struct rgbcolor *pcolor = map_row[x];
+
+    if (pcolor == NULL) {
+      pcolor = background;
+    }
+
+    /* zoom for x */
+    for (xxx = 0; xxx < pimg->def->zoom; xxx++) {
+      *row++ = pcolor->r;
+      *row++ = pcolor->g;
+      *row++ = pcolor->b;
+    }
+  }
+}
 
 /****************************************************************************
   Generate the final filename.
@@ -2396,18 +2632,21 @@ static void img_createmap(struct img *pimg)
   struct terrain *pterrain = NULL;
   bool plr_knowledge = pimg->def->layers[MAPIMG_LAYER_KNOWLEDGE];
 
+  if (bvplayers_count(pimg->def) == 1) {
+    /* only one player; get player id for 'known' and 'fogofwar' */
+    players_iterate(aplayer) {
+      if (BV_ISSET(pimg->def->player.checked_plrbv,
+                   player_index(aplayer))) {
+        pplayer = aplayer;
+        break;
+      }
+    } players_iterate_end;
+  }
+
   whole_map_iterate(&(wld.map), ptile) {
-    if (bvplayers_count(pimg->def) == 1) {
-      /* only one player; get player id for 'known' and 'fogofwar' */
-      players_iterate(aplayer) {
-        if (BV_ISSET(pimg->def->player.checked_plrbv,
-                     player_index(aplayer))) {
-          pplayer = aplayer;
-          tile_knowledge = mapimg.mapimg_tile_known(ptile, pplayer,
-                                                    plr_knowledge);
-          break;
-        }
-      } players_iterate_end;
+    if (pplayer != NULL) {
+      tile_knowledge = mapimg.mapimg_tile_known(ptile, pplayer,
+                                                plr_knowledge);
     }
 
     /* known tiles */
@@ -99,6 +99,7 @@ enum auth_status {
   AS_FAILED,
   AS_REQUESTING_NEW_PASS,
   AS_REQUESTING_OLD_PASS,
+  AS_WAITING_DATABASE,
   AS_ESTABLISHED
 };
 
@@ -556,6 +556,7 @@ static void player_defaults(struct player *pplayer)
   pplayer->music_style = -1;          /* even getting value 0 triggers change */
   pplayer->cities = city_list_new();
   pplayer->units = unit_list_new();
+  pplayer->owned_tiles = 0;
 
   pplayer->economic.gold    = 0;
   pplayer->economic.tax     = PLAYER_DEFAULT_TAX_RATE;
@@ -265,6 +265,8 @@ struct player {
   struct city_list *cities;
   struct unit_list *units;
   struct player_score score;
+  int owned_tiles;           /* Tiles of the main map owned by this player;
+                              * kept up to date by tile_set_owner() */
   struct player_economic economic;
 
   struct player_spaceship spaceship;
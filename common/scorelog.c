@@ -0,0 +1,482 @@
+/**********************************************************************
+ Freeciv - Copyright (C) 1996 - A Kjeldberg, L Gregersen, P Unold
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2, or (at your option)
+   any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+***********************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include <fc_config.h>
+#endif
+
+#include <string.h>
+
+#ifdef FREECIV_HAVE_LIBZ
+#include <zlib.h>
+#endif /* FREECIV_HAVE_LIBZ */
+
+/* utility */
+#include "log.h"
+#include "mem.h"
+#include "shared.h"              /* MAX() */
+
+/* common/networking */
+#include "dataio_raw.h"
+
+#include "scorelog.h"
+
+/* Record framing: uint8 type, uint32 payload length, payload. */
+#define SCORELOG_FRAME_SIZE             5
+
+/* Fixed part of a SLR_COLUMNS payload before the player index: sint32 turn,
+ * uint8 flags, uint16 ntags, uint16 nplayers. */
+#define SCORELOG_COLUMNS_HEAD           9
+#define SCORELOG_COLUMNS_COMPRESSED     0x01
+
+/* Refuse anything larger when reading; protects against garbage input. */
+#define SCORELOG_MAX_PAYLOAD            (64 * 1024 * 1024)
+
+static bool scorelog_read_columns(FILE *fp, struct scorelog_record *prec,
+                                  size_t len, bool with_values);
+
+/**************************************************************************
+  Write one record in the text format (version 2). A SLR_VERSION record
+  becomes the file header, a SLR_COLUMNS record one 'data' line per
+  present value, tag by tag.
+**************************************************************************/
+bool scorelog_text_write(FILE *fp, const struct scorelog_record *prec)
+{
+  int ret = 0;
+
+  switch (prec->type) {
+  case SLR_VERSION:
+    ret = fprintf(fp, "%s%s\n", SCORELOG_TEXT_MAGIC, prec->text);
+    if (ret >= 0) {
+      ret = fprintf(fp,
+                    "\n"
+                    "# For a specification of the format of this see doc/README.scorelog or \n"
+                    "# <http://svn.gna.org/viewcvs/freeciv/trunk/doc/README.scorelog?view=auto>.\n"
+                    "\n");
+    }
+    break;
+  case SLR_ID:
+    ret = fprintf(fp, "id %s\n", prec->text);
+    break;
+  case SLR_TAG:
+    ret = fprintf(fp, "tag %d %s\n", prec->id, prec->text);
+    break;
+  case SLR_TURN:
+    ret = fprintf(fp, "turn %d %d %s\n", prec->turn, prec->year, prec->text);
+    break;
+  case SLR_ADDPLAYER:
+    ret = fprintf(fp, "addplayer %d %d %s\n", prec->turn, prec->id,
+                  prec->text);
+    break;
+  case SLR_DELPLAYER:
+    ret = fprintf(fp, "delplayer %d %d\n", prec->turn, prec->id);
+    break;
+  case SLR_COLUMNS:
+    {
+      int t, p;
+
+      for (t = 0; t < prec->ntags && ret >= 0; t++) {
+        const int *column = prec->values + t * prec->nplayers;
+
+        for (p = 0; p < prec->nplayers && ret >= 0; p++) {
+          if (column[p] != SCORELOG_NO_VALUE) {
+            ret = fprintf(fp, "data %d %d %d %d\n", prec->turn, t,
+                          prec->players[p], column[p]);
+          }
+        }
+      }
+    }
+    break;
+  case SLR_END:
+    break;
+  }
+
+  return ret >= 0;
+}
+
+/**************************************************************************
+  Put a length prefixed string. No charset conversion is done, so the
+  bytes on disk are the ones the server used.
+**************************************************************************/
+static void scorelog_put_text(struct raw_data_out *dout, const char *text)
+{
+  size_t len = strlen(text);
+
+  dio_put_uint16_raw(dout, len);
+  dio_put_memory_raw(dout, text, len);
+}
+
+/**************************************************************************
+  Get a string written by scorelog_put_text().
+**************************************************************************/
+static bool scorelog_get_text(struct data_in *din, char *dest,
+                              size_t dest_size)
+{
+  int len;
+
+  if (!dio_get_uint16_raw(din, &len) || (size_t) len >= dest_size
+      || !dio_get_memory_raw(din, dest, len)) {
+    return FALSE;
+  }
+  dest[len] = '\0';
+
+  return TRUE;
+}
+
+/**************************************************************************
+  Return TRUE iff fp is positioned at the start of a binary scorelog. The
+  magic is consumed on success; otherwise the file is rewound.
+**************************************************************************/
+bool scorelog_binary_check_magic(FILE *fp)
+{
+  char magic[SCORELOG_BINARY_MAGIC_LEN];
+
+  if (fread(magic, 1, sizeof(magic), fp) == sizeof(magic)
+      && memcmp(magic, SCORELOG_BINARY_MAGIC, sizeof(magic)) == 0) {
+    return TRUE;
+  }
+
+  rewind(fp);
+
+  return FALSE;
+}
+
+/**************************************************************************
+  Start a new binary scorelog.
+**************************************************************************/
+bool scorelog_binary_write_magic(FILE *fp)
+{
+  return fwrite(SCORELOG_BINARY_MAGIC, 1, SCORELOG_BINARY_MAGIC_LEN, fp)
+         == SCORELOG_BINARY_MAGIC_LEN;
+}
+
+/**************************************************************************
+  Append one record. For SLR_COLUMNS the value block is zlib compressed
+  if 'compress' is set and the server was built with zlib; the player
+  index stays uncompressed so readers can scan turns and players without
+  inflating anything.
+**************************************************************************/
+bool scorelog_binary_write(FILE *fp, const struct scorelog_record *prec,
+                           bool compress)
+{
+  struct raw_data_out dout;
+  unsigned char *buf;
+  size_t size, text_len = strlen(prec->text);
+  size_t nvalues = 0;
+  bool ok;
+
+  fc_assert_ret_val(prec->type != SLR_END, FALSE);
+
+  if (prec->type == SLR_COLUMNS) {
+    nvalues = (size_t) prec->ntags * prec->nplayers;
+    size = SCORELOG_FRAME_SIZE + SCORELOG_COLUMNS_HEAD
+           + 2 * prec->nplayers + 4 + 4 * nvalues;
+#ifdef FREECIV_HAVE_LIBZ
+    if (compress) {
+      size += compressBound(4 * nvalues);
+    }
+#endif /* FREECIV_HAVE_LIBZ */
+  } else {
+    size = SCORELOG_FRAME_SIZE + 4 + 4 + 2 + text_len;
+  }
+
+  buf = fc_malloc(size);
+  dio_output_init(&dout, buf, size);
+  dio_put_uint8_raw(&dout, prec->type);
+  /* Payload length is filled in below. */
+  dio_put_uint32_raw(&dout, 0);
+
+  switch (prec->type) {
+  case SLR_VERSION:
+  case SLR_ID:
+    scorelog_put_text(&dout, prec->text);
+    break;
+  case SLR_TAG:
+    dio_put_uint16_raw(&dout, prec->id);
+    scorelog_put_text(&dout, prec->text);
+    break;
+  case SLR_TURN:
+    dio_put_sint32_raw(&dout, prec->turn);
+    dio_put_sint32_raw(&dout, prec->year);
+    scorelog_put_text(&dout, prec->text);
+    break;
+  case SLR_ADDPLAYER:
+    dio_put_sint32_raw(&dout, prec->turn);
+    dio_put_uint16_raw(&dout, prec->id);
+    scorelog_put_text(&dout, prec->text);
+    break;
+  case SLR_DELPLAYER:
+    dio_put_sint32_raw(&dout, prec->turn);
+    dio_put_uint16_raw(&dout, prec->id);
+    break;
+  case SLR_COLUMNS:
+    {
+      size_t i;
+      int p;
+      bool packed = FALSE;
+
+      dio_put_sint32_raw(&dout, prec->turn);
+#ifdef FREECIV_HAVE_LIBZ
+      packed = compress && nvalues > 0;
+#endif
+      dio_put_uint8_raw(&dout, packed ? SCORELOG_COLUMNS_COMPRESSED : 0);
+      dio_put_uint16_raw(&dout, prec->ntags);
+      dio_put_uint16_raw(&dout, prec->nplayers);
+      for (p = 0; p < prec->nplayers; p++) {
+        dio_put_uint16_raw(&dout, prec->players[p]);
+      }
+
+      if (!packed) {
+        for (i = 0; i < nvalues; i++) {
+          dio_put_sint32_raw(&dout, prec->values[i]);
+        }
+      }
+#ifdef FREECIV_HAVE_LIBZ
+      else {
+        struct raw_data_out raw;
+        unsigned char *plain = fc_malloc(4 * nvalues);
+        uLongf zsize = size - dout.used - 4;
+
+        dio_output_init(&raw, plain, 4 * nvalues);
+        for (i = 0; i < nvalues; i++) {
+          dio_put_sint32_raw(&raw, prec->values[i]);
+        }
+        dio_put_uint32_raw(&dout, 4 * nvalues);
+        if (compress2(buf + dout.used, &zsize, plain, 4 * nvalues,
+                      Z_DEFAULT_COMPRESSION) != Z_OK) {
+          log_error("Scorelog: can't compress turn %d.", prec->turn);
+          free(plain);
+          free(buf);
+          return FALSE;
+        }
+        free(plain);
+        dout.used += zsize;
+        dout.current = dout.used;
+      }
+#endif /* FREECIV_HAVE_LIBZ */
+    }
+    break;
+  case SLR_END:
+    /* Checked above. */
+    break;
+  }
+
+  fc_assert(!dout.too_short);
+  size = dout.used;
+  dout.current = 1;
+  dio_put_uint32_raw(&dout, size - SCORELOG_FRAME_SIZE);
+
+  ok = (fwrite(buf, 1, size, fp) == size);
+  free(buf);
+
+  return ok;
+}
+
+/**************************************************************************
+  Read the next record into prec. At the end of the file prec->type is
+  SLR_END. Returns FALSE on read errors and malformed records. If
+  'with_values' is FALSE the value block of SLR_COLUMNS records is skipped
+  (prec->values stays NULL); that is much faster for scans that need only
+  the player-turn index.
+
+  prec must have been zeroed or freed with scorelog_record_free() before.
+**************************************************************************/
+bool scorelog_binary_read(FILE *fp, struct scorelog_record *prec,
+                          bool with_values)
+{
+  unsigned char frame[SCORELOG_FRAME_SIZE];
+  unsigned char *buf;
+  struct data_in din;
+  int type, len, value;
+  size_t got;
+  bool ok = TRUE;
+
+  got = fread(frame, 1, sizeof(frame), fp);
+  if (got == 0 && feof(fp)) {
+    prec->type = SLR_END;
+    return TRUE;
+  }
+  if (got != sizeof(frame)) {
+    return FALSE;
+  }
+
+  dio_input_init(&din, frame, sizeof(frame));
+  dio_get_uint8_raw(&din, &type);
+  dio_get_uint32_raw(&din, &len);
+  if (len < 0 || len > SCORELOG_MAX_PAYLOAD) {
+    return FALSE;
+  }
+
+  prec->type = type;
+  prec->text[0] = '\0';
+
+  if (type == SLR_COLUMNS) {
+    return scorelog_read_columns(fp, prec, len, with_values);
+  }
+
+  buf = fc_malloc(MAX(len, 1));
+  if (fread(buf, 1, len, fp) != (size_t) len) {
+    free(buf);
+    return FALSE;
+  }
+  dio_input_init(&din, buf, len);
+
+  switch (type) {
+  case SLR_VERSION:
+  case SLR_ID:
+    ok = scorelog_get_text(&din, prec->text, sizeof(prec->text));
+    break;
+  case SLR_TAG:
+    ok = dio_get_uint16_raw(&din, &prec->id)
+         && scorelog_get_text(&din, prec->text, sizeof(prec->text));
+    break;
+  case SLR_TURN:
+    ok = dio_get_sint32_raw(&din, &prec->turn)
+         && dio_get_sint32_raw(&din, &prec->year)
+         && scorelog_get_text(&din, prec->text, sizeof(prec->text));
+    break;
+  case SLR_ADDPLAYER:
+    ok = dio_get_sint32_raw(&din, &prec->turn)
+         && dio_get_uint16_raw(&din, &value)
+         && scorelog_get_text(&din, prec->text, sizeof(prec->text));
+    prec->id = value;
+    break;
+  case SLR_DELPLAYER:
+    ok = dio_get_sint32_raw(&din, &prec->turn)
+         && dio_get_uint16_raw(&din, &value);
+    prec->id = value;
+    break;
+  default:
+    /* Unknown record types are an error; future versions get a new
+     * magic rather than new record types. */
+    ok = FALSE;
+    break;
+  }
+
+  free(buf);
+
+  return ok;
+}
+
+/**************************************************************************
+  Read the payload of a SLR_COLUMNS record of length 'len'.
+**************************************************************************/
+static bool scorelog_read_columns(FILE *fp, struct scorelog_record *prec,
+                                  size_t len, bool with_values)
+{
+  unsigned char head[SCORELOG_COLUMNS_HEAD];
+  unsigned char *buf;
+  struct data_in din;
+  int flags, value, p;
+  size_t i, index_size, rest, nvalues;
+
+  if (len < sizeof(head) || fread(head, 1, sizeof(head), fp) != sizeof(head)) {
+    return FALSE;
+  }
+
+  dio_input_init(&din, head, sizeof(head));
+  dio_get_sint32_raw(&din, &prec->turn);
+  dio_get_uint8_raw(&din, &flags);
+  dio_get_uint16_raw(&din, &prec->ntags);
+  dio_get_uint16_raw(&din, &prec->nplayers);
+
+  index_size = 2 * prec->nplayers;
+  if (len < sizeof(head) + index_size) {
+    return FALSE;
+  }
+  rest = len - sizeof(head) - index_size;
+  nvalues = (size_t) prec->ntags * prec->nplayers;
+
+  buf = fc_malloc(MAX(index_size, 1));
+  if (fread(buf, 1, index_size, fp) != index_size) {
+    free(buf);
+    return FALSE;
+  }
+  prec->players = fc_realloc(prec->players,
+                             MAX(prec->nplayers, 1) * sizeof(*prec->players));
+  dio_input_init(&din, buf, index_size);
+  for (p = 0; p < prec->nplayers; p++) {
+    dio_get_uint16_raw(&din, &value);
+    prec->players[p] = value;
+  }
+  free(buf);
+
+  if (!with_values) {
+    free(prec->values);
+    prec->values = NULL;
+    return fseek(fp, rest, SEEK_CUR) == 0;
+  }
+
+  buf = fc_malloc(MAX(rest, 1));
+  if (fread(buf, 1, rest, fp) != rest) {
+    free(buf);
+    return FALSE;
+  }
+
+  if (flags & SCORELOG_COLUMNS_COMPRESSED) {
+#ifdef FREECIV_HAVE_LIBZ
+    unsigned char *plain;
+    uLongf plain_size;
+    int raw_size;
+
+    dio_input_init(&din, buf, rest);
+    if (!dio_get_uint32_raw(&din, &raw_size) || (size_t) raw_size != 4 * nvalues) {
+      free(buf);
+      return FALSE;
+    }
+    plain_size = raw_size;
+    plain = fc_malloc(MAX(raw_size, 1));
+    if (uncompress(plain, &plain_size, buf + 4, rest - 4) != Z_OK
+        || plain_size != (uLongf) raw_size) {
+      free(plain);
+      free(buf);
+      return FALSE;
+    }
+    free(buf);
+    buf = plain;
+    rest = plain_size;
+#else  /* FREECIV_HAVE_LIBZ */
+    log_error("Scorelog: compressed data but no zlib support.");
+    free(buf);
+    return FALSE;
+#endif /* FREECIV_HAVE_LIBZ */
+  }
+
+  if (rest != 4 * nvalues) {
+    free(buf);
+    return FALSE;
+  }
+
+  prec->values = fc_realloc(prec->values,
+                            MAX(nvalues, 1) * sizeof(*prec->values));
+  dio_input_init(&din, buf, rest);
+  for (i = 0; i < nvalues; i++) {
+    dio_get_sint32_raw(&din, &prec->values[i]);
+  }
+  free(buf);
+
+  return TRUE;
+}
+
+/**************************************************************************
+  Free the arrays of a record filled by scorelog_binary_read().
+**************************************************************************/
+void scorelog_record_free(struct scorelog_record *prec)
+{
+  free(prec->players);
+  prec->players = NULL;
+  free(prec->values);
+  prec->values = NULL;
+  prec->ntags = 0;
+  prec->nplayers = 0;
+}
@@ -0,0 +1,91 @@
+/**********************************************************************
+ Freeciv - Copyright (C) 1996 - A Kjeldberg, L Gregersen, P Unold
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2, or (at your option)
+   any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+***********************************************************************/
+#ifndef FC__SCORELOG_H
+#define FC__SCORELOG_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include <stdio.h>              /* FILE */
+
+/* utility */
+#include "support.h"            /* bool type */
+
+/* Text scorelog (format version 2). The magic is followed by the
+ * version of the server that created the log. */
+#define SCORELOG_TEXT_MAGIC             "#FREECIV SCORELOG2 "
+
+/* Binary scorelog (format version 3). See doc/README.scorelog for the
+ * layout. The file is a sequence of records; all numbers are stored in
+ * network byte order. */
+
+#define SCORELOG_BINARY_MAGIC           "FCSCORE3"
+#define SCORELOG_BINARY_MAGIC_LEN       8
+
+/* Marks a missing value in a column (player not logged for that tag). */
+#define SCORELOG_NO_VALUE               (-2147483647 - 1)
+
+#define SCORELOG_MAX_TEXT               256
+
+enum scorelog_format {
+  SLF_TEXT = 0,
+  SLF_BINARY,
+  SLF_BINARY_ZLIB
+};
+
+enum scorelog_record_type {
+  SLR_END = 0,                  /* Only returned by the reader. */
+  SLR_VERSION = 'V',
+  SLR_ID = 'I',
+  SLR_TAG = 'G',
+  SLR_TURN = 'T',
+  SLR_ADDPLAYER = 'A',
+  SLR_DELPLAYER = 'D',
+  SLR_COLUMNS = 'C'
+};
+
+struct scorelog_record {
+  enum scorelog_record_type type;
+
+  int turn;                     /* SLR_TURN, SLR_*PLAYER, SLR_COLUMNS */
+  int year;                     /* SLR_TURN */
+  int id;                       /* Tag id (SLR_TAG), player number
+                                 * (SLR_ADDPLAYER, SLR_DELPLAYER) */
+  char text[SCORELOG_MAX_TEXT]; /* Version, game id, tag name, turn
+                                 * description or player name. */
+
+  /* SLR_COLUMNS: one column of 'nplayers' values for each of the 'ntags'
+   * tags. The value of player players[p] for tag t is
+   * values[t * nplayers + p]. */
+  int ntags;
+  int nplayers;
+  int *players;
+  int *values;
+};
+
+bool scorelog_text_write(FILE *fp, const struct scorelog_record *prec);
+
+bool scorelog_binary_check_magic(FILE *fp);
+bool scorelog_binary_write_magic(FILE *fp);
+bool scorelog_binary_write(FILE *fp, const struct scorelog_record *prec,
+                           bool compress);
+bool scorelog_binary_read(FILE *fp, struct scorelog_record *prec,
+                          bool with_values);
+void scorelog_record_free(struct scorelog_record *prec);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* FC__SCORELOG_H */
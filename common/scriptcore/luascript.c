@@ -27,6 +27,7 @@
 #include "astring.h"
 #include "log.h"
 #include "registry.h"
+#include "timing.h"
 
 /* common/scriptcore */
 #include "luascript_func.h"
@@ -36,10 +37,19 @@
 
 /*****************************************************************************
   Configuration for script execution time limits. Checkinterval is the
-  number of executed lua instructions between checking. Disabled if 0.
+  initial number of executed lua instructions between checking. Disabled
+  if 0. The interval is adapted to the measured execution speed so that
+  the check runs about every LUASCRIPT_CHECK_PERIOD_SEC seconds of the
+  monotonic clock, within the given minimum and maximum. The time limit
+  itself is on the CPU time of the thread running the script, so that
+  neither time spent waiting in C code (e.g. for the database in fcdb
+  scripts) nor the work of other threads counts.
 *****************************************************************************/
 #define LUASCRIPT_MAX_EXECUTION_TIME_SEC 5.0
 #define LUASCRIPT_CHECKINTERVAL 10000
+#define LUASCRIPT_CHECKINTERVAL_MIN 1000
+#define LUASCRIPT_CHECKINTERVAL_MAX 10000000
+#define LUASCRIPT_CHECK_PERIOD_SEC 0.01
 
 /* The name used for the freeciv lua struct saved in the lua state. */
 #define LUASCRIPT_GLOBAL_VAR_NAME "__fcl"
@@ -110,8 +120,8 @@ static int luascript_report(struct fc_lua *fcl, int status, const char *code);
 static void luascript_traceback_func_save(lua_State *L);
 static void luascript_traceback_func_push(lua_State *L);
 static void luascript_exec_check(lua_State *L, lua_Debug *ar);
-static void luascript_hook_start(lua_State *L);
-static void luascript_hook_end(lua_State *L);
+static void luascript_hook_start(struct fc_lua *fcl);
+static void luascript_hook_end(struct fc_lua *fcl);
 static void luascript_openlibs(lua_State *L, const luaL_Reg *llib);
 static void luascript_blacklist(lua_State *L, const char *lsymbols[]);
 
@@ -209,42 +219,81 @@ static void luascript_traceback_func_push(lua_State *L)
   lua_getfield(L, LUA_REGISTRYINDEX, "freeciv_traceback");
 }
 
+/*****************************************************************************
+  Return the monotonic clock in seconds, used to pace the execution time
+  checks.
+*****************************************************************************/
+static double luascript_exec_clock(void)
+{
+#ifdef CLOCK_MONOTONIC
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+#else
+  return (double) clock() / CLOCKS_PER_SEC;
+#endif
+}
+
 /*****************************************************************************
   Check currently excecuting lua function for execution time limit
 *****************************************************************************/
 static void luascript_exec_check(lua_State *L, lua_Debug *ar)
 {
-  lua_Number exec_clock;
-
-  lua_getfield(L, LUA_REGISTRYINDEX, "freeciv_exec_clock");
-  exec_clock = lua_tonumber(L, -1);
-  lua_pop(L, 1);
-  if ((float)(clock() - exec_clock)/CLOCKS_PER_SEC
+  /* The freeciv lua struct is kept in the extra space of the lua state
+   * (and of all its threads), so no registry lookup is needed here. */
+  struct fc_lua *fcl = *((struct fc_lua **) lua_getextraspace(L));
+  double now = luascript_exec_clock();
+  double period = now - fcl->exec.checked;
+  int interval = fcl->exec.interval;
+
+  if (timer_read_seconds(fcl->exec.timer)
       > LUASCRIPT_MAX_EXECUTION_TIME_SEC) {
     luaL_error(L, "Execution time limit exceeded in script");
   }
+
+  /* Adapt the check interval to the measured execution speed. */
+  if (period < LUASCRIPT_CHECK_PERIOD_SEC / 2) {
+    interval = MIN(interval * 2, LUASCRIPT_CHECKINTERVAL_MAX);
+  } else if (period > LUASCRIPT_CHECK_PERIOD_SEC * 2) {
+    interval = MAX(interval / 2, LUASCRIPT_CHECKINTERVAL_MIN);
+  }
+  if (interval != fcl->exec.interval) {
+    fcl->exec.interval = interval;
+    lua_sethook(L, luascript_exec_check, LUA_MASKCOUNT, interval);
+  }
+  fcl->exec.checked = now;
 }
 
 /*****************************************************************************
-  Setup function execution guard
+  Setup function execution guard. Nested calls (lua calling C code that
+  runs lua again) share the time limit of the outermost call.
 *****************************************************************************/
-static void luascript_hook_start(lua_State *L)
+static void luascript_hook_start(struct fc_lua *fcl)
 {
 #if LUASCRIPT_CHECKINTERVAL
-  /* Store clock timestamp in the registry */
-  lua_pushnumber(L, clock());
-  lua_setfield(L, LUA_REGISTRYINDEX, "freeciv_exec_clock");
-  lua_sethook(L, luascript_exec_check, LUA_MASKCOUNT, LUASCRIPT_CHECKINTERVAL);
+  if (fcl->exec.depth++ == 0) {
+    timer_clear(fcl->exec.timer);
+    timer_start(fcl->exec.timer);
+    fcl->exec.checked = luascript_exec_clock();
+    lua_sethook(fcl->state, luascript_exec_check, LUA_MASKCOUNT,
+                fcl->exec.interval);
+  }
 #endif
 }
 
 /*****************************************************************************
   Clear function execution guard
 *****************************************************************************/
-static void luascript_hook_end(lua_State *L)
+static void luascript_hook_end(struct fc_lua *fcl)
 {
 #if LUASCRIPT_CHECKINTERVAL
-  lua_sethook(L, luascript_exec_check, 0, 0);
+  fc_assert_ret(fcl->exec.depth > 0);
+
+  if (--fcl->exec.depth == 0) {
+    lua_sethook(fcl->state, luascript_exec_check, 0, 0);
+    timer_stop(fcl->exec.timer);
+  }
 #endif
 }
 
@@ -328,6 +377,12 @@ struct fc_lua *luascript_new(luascript_log_func_t output_fct)
   fcl->output_fct = output_fct;
   fcl->caller = NULL;
 
+  /* Execution time guard. */
+  *((struct fc_lua **) lua_getextraspace(fcl->state)) = fcl;
+  fcl->exec.timer = timer_new(TIMER_THREAD_CPU, TIMER_ACTIVE);
+  fcl->exec.interval = LUASCRIPT_CHECKINTERVAL;
+  fcl->exec.depth = 0;
+
   luascript_openlibs(fcl->state, luascript_lualibs);
   luascript_traceback_func_save(fcl->state);
   luascript_blacklist(fcl->state, luascript_unsafe_symbols);
@@ -379,6 +434,7 @@ void luascript_destroy(struct fc_lua *fcl)
       lua_gc(fcl->state, LUA_GCCOLLECT, 0); /* Collected garbage */
       lua_close(fcl->state);
     }
+    timer_destroy(fcl->exec.timer);
     free(fcl);
   }
 }
@@ -523,9 +579,9 @@ int luascript_call(struct fc_lua *fcl, int narg, int nret, const char *code)
     lua_pop(fcl->state, 1);   /* pop non-function traceback */
   }
 
-  luascript_hook_start(fcl->state);
+  luascript_hook_start(fcl);
   status = lua_pcall(fcl->state, narg, nret, traceback);
-  luascript_hook_end(fcl->state);
+  luascript_hook_end(fcl);
 
   if (status) {
     luascript_report(fcl, status, code);
@@ -617,6 +673,51 @@ bool luascript_callback_invoke(struct fc_lua *fcl, const char *callback_name,
   return stop_emission;
 }
 
+/*****************************************************************************
+  Invoke the 'callback_name' Lua function with the 'nargs' values on top
+  of the stack as arguments. The arguments are copied and left on the
+  stack, so several callbacks can share one set of pushed arguments.
+*****************************************************************************/
+bool luascript_callback_invoke_stack(struct fc_lua *fcl,
+                                     const char *callback_name, int nargs)
+{
+  bool stop_emission = FALSE;
+  int i;
+
+  fc_assert_ret_val(fcl, FALSE);
+  fc_assert_ret_val(fcl->state, FALSE);
+
+  /* The function name */
+  lua_getglobal(fcl->state, callback_name);
+
+  if (!lua_isfunction(fcl->state, -1)) {
+    luascript_log(fcl, LOG_ERROR, "lua error: Unknown callback '%s'",
+                  callback_name);
+    lua_pop(fcl->state, 1);
+    return FALSE;
+  }
+
+  luascript_log(fcl, LOG_DEBUG, "lua callback: '%s'", callback_name);
+
+  /* Each copy moves the next argument to the same relative index. */
+  for (i = 0; i < nargs; i++) {
+    lua_pushvalue(fcl->state, -1 - nargs);
+  }
+
+  /* Call the function with nargs arguments, return 1 results */
+  if (luascript_call(fcl, nargs, 1, NULL)) {
+    return FALSE;
+  }
+
+  /* Shall we stop the emission of this signal? */
+  if (lua_isboolean(fcl->state, -1)) {
+    stop_emission = lua_toboolean(fcl->state, -1);
+  }
+  lua_pop(fcl->state, 1);   /* pop return value */
+
+  return stop_emission;
+}
+
 /*****************************************************************************
   Mark any, if exported, full userdata representing 'object' in
   the current script state as 'Nonexistent'.
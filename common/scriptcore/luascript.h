@@ -35,6 +35,7 @@ struct luascript_signal_hash;
 struct luascript_signal_name_list;
 struct connection;
 struct fc_lua;
+struct timer;
 
 typedef void (*luascript_log_func_t) (struct fc_lua *fcl,
                                       enum log_level level,
@@ -52,6 +53,17 @@ struct fc_lua {
 
   struct luascript_signal_hash *signals;
   struct luascript_signal_name_list *signal_names;
+  struct timer *signal_timer;  /* always running thread CPU timer of the
+                                * thread emitting the signals, times the
+                                * callbacks */
+
+  /* Script execution time guard. */
+  struct {
+    struct timer *timer;   /* thread CPU time of the outermost call */
+    double checked;        /* monotonic clock at the last check */
+    int interval;          /* lua instructions between checks */
+    int depth;             /* nesting level of luascript_call() */
+  } exec;
 };
 
 /* Error functions for lua scripts. */
@@ -84,6 +96,8 @@ int luascript_do_file(struct fc_lua *fcl, const char *filename);
 bool luascript_callback_invoke(struct fc_lua *fcl, const char *callback_name,
                                int nargs, enum api_types *parg_types,
                                va_list args);
+bool luascript_callback_invoke_stack(struct fc_lua *fcl,
+                                     const char *callback_name, int nargs);
 
 void luascript_remove_exported_object(struct fc_lua *fcl, void *object);
 
@@ -27,7 +27,9 @@
   * A callback can stop the current signal emission, preventing the callbacks
     connected after it from being invoked.
 
-  * A callback can detach itself from its associated signal.
+  * A callback can detach itself from its associated signal. Callbacks
+    detached during an emission are only marked as removed, and freed once
+    the outermost emission of the signal is over.
 
   Lua callbacks functions are able to do these via their return values.
 
@@ -46,6 +48,7 @@
 /* utility */
 #include "deprecations.h"
 #include "log.h"
+#include "timing.h"
 
 /* common/scriptcore */
 #include "luascript.h"
@@ -77,11 +80,15 @@ struct signal {
   enum api_types *arg_types;              /* argument types */
   struct signal_callback_list *callbacks; /* connected callbacks */
   char *depr_msg;                         /* deprecation message to show if handler added */
+  int emitting;                           /* nesting depth of emissions */
 };
 
 /* Signal callback datastructure. */
 struct signal_callback {
   char *name;                             /* callback function name */
+  int calls;                              /* number of invocations */
+  double seconds;                         /* CPU time spent in the callback */
+  bool removed;                           /* detached during an emission */
 };
 
 /*****************************************************************************
@@ -116,6 +123,9 @@ static struct signal_callback *signal_callback_new(const char *name)
   struct signal_callback *pcallback = fc_malloc(sizeof(*pcallback));
 
   pcallback->name = fc_strdup(name);
+  pcallback->calls = 0;
+  pcallback->seconds = 0.0;
+  pcallback->removed = FALSE;
   return pcallback;
 }
 
@@ -128,6 +138,14 @@ static void signal_callback_destroy(struct signal_callback *pcallback)
   free(pcallback);
 }
 
+/*****************************************************************************
+  Return whether the callback was detached during an emission.
+*****************************************************************************/
+static bool signal_callback_removed(const struct signal_callback *pcallback)
+{
+  return pcallback->removed;
+}
+
 /*****************************************************************************
   Create a new signal.
 *****************************************************************************/
@@ -140,6 +158,7 @@ static struct signal *signal_new(int nargs, enum api_types *parg_types)
   psignal->callbacks
     = signal_callback_list_new_full(signal_callback_destroy);
   psignal->depr_msg = NULL;
+  psignal->emitting = 0;
 
   return psignal;
 }
@@ -175,18 +194,52 @@ void luascript_signal_emit_valist(struct fc_lua *fcl, const char *signal_name,
       luascript_log(fcl, LOG_ERROR, "Signal \"%s\" requires %d args but was "
                                     "passed %d on invoke.", signal_name,
                     psignal->nargs, nargs);
-    } else {
-      signal_callback_list_iterate(psignal->callbacks, pcallback) {
-        va_list args_cb;
-
-        va_copy(args_cb, args);
-        if (luascript_callback_invoke(fcl, pcallback->name, nargs,
-                                      psignal->arg_types, args_cb)) {
-          va_end(args_cb);
-          break;
+    } else if (signal_callback_list_size(psignal->callbacks) > 0) {
+      /* The arguments are converted to Lua values once per emission and
+       * shared by all callbacks. Signals without callbacks skip this. */
+      int top = lua_gettop(fcl->state);
+
+      luascript_push_args(fcl, nargs, psignal->arg_types, args);
+
+      if (lua_gettop(fcl->state) - top == nargs) {
+        /* Callbacks detached while we iterate stay in the list until the
+         * end of the emission; see luascript_signal_callback(). Those
+         * connected meanwhile are appended, and only called from the
+         * next emission on. */
+        int left = signal_callback_list_size(psignal->callbacks);
+
+        psignal->emitting++;
+        signal_callback_list_iterate(psignal->callbacks, pcallback) {
+          double start;
+          bool stop;
+
+          if (0 > --left) {
+            break;
+          }
+          if (pcallback->removed) {
+            continue;
+          }
+
+          start = timer_read_seconds(fcl->signal_timer);
+          stop = luascript_callback_invoke_stack(fcl, pcallback->name,
+                                                 nargs);
+          pcallback->calls++;
+          pcallback->seconds += timer_read_seconds(fcl->signal_timer)
+                                - start;
+
+          if (stop) {
+            break;
+          }
+        } signal_callback_list_iterate_end;
+        psignal->emitting--;
+
+        if (0 == psignal->emitting) {
+          signal_callback_list_remove_all_if(psignal->callbacks,
+                                             signal_callback_removed);
         }
-        va_end(args_cb);
-      } signal_callback_list_iterate_end;
+      }
+
+      lua_settop(fcl->state, top);
     }
   } else {
     luascript_log(fcl, LOG_ERROR, "Signal \"%s\" does not exist, so cannot "
@@ -303,7 +356,7 @@ void luascript_signal_callback(struct fc_lua *fcl, const char *signal_name,
   if (luascript_signal_hash_lookup(fcl->signals, signal_name, &psignal)) {
     /* check for a duplicate callback */
     signal_callback_list_iterate(psignal->callbacks, pcallback) {
-      if (!strcmp(pcallback->name, callback_name)) {
+      if (!pcallback->removed && !strcmp(pcallback->name, callback_name)) {
         pcallback_found = pcallback;
         break;
       }
@@ -322,8 +375,11 @@ void luascript_signal_callback(struct fc_lua *fcl, const char *signal_name,
         signal_callback_list_append(psignal->callbacks,
                                     signal_callback_new(callback_name));
       }
-    } else {
-      if (pcallback_found) {
+    } else if (pcallback_found) {
+      if (0 < psignal->emitting) {
+        /* Freeing it now would pull it from under the emission. */
+        pcallback_found->removed = TRUE;
+      } else {
         signal_callback_list_remove(psignal->callbacks, pcallback_found);
       }
     }
@@ -348,7 +404,7 @@ bool luascript_signal_callback_defined(struct fc_lua *fcl,
   if (luascript_signal_hash_lookup(fcl->signals, signal_name, &psignal)) {
     /* check for a duplicate callback */
     signal_callback_list_iterate(psignal->callbacks, pcallback) {
-      if (!strcmp(pcallback->name, callback_name)) {
+      if (!pcallback->removed && !strcmp(pcallback->name, callback_name)) {
         return TRUE;
       }
     } signal_callback_list_iterate_end;
@@ -376,6 +432,8 @@ void luascript_signal_init(struct fc_lua *fcl)
   if (NULL == fcl->signals) {
     fcl->signals = luascript_signal_hash_new();
     fcl->signal_names = luascript_signal_name_list_new_full(sn_free);
+    fcl->signal_timer = timer_new(TIMER_THREAD_CPU, TIMER_ACTIVE);
+    timer_start(fcl->signal_timer);
   }
 }
 
@@ -389,7 +447,10 @@ void luascript_signal_free(struct fc_lua *fcl)
 
     luascript_signal_name_list_destroy(fcl->signal_names);
 
+    timer_destroy(fcl->signal_timer);
+
     fcl->signals = NULL;
+    fcl->signal_timer = NULL;
   }
 }
 
@@ -427,3 +488,31 @@ const char *luascript_signal_callback_by_index(struct fc_lua *fcl,
 
   return NULL;
 }
+
+/*****************************************************************************
+  Get the number of invocations of the 'index' callback function of the
+  signal with the name 'signal_name' and the time spent in it. Returns
+  FALSE if there is no such callback.
+*****************************************************************************/
+bool luascript_signal_callback_stats(struct fc_lua *fcl,
+                                     const char *signal_name, int sindex,
+                                     int *calls, double *seconds)
+{
+  struct signal *psignal;
+
+  fc_assert_ret_val(fcl != NULL, FALSE);
+  fc_assert_ret_val(fcl->signals != NULL, FALSE);
+
+  if (luascript_signal_hash_lookup(fcl->signals, signal_name, &psignal)) {
+    struct signal_callback *pcallback
+      = signal_callback_list_get(psignal->callbacks, sindex);
+
+    if (pcallback) {
+      *calls = pcallback->calls;
+      *seconds = pcallback->seconds;
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
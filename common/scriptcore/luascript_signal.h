@@ -45,6 +45,9 @@ const char *luascript_signal_by_index(struct fc_lua *fcl, int sindex);
 const char *luascript_signal_callback_by_index(struct fc_lua *fcl,
                                                const char *signal_name,
                                                int sindex);
+bool luascript_signal_callback_stats(struct fc_lua *fcl,
+                                     const char *signal_name, int sindex,
+                                     int *calls, double *seconds);
 
 #ifdef __cplusplus
 }
@@ -64,12 +64,24 @@ struct tile *tile_claimer(const struct tile *ptile)
 #endif
 
 /****************************************************************************
-  Set the owner of a tile (may be NULL).
+  Set the owner of a tile (may be NULL). For tiles of the main map this
+  also keeps player->owned_tiles up to date.
 ****************************************************************************/
 void tile_set_owner(struct tile *ptile, struct player *pplayer,
                     struct tile *claimer)
 {
   if (BORDERS_DISABLED != game.info.borders) {
+    if (ptile->owner != pplayer
+        && !map_is_empty()
+        && 0 <= tile_index(ptile) && tile_index(ptile) < map_num_tiles()
+        && ptile == wld.map.tiles + tile_index(ptile)) {
+      if (ptile->owner != NULL) {
+        ptile->owner->owned_tiles--;
+      }
+      if (pplayer != NULL) {
+        pplayer->owned_tiles++;
+      }
+    }
     ptile->owner = pplayer;
     ptile->claimer = claimer;
   }
@@ -49,3 +49,16 @@ static void func(void)
     AC_DEFINE([HAVE_AT_QUICK_EXIT], [1], [C11 at_quick_exit() available])
   fi
 ])
+
+# Check for C11 _Thread_local
+#
+AC_DEFUN([FC_C11_THREAD_LOCAL],
+[
+  AC_CACHE_CHECK([for C11 _Thread_local], [ac_cv_c11_thread_local],
+    [AC_LINK_IFELSE([AC_LANG_PROGRAM([[static _Thread_local int counter;
+]], [[ counter++; ]])],
+[ac_cv_c11_thread_local=yes], [ac_cv_c11_thread_local=no])])
+  if test "x${ac_cv_c11_thread_local}" = "xyes" ; then
+    AC_DEFINE([FREECIV_C11_THREAD_LOCAL], [1], [C11 _Thread_local supported])
+  fi
+])
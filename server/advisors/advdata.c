@@ -63,6 +63,45 @@ static void adv_dipl_free(const struct player *plr1,
 static struct adv_dipl *adv_dipl_get(const struct player *plr1,
                                      const struct player *plr2);
 
+/**************************************************************************
+  Mark the output types of worked tiles and specialists that the effect
+  may change. Effects without an output type requirement may change
+  all of them.
+**************************************************************************/
+static void adv_data_impr_tile_outputs(const struct effect *peffect,
+                                       bool *outputs)
+{
+  switch (peffect->type) {
+  case EFT_MINING_PCT:
+    outputs[O_SHIELD] = TRUE;
+    return;
+  case EFT_IRRIGATION_PCT:
+    outputs[O_FOOD] = TRUE;
+    return;
+  case EFT_OUTPUT_ADD_TILE:
+  case EFT_OUTPUT_PENALTY_TILE:
+  case EFT_OUTPUT_INC_TILE_CELEBRATE:
+  case EFT_OUTPUT_INC_TILE:
+  case EFT_OUTPUT_PER_TILE:
+  case EFT_OUTPUT_TILE_PUNISH_PCT:
+  case EFT_SPECIALIST_OUTPUT:
+    break;
+  default:
+    return;
+  }
+
+  requirement_vector_iterate(&peffect->reqs, preq) {
+    if (VUT_OTYPE == preq->source.kind && preq->present) {
+      outputs[preq->source.value.outputtype] = TRUE;
+      return;
+    }
+  } requirement_vector_iterate_end;
+
+  output_type_iterate(o) {
+    outputs[o] = TRUE;
+  } output_type_iterate_end;
+}
+
 /**************************************************************************
   Precalculates some important data about the improvements in the game
   that we use later in ai/aicity.c.  We mark improvements as 'calculate'
@@ -85,9 +124,15 @@ static void adv_data_city_impr_calc(struct player *pplayer,
     };
 
     adv->impr_calc[improvement_index(pimprove)] = ADV_IMPR_ESTIMATE;
+    output_type_iterate(o) {
+      adv->impr_tile_outputs[improvement_index(pimprove)][o] = FALSE;
+    } output_type_iterate_end;
 
     /* Find largest extension */
     effect_list_iterate(get_req_source_effects(&source), peffect) {
+      adv_data_impr_tile_outputs(peffect,
+                                 adv->impr_tile_outputs[improvement_index(pimprove)]);
+
       switch (peffect->type) {
 #if 0
       /* TODO */
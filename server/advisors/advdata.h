@@ -52,6 +52,8 @@ struct adv_data {
   /* Precalculated info about city improvements */
   enum adv_improvement_status impr_calc[MAX_NUM_ITEMS];
   enum req_range impr_range[MAX_NUM_ITEMS];
+  /* Output types of tiles and specialists the improvement may change */
+  bool impr_tile_outputs[MAX_NUM_ITEMS][O_LAST];
 
   /* Long-term threats, not to be confused with short-term danger */
   struct {
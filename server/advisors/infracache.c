@@ -17,9 +17,15 @@
 
 /* common */
 #include "city.h"
+#include "effects.h"
 #include "game.h"
+#include "government.h"
+#include "improvement.h"
 #include "map.h"
+#include "multipliers.h"
 #include "player.h"
+#include "requirements.h"
+#include "research.h"
 #include "tile.h"
 
 /* server */
@@ -36,8 +42,15 @@ struct worker_activity_cache {
   int act[ACTIVITY_LAST];
   int extra[MAX_EXTRA_TYPES];
   int rmextra[MAX_EXTRA_TYPES];
+
+  /* Signature of the tile state the values above were calculated for.
+   * Only meaningful if 'valid' is set. */
+  bool valid;
+  unsigned int tile_sig;
 };
 
+#define INFRA_SIG_INIT 2166136261u
+
 static int adv_calc_irrigate_transform(const struct city *pcity,
                                        const struct tile *ptile);
 static int adv_calc_mine_transform(const struct city *pcity, const struct tile *ptile);
@@ -233,55 +246,340 @@ static int adv_calc_rmextra(const struct city *pcity, const struct tile *ptile,
   return goodness;
 }
 
+/**************************************************************************
+  Fold an integer into a cache signature (FNV-1a style).
+**************************************************************************/
+static inline unsigned int infra_sig_add(unsigned int sig, int val)
+{
+  int i;
+
+  for (i = 0; i < 4; i++) {
+    sig ^= (val >> (i * 8)) & 0xff;
+    sig *= 16777619u;
+  }
+
+  return sig;
+}
+
+/**************************************************************************
+  Fold the parts of the tile state that adv_calc_*() depends on into
+  a cache signature.
+**************************************************************************/
+static unsigned int infra_sig_add_tile(unsigned int sig,
+                                       const struct tile *ptile)
+{
+  const struct player *owner = tile_owner(ptile);
+  const struct extra_type *presource = tile_resource(ptile);
+  int i;
+
+  sig = infra_sig_add(sig, terrain_index(tile_terrain(ptile)));
+  sig = infra_sig_add(sig, NULL != owner ? player_index(owner) : -1);
+  sig = infra_sig_add(sig, NULL != presource ? extra_index(presource) : -1);
+  for (i = 0; i < ARRAY_SIZE(ptile->extras.vec); i++) {
+    sig = infra_sig_add(sig, ptile->extras.vec[i]);
+  }
+
+  return sig;
+}
+
+/**************************************************************************
+  Signature of everything on and around the tile that the cached values
+  of the tile depend on. Adjacent tiles are included since both terrain
+  changes and extra requirements can depend on them.
+**************************************************************************/
+static unsigned int infra_tile_sig(const struct tile *ptile)
+{
+  const struct city *wcity = tile_worked(ptile);
+  const struct city *tcity = tile_city(ptile);
+  unsigned int sig = INFRA_SIG_INIT;
+
+  sig = infra_sig_add_tile(sig, ptile);
+  sig = infra_sig_add(sig, NULL != wcity ? wcity->id : 0);
+  sig = infra_sig_add(sig, NULL != tcity ? tcity->id : 0);
+
+  adjc_iterate(ptile, adjc_tile) {
+    sig = infra_sig_add_tile(sig, adjc_tile);
+  } adjc_iterate_end;
+
+  return sig;
+}
+
+/**************************************************************************
+  Signature of the player wide state the cached values depend on: known
+  technologies, government, AI skill level, multipliers and wonders
+  (which may give bonuses beyond the city they are in).
+**************************************************************************/
+static unsigned int infra_player_sig(const struct player *pplayer)
+{
+  const struct research *presearch = research_get(pplayer);
+  unsigned int sig = INFRA_SIG_INIT;
+
+  sig = infra_sig_add(sig, player_index(pplayer));
+  /* The set of known techs, not just their number, which stays the same
+   * when one tech is lost and another gained. */
+  advance_index_iterate(A_FIRST, i) {
+    if (research_invention_state(presearch, i) == TECH_KNOWN) {
+      sig = infra_sig_add(sig, i);
+    }
+  } advance_index_iterate_end;
+  sig = infra_sig_add(sig, presearch->future_tech);
+  sig = infra_sig_add(sig, government_number(government_of_player(pplayer)));
+  sig = infra_sig_add(sig, pplayer->ai_common.skill_level);
+
+  multipliers_iterate(pmul) {
+    sig = infra_sig_add(sig, pplayer->multipliers[multiplier_index(pmul)]);
+  } multipliers_iterate_end;
+
+  improvement_iterate(pimprove) {
+    if (is_great_wonder(pimprove)) {
+      const struct player *owner = great_wonder_owner(pimprove);
+
+      sig = infra_sig_add(sig, NULL != owner ? player_index(owner) : -1);
+    }
+  } improvement_iterate_end;
+
+  city_list_iterate(pplayer->cities, pcity) {
+    city_built_iterate(pcity, pimprove) {
+      if (is_wonder(pimprove)) {
+        sig = infra_sig_add(sig, improvement_index(pimprove));
+      }
+    } city_built_iterate_end;
+  } city_list_iterate_end;
+
+  return sig;
+}
+
+/**************************************************************************
+  Signature of the city bonuses the cached values depend on.
+**************************************************************************/
+static unsigned int infra_city_sig(const struct city *pcity,
+                                   unsigned int player_sig)
+{
+  unsigned int sig = player_sig;
+
+  sig = infra_sig_add(sig, city_size_get(pcity));
+  sig = infra_sig_add(sig, city_celebrating(pcity));
+  city_built_iterate(pcity, pimprove) {
+    sig = infra_sig_add(sig, improvement_index(pimprove));
+  } city_built_iterate_end;
+
+  return sig;
+}
+
+/**************************************************************************
+  Can the value of a requirement of this kind only change when one of
+  the signatures above changes? Unit requirements are never active for
+  the tile output, so they can't change either.
+**************************************************************************/
+static bool infra_req_kind_tracked(enum universals_n kind)
+{
+  switch (kind) {
+  case VUT_NONE:
+  case VUT_ADVANCE:
+  case VUT_TECHFLAG:
+  case VUT_MINTECHS:
+  case VUT_GOVERNMENT:
+  case VUT_IMPROVEMENT:
+  case VUT_IMPR_GENUS:
+  case VUT_MINSIZE:
+  case VUT_AI_LEVEL:
+  case VUT_NATION:
+  case VUT_NATIONGROUP:
+  case VUT_TERRAIN:
+  case VUT_TERRAINCLASS:
+  case VUT_TERRAINALTER:
+  case VUT_TERRFLAG:
+  case VUT_EXTRA:
+  case VUT_EXTRAFLAG:
+  case VUT_BASEFLAG:
+  case VUT_ROADFLAG:
+  case VUT_CITYTILE:
+  case VUT_TOPO:
+  case VUT_OTYPE:
+  case VUT_SPECIALIST:
+  case VUT_UTYPE:
+  case VUT_UTFLAG:
+  case VUT_UCLASS:
+  case VUT_UCFLAG:
+  case VUT_UNITSTATE:
+  case VUT_MINMOVES:
+  case VUT_MINVETERAN:
+  case VUT_MINHP:
+  case VUT_ACTION:
+    return TRUE;
+  default:
+    /* E.g. MinYear, DiplRel, Nationality, MinCulture, Age. */
+    return FALSE;
+  }
+}
+
+/**************************************************************************
+  Are all requirements in the vector tracked by the signatures?
+**************************************************************************/
+static bool infra_reqs_tracked(const struct requirement_vector *reqs)
+{
+  requirement_vector_iterate(reqs, preq) {
+    if (!infra_req_kind_tracked(preq->source.kind)) {
+      return FALSE;
+    }
+  } requirement_vector_iterate_end;
+
+  return TRUE;
+}
+
+/**************************************************************************
+  Are all requirements of the effects used by city_tile_value() and the
+  terrain changes tracked by the signatures? If not, no value can be
+  reused.
+**************************************************************************/
+static bool infra_effects_tracked(void)
+{
+  static const enum effect_type tile_effects[] = {
+    EFT_OUTPUT_ADD_TILE, EFT_OUTPUT_PENALTY_TILE,
+    EFT_OUTPUT_INC_TILE_CELEBRATE, EFT_OUTPUT_INC_TILE,
+    EFT_OUTPUT_PER_TILE, EFT_OUTPUT_TILE_PUNISH_PCT,
+    EFT_MINING_PCT, EFT_IRRIGATION_PCT, EFT_TILE_WORKABLE,
+    EFT_IRRIG_POSSIBLE, EFT_MINING_POSSIBLE, EFT_IRRIG_TF_POSSIBLE,
+    EFT_MINING_TF_POSSIBLE
+  };
+  int i;
+
+  for (i = 0; i < ARRAY_SIZE(tile_effects); i++) {
+    effect_list_iterate(get_effects(tile_effects[i]), peffect) {
+      if (!infra_reqs_tracked(&peffect->reqs)) {
+        return FALSE;
+      }
+    } effect_list_iterate_end;
+  }
+
+  return TRUE;
+}
+
+/**************************************************************************
+  Calculate the values of building and removing the extra on one city
+  tile.
+**************************************************************************/
+static void infra_cache_calc_extra(struct city *pcity, int cindex,
+                                   const struct tile *ptile,
+                                   struct extra_type *pextra)
+{
+  /* We have no use for extra value, if workers cannot be assigned
+   * to build it, so don't use time to calculate values otherwise */
+  if (pextra->buildable
+      && is_extra_caused_by_worker_action(pextra)) {
+    adv_city_worker_extra_set(pcity, cindex, pextra,
+                              adv_calc_extra(pcity, ptile, pextra));
+  } else {
+    adv_city_worker_extra_set(pcity, cindex, pextra, 0);
+  }
+  if (tile_has_extra(ptile, pextra) && is_extra_removed_by_worker_action(pextra)) {
+    adv_city_worker_rmextra_set(pcity, cindex, pextra,
+                                adv_calc_rmextra(pcity, ptile, pextra));
+  } else {
+    adv_city_worker_rmextra_set(pcity, cindex, pextra, 0);
+  }
+}
+
+/**************************************************************************
+  Do all tile improvement calculations for one city tile.
+**************************************************************************/
+static void infra_cache_calc_tile(struct city *pcity, int cindex,
+                                  const struct tile *ptile)
+{
+  adv_city_worker_act_set(pcity, cindex, ACTIVITY_MINE,
+                          adv_calc_mine_transform(pcity, ptile));
+  adv_city_worker_act_set(pcity, cindex, ACTIVITY_IRRIGATE,
+                          adv_calc_irrigate_transform(pcity, ptile));
+  adv_city_worker_act_set(pcity, cindex, ACTIVITY_TRANSFORM,
+                          adv_calc_transform(pcity, ptile));
+
+  /* road_bonus() is handled dynamically later; it takes into
+   * account settlers that have already been assigned to building
+   * roads this turn. */
+  extra_type_iterate(pextra) {
+    infra_cache_calc_extra(pcity, cindex, ptile, pextra);
+  } extra_type_iterate_end;
+}
+
 /**************************************************************************
   Do all tile improvement calculations and cache them for later.
 
   These values are used in settler_evaluate_improvements() so this function
   must be called before doing that.  Currently this is only done when handling
   auto-settlers or when the AI contemplates building worker units.
+
+  The values are kept between calls. Only tiles whose own state (terrain,
+  extras, owner, working city) or the state of their neighbours changed
+  are recalculated, unless the bonuses of the city itself changed, in
+  which case the whole city map is recalculated. Values that depend on
+  requirements the signatures don't track (e.g. MinYear) are always
+  recalculated.
 **************************************************************************/
 void initialize_infrastructure_cache(struct player *pplayer)
 {
+  unsigned int player_sig = infra_player_sig(pplayer);
+  bool effects_tracked = infra_effects_tracked();
+  bool extra_tracked[MAX_EXTRA_TYPES];
+  int recalculated = 0, reused = 0;
+
+  extra_type_iterate(pextra) {
+    extra_tracked[extra_index(pextra)]
+      = (infra_reqs_tracked(&pextra->reqs)
+         && infra_reqs_tracked(&pextra->rmreqs));
+  } extra_type_iterate_end;
+
   city_list_iterate(pplayer->cities, pcity) {
     struct tile *pcenter = city_tile(pcity);
     int radius_sq = city_map_radius_sq_get(pcity);
+    unsigned int city_sig = infra_city_sig(pcity, player_sig);
+    bool city_changed;
+
+    if (pcity->server.adv->act_cache_radius_sq != radius_sq) {
+      adv_city_update(pcity);
+    }
+
+    city_changed = (!effects_tracked
+                    || city_sig != pcity->server.adv->act_cache_city_sig);
+    pcity->server.adv->act_cache_city_sig = city_sig;
+
+    city_map_iterate(radius_sq, cindex, city_x, city_y) {
+      struct worker_activity_cache *pcache
+        = &(pcity->server.adv->act_cache[cindex]);
+      struct tile *ptile = city_map_to_tile(pcenter, radius_sq,
+                                            city_x, city_y);
+      unsigned int tile_sig;
+
+      if (NULL == ptile) {
+        as_transform_activity_iterate(act) {
+          adv_city_worker_act_set(pcity, cindex, act, -1);
+        } as_transform_activity_iterate_end;
+        pcache->valid = FALSE;
+        continue;
+      }
+
+      tile_sig = infra_tile_sig(ptile);
+      if (!city_changed && pcache->valid && pcache->tile_sig == tile_sig) {
+        extra_type_iterate(pextra) {
+          if (!extra_tracked[extra_index(pextra)]) {
+            infra_cache_calc_extra(pcity, cindex, ptile, pextra);
+          }
+        } extra_type_iterate_end;
+        reused++;
+        continue;
+      }
 
-    city_map_iterate(radius_sq, city_index, city_x, city_y) {
       as_transform_activity_iterate(act) {
-        adv_city_worker_act_set(pcity, city_index, act, -1);
+        adv_city_worker_act_set(pcity, cindex, act, -1);
       } as_transform_activity_iterate_end;
+      infra_cache_calc_tile(pcity, cindex, ptile);
+      pcache->tile_sig = tile_sig;
+      pcache->valid = TRUE;
+      recalculated++;
     } city_map_iterate_end;
-
-    city_tile_iterate_index(radius_sq, pcenter, ptile, cindex) {
-      adv_city_worker_act_set(pcity, cindex, ACTIVITY_MINE,
-                              adv_calc_mine_transform(pcity, ptile));
-      adv_city_worker_act_set(pcity, cindex, ACTIVITY_IRRIGATE,
-                              adv_calc_irrigate_transform(pcity, ptile));
-      adv_city_worker_act_set(pcity, cindex, ACTIVITY_TRANSFORM,
-                              adv_calc_transform(pcity, ptile));
-
-      /* road_bonus() is handled dynamically later; it takes into
-       * account settlers that have already been assigned to building
-       * roads this turn. */
-      extra_type_iterate(pextra) {
-        /* We have no use for extra value, if workers cannot be assigned
-         * to build it, so don't use time to calculate values otherwise */
-        if (pextra->buildable
-            && is_extra_caused_by_worker_action(pextra)) {
-          adv_city_worker_extra_set(pcity, cindex, pextra,
-                                    adv_calc_extra(pcity, ptile, pextra));
-        } else {
-          adv_city_worker_extra_set(pcity, cindex, pextra, 0);
-        }
-        if (tile_has_extra(ptile, pextra) && is_extra_removed_by_worker_action(pextra)) {
-          adv_city_worker_rmextra_set(pcity, cindex, pextra,
-                                      adv_calc_rmextra(pcity, ptile, pextra));
-        } else {
-          adv_city_worker_rmextra_set(pcity, cindex, pextra, 0);
-        }
-      } extra_type_iterate_end;
-    } city_tile_iterate_index_end;
   } city_list_iterate_end;
+
+  log_verbose("%s infrastructure cache: %d entries recalculated, "
+              "%d reused.", player_name(pplayer), recalculated, reused);
 }
 
 /**************************************************************************
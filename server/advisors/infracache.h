@@ -23,6 +23,8 @@ struct adv_city {
    * a particular activity on a particular tile. */
   struct worker_activity_cache *act_cache;
   int act_cache_radius_sq;
+  /* Signature of the city bonuses act_cache was calculated with. */
+  unsigned int act_cache_city_sig;
 
   /* building desirabilities - easiest to handle them here -- Syela */
   /* The units of building_want are output
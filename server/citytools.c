@@ -3174,6 +3174,8 @@ bool city_map_update_radius_sq(struct city *pcity)
   citylog_map_workers(LOG_DEBUG, pcity);
 
   city_map_radius_sq_set(pcity, city_radius_sq_new);
+  /* Tiles the city claims permanently depend on its radius. */
+  map_border_source_dirty(city_tile(pcity));
 
   if (city_tiles_old < city_tiles_new) {
     /* increased number of city tiles */
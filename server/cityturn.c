@@ -771,6 +771,7 @@ bool city_reduce_size(struct city *pcity, citizens pop_loss,
   city_size_add(pcity, -pop_loss);
   map_update_border(pcity->tile, pcity->owner, old_radius_sq,
                     tile_border_source_radius_sq(pcity->tile));
+  map_border_source_dirty(pcity->tile);
 
   /* Cap the food stock at the new granary size. */
   if (pcity->food_stock > city_granary_size(city_size_get(pcity))) {
@@ -902,6 +903,7 @@ static bool city_increase_size(struct city *pcity, struct player *nationality)
   }
 
   city_size_add(pcity, 1);
+  map_border_source_dirty(pcity->tile);
 
   /* Do not empty food stock if city is growing by celebrating */
   if (rapture_grow) {
@@ -203,7 +203,9 @@ static struct command commands[] = {
       "debug city <x> <y>\n"
       "debug units <x> <y>\n"
       "debug unit <id>\n"
-      "debug timing\n"
+      "debug timing [on|off|dump <file>]\n"
+      "debug trace <file>|off\n"
+      "debug memory [dump <file>|off]\n"
       "debug info"),
    N_("Turn on or off AI debugging of given entity."),
    N_("Print AI debug information about given entity and turn continuous "
@@ -620,9 +622,14 @@ static struct command commands[] = {
    /* TRANS: translate text between <> only */
    N_("lua cmd <script line>\n"
       "lua file <script file>\n"
+      "lua stats\n"
       "lua <script line> (deprecated)"),
    N_("Evaluate a line of Freeciv script or a Freeciv script file in the "
-      "current game."), NULL, NULL,
+      "current game."),
+   N_("'lua stats' lists the connected signal callbacks with the number "
+      "of times each was called and the CPU time spent in it. 'stats' is "
+      "not abbreviated and takes no arguments; anything else is run as a "
+      "deprecated script line."), NULL,
    CMD_ECHO_ADMINS, VCF_NONE, 0
   },
   {"kick", ALLOW_CTRL,
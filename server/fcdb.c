@@ -168,7 +168,7 @@ bool fcdb_init(const char *conf_file)
     log_debug("No fcdb config file.");
   }
 
-  return script_fcdb_init(NULL);
+  return script_fcdb_init(fcdb_option_get("script"));
 }
 
 /****************************************************************************
@@ -178,7 +178,8 @@ const char *fcdb_option_get(const char *type)
 {
   struct fcdb_option *opt;
 
-  if (fcdb_option_hash_lookup(fcdb_config, type, &opt)) {
+  if (fcdb_config != NULL
+      && fcdb_option_hash_lookup(fcdb_config, type, &opt)) {
     return opt->value;
   } else {
     return NULL;
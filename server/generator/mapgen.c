@@ -26,8 +26,10 @@
 #include "log.h"
 #include "maphand.h" /* assign_continent_numbers(), MAP_NCONT */
 #include "mem.h"
+#include "perfzone.h"
 #include "rand.h"
 #include "shared.h"
+#include "timing.h"
 
 /* common */
 #include "game.h"
@@ -114,6 +116,7 @@ static bool make_island(int islemass, int starters,
 struct river_map {
   struct dbv blocked;
   struct dbv ok;
+  struct tile_list *ok_tiles; /* Tiles set in 'ok', to apply and reset */
 };
 
 static int river_test_blocked(struct river_map *privermap,
@@ -794,7 +797,10 @@ static bool make_river(struct river_map *privermap, struct tile *ptile,
 
   while (TRUE) {
     /* Mark the current tile as river. */
-    dbv_set(&privermap->ok, tile_index(ptile));
+    if (!dbv_isset(&privermap->ok, tile_index(ptile))) {
+      dbv_set(&privermap->ok, tile_index(ptile));
+      tile_list_append(privermap->ok_tiles, ptile);
+    }
     log_debug("The tile at (%d, %d) has been marked as river in river_map.",
               TILE_XY(ptile));
 
@@ -889,9 +895,23 @@ static bool make_river(struct river_map *privermap, struct tile *ptile,
   } /* end while; (Make a river.) */
 }
 
+/**************************************************************************
+  Sort function for river tiles; they are applied in map index order.
+**************************************************************************/
+static int river_tile_index_cmp(const struct tile *const *ptile1,
+                                const struct tile *const *ptile2)
+{
+  return tile_index(*ptile1) - tile_index(*ptile2);
+}
+
 /**************************************************************************
   Calls make_river until there are enough river tiles on the map. It stops
   when it has tried to create RIVERS_MAXTRIES rivers.           -Erik Sigra
+
+  Tiles that block each river type (those with other road types) are
+  kept up to date as rivers are applied, and only the tiles of the new
+  river are visited, so that each try doesn't cost a scan of the whole
+  map.
 **************************************************************************/
 static void make_rivers(void)
 {
@@ -899,6 +919,8 @@ static void make_rivers(void)
   struct terrain *pterrain;
   struct river_map rivermap;
   struct extra_type *road_river = NULL;
+  struct dbv other_roads[MAX_ROAD_TYPES];
+  int river_idx, i;
 
   /* Formula to make the river density similar om different sized maps. Avoids
      too few rivers on large maps and too many rivers on small maps. */
@@ -931,6 +953,21 @@ static void make_rivers(void)
 
   dbv_init(&rivermap.blocked, MAP_INDEX_SIZE);
   dbv_init(&rivermap.ok, MAP_INDEX_SIZE);
+  rivermap.ok_tiles = tile_list_new();
+
+  /* A river can't be put where there is any other road type. */
+  for (i = 0; i < river_type_count; i++) {
+    dbv_init(&other_roads[i], MAP_INDEX_SIZE);
+    extra_type_by_cause_iterate(EC_ROAD, oriver) {
+      if (oriver != river_types[i]) {
+        whole_map_iterate(&(wld.map), rtile) {
+          if (tile_has_extra(rtile, oriver)) {
+            dbv_set(&other_roads[i], tile_index(rtile));
+          }
+        } whole_map_iterate_end;
+      }
+    } extra_type_by_cause_iterate_end;
+  }
 
   /* The main loop in this function. */
   while (current_riverlength < desirable_riverlength
@@ -979,44 +1016,43 @@ static void make_rivers(void)
 	    || iteration_counter >= RIVERS_MAXTRIES / 10 * 9)) {
 
       /* Reset river map before making a new river. */
-      dbv_clr_all(&rivermap.blocked);
-      dbv_clr_all(&rivermap.ok);
-
-      road_river = river_types[fc_rand(river_type_count)];
+      tile_list_iterate(rivermap.ok_tiles, rtile) {
+        dbv_clr(&rivermap.ok, tile_index(rtile));
+      } tile_list_iterate_end;
+      tile_list_clear(rivermap.ok_tiles);
 
-      extra_type_by_cause_iterate(EC_ROAD, oriver) {
-        if (oriver != road_river) {
-          whole_map_iterate(&(wld.map), rtile) {
-            if (tile_has_extra(rtile, oriver)) {
-              dbv_set(&rivermap.blocked, tile_index(rtile));
-            }
-          } whole_map_iterate_end;
-        }
-      } extra_type_by_cause_iterate_end;
+      river_idx = fc_rand(river_type_count);
+      road_river = river_types[river_idx];
+      dbv_copy(&rivermap.blocked, &other_roads[river_idx]);
 
       log_debug("Found a suitable starting tile for a river at (%d, %d)."
                 " Starting to make it.", TILE_XY(ptile));
 
       /* Try to make a river. If it is OK, apply it to the map. */
       if (make_river(&rivermap, ptile, road_river)) {
-        whole_map_iterate(&(wld.map), ptile1) {
-          if (dbv_isset(&rivermap.ok, tile_index(ptile1))) {
-            struct terrain *river_terrain = tile_terrain(ptile1);
-
-            if (!terrain_has_flag(river_terrain, TER_CAN_HAVE_RIVER)) {
-              /* We have to change the terrain to put a river here. */
-              river_terrain = pick_terrain_by_flag(TER_CAN_HAVE_RIVER);
-              if (river_terrain != NULL) {
-                tile_set_terrain(ptile1, river_terrain);
-              }
+        tile_list_sort(rivermap.ok_tiles, river_tile_index_cmp);
+        tile_list_iterate(rivermap.ok_tiles, ptile1) {
+          struct terrain *river_terrain = tile_terrain(ptile1);
+
+          if (!terrain_has_flag(river_terrain, TER_CAN_HAVE_RIVER)) {
+            /* We have to change the terrain to put a river here. */
+            river_terrain = pick_terrain_by_flag(TER_CAN_HAVE_RIVER);
+            if (river_terrain != NULL) {
+              tile_set_terrain(ptile1, river_terrain);
             }
+          }
 
-            tile_add_extra(ptile1, road_river);
-            current_riverlength++;
-            map_set_placed(ptile1);
-            log_debug("Applied a river to (%d, %d).", TILE_XY(ptile1));
+          tile_add_extra(ptile1, road_river);
+          current_riverlength++;
+          map_set_placed(ptile1);
+          log_debug("Applied a river to (%d, %d).", TILE_XY(ptile1));
+
+          for (i = 0; i < river_type_count; i++) {
+            if (i != river_idx) {
+              dbv_set(&other_roads[i], tile_index(ptile1));
+            }
           }
-        } whole_map_iterate_end;
+        } tile_list_iterate_end;
       } else {
         log_debug("mapgen.c: A river failed. It might have gotten stuck "
                   "in a helix.");
@@ -1028,6 +1064,10 @@ static void make_rivers(void)
               current_riverlength, desirable_riverlength, iteration_counter);
   } /* end while; */
 
+  for (i = 0; i < river_type_count; i++) {
+    dbv_free(&other_roads[i]);
+  }
+  tile_list_destroy(rivermap.ok_tiles);
   dbv_free(&rivermap.blocked);
   dbv_free(&rivermap.ok);
 
@@ -1043,6 +1083,7 @@ static void make_land(void)
 {
   struct terrain *land_fill = NULL;
 
+  PERF_ZONE_BEGIN("mapgen land");
   if (HAS_POLES) {
     normalize_hmap_poles();
   }
@@ -1116,11 +1157,14 @@ static void make_land(void)
   if (HAS_POLES) {
     renormalize_hmap_poles();
   }
+  PERF_ZONE_END("mapgen land");
 
   /* destroy old dummy temperature map ... */
   destroy_tmap();
   /* ... and create a real temperature map (needs hmap and oceans) */
+  PERF_ZONE_BEGIN("mapgen temperature");
   create_tmap(TRUE);
+  PERF_ZONE_END("mapgen temperature");
 
   if (HAS_POLES) { /* this is a hack to terrains set with not frizzed oceans*/
     make_polar_land(); /* make extra land at poles*/
@@ -1128,15 +1172,21 @@ static void make_land(void)
 
   create_placed_map(); /* here it means land terrains to be placed */
   set_all_ocean_tiles_placed();
+  PERF_ZONE_BEGIN("mapgen relief");
   if (MAPGEN_FRACTURE == wld.map.server.generator) {
     make_fracture_relief();
   } else {
     make_relief(); /* base relief on map */
   }
+  PERF_ZONE_END("mapgen relief");
+  PERF_ZONE_BEGIN("mapgen terrains");
   make_terrains(); /* place all exept mountains and hill */
+  PERF_ZONE_END("mapgen terrains");
   destroy_placed_map();
 
+  PERF_ZONE_BEGIN("mapgen rivers");
   make_rivers(); /* use a new placed_map. destroy older before call */
+  PERF_ZONE_END("mapgen rivers");
 }
 
 /**************************************************************************
@@ -1258,12 +1308,19 @@ bool map_fractal_generate(bool autosize, struct unit_type *initial_unit)
   /* save the current random state: */
   RANDOM_STATE rstate;
   RANDOM_TYPE seed_rand;
+#ifdef LOG_TIMERS
+  struct timer *mapgen_timer = timer_new(TIMER_CPU, TIMER_ACTIVE);
+
+  timer_start(mapgen_timer);
+#endif
 
   /* Call fc_rand() even when result is not needed to make sure
    * random state proceeds equally for random seeds and explicitly
    * set seed. */
   seed_rand = fc_rand(MAX_UINT32);
 
+  PERF_ZONE_BEGIN("mapgen");
+
   if (wld.map.server.seed_setting == 0) {
     /* Create a "random" map seed. */
     wld.map.server.seed = seed_rand & (MAX_UINT32 >> 1);
@@ -1285,6 +1342,7 @@ bool map_fractal_generate(bool autosize, struct unit_type *initial_unit)
      them from file.
      Also, don't delete (the handcrafted!) tiny islands in a scenario */
   if (wld.map.server.generator != MAPGEN_SCENARIO) {
+    PERF_ZONE_BEGIN("mapgen setup");
     river_types_init();
 
     generator_init_topology(autosize);
@@ -1298,7 +1356,9 @@ bool map_fractal_generate(bool autosize, struct unit_type *initial_unit)
 
     /* create a temperature map */
     create_tmap(FALSE);
+    PERF_ZONE_END("mapgen setup");
 
+    PERF_ZONE_BEGIN("mapgen height map");
     if (MAPGEN_FAIR == wld.map.server.generator
         && !map_generate_fair_islands()) {
       wld.map.server.generator = MAPGEN_ISLAND;
@@ -1343,6 +1403,7 @@ bool map_fractal_generate(bool autosize, struct unit_type *initial_unit)
     if (MAPGEN_FRACTURE == wld.map.server.generator) {
       make_fracture_map();
     }
+    PERF_ZONE_END("mapgen height map");
 
     /* if hmap only generator make anything else */
     if (MAPGEN_RANDOM == wld.map.server.generator
@@ -1353,6 +1414,8 @@ bool map_fractal_generate(bool autosize, struct unit_type *initial_unit)
       free(height_map);
       height_map = NULL;
     }
+
+    PERF_ZONE_BEGIN("mapgen water");
     if (!wld.map.server.tinyisles) {
       remove_tiny_islands();
     }
@@ -1364,6 +1427,7 @@ bool map_fractal_generate(bool autosize, struct unit_type *initial_unit)
 
     /* Turn small oceans into lakes. */
     regenerate_lakes();
+    PERF_ZONE_END("mapgen water");
   } else {
     assign_continent_numbers();
   }
@@ -1373,6 +1437,7 @@ bool map_fractal_generate(bool autosize, struct unit_type *initial_unit)
     create_tmap(FALSE);
   }
 
+  PERF_ZONE_BEGIN("mapgen resources");
   /* some scenarios already provide specials */
   if (!wld.map.server.have_resources) {
     add_resources(wld.map.server.riches);
@@ -1381,12 +1446,14 @@ bool map_fractal_generate(bool autosize, struct unit_type *initial_unit)
   if (!wld.map.server.have_huts) {
     make_huts(wld.map.server.huts * map_num_tiles() / 1000); 
   }
+  PERF_ZONE_END("mapgen resources");
 
   /* restore previous random state: */
   fc_rand_set_state(rstate);
 
   /* We don't want random start positions in a scenario which already
    * provides them. */
+  PERF_ZONE_BEGIN("mapgen startpos");
   if (0 == map_startpos_count()) {
     enum map_startpos mode = MAPSTARTPOS_ALL;
 
@@ -1452,16 +1519,31 @@ bool map_fractal_generate(bool autosize, struct unit_type *initial_unit)
         default:
           log_error(_("The server couldn't allocate starting positions."));
           destroy_tmap();
+          PERF_ZONE_END("mapgen startpos");
+          PERF_ZONE_END("mapgen");
+#ifdef LOG_TIMERS
+          timer_destroy(mapgen_timer);
+#endif
           return FALSE;
       }
     }
   }
 
+  PERF_ZONE_END("mapgen startpos");
+
   /* destroy temperature map */
   destroy_tmap();
 
   print_mapgen_map();
 
+  PERF_ZONE_END("mapgen");
+
+#ifdef LOG_TIMERS
+  log_verbose("Map generation: %g seconds",
+              timer_read_seconds(mapgen_timer));
+  timer_destroy(mapgen_timer);
+#endif
+
   return TRUE;
 }
 
@@ -118,45 +118,52 @@ void set_placed_near_pos(struct tile *ptile, int dist)
   The lowest 20% of tiles will have values lower than 0.2 * int_map_max.
 
   If filter is non-null then it only tiles for which filter(ptile, data) is
-  TRUE will be considered.
+  TRUE will be considered. The filter is called once per tile.
 **************************************************************************/
 void adjust_int_map_filtered(int *int_map, int int_map_max, void *data,
 			     bool (*filter)(const struct tile *ptile,
 					    const void *data))
 {
   int minval = 0, maxval = 0, total = 0;
-  bool first = TRUE;
+  int *tiles = NULL;    /* Indices of the tiles passing the filter */
+  int i, idx;
 
-  /* Determine minimum and maximum value. */
-  whole_map_iterate_filtered(ptile, data, filter) {
-    if (first) {
-      minval = int_map[tile_index(ptile)];
-      maxval = int_map[tile_index(ptile)];
-    } else {
-      maxval = MAX(maxval, int_map[tile_index(ptile)]);
-      minval = MIN(minval, int_map[tile_index(ptile)]);
-    }
-    first = FALSE;
-    total++;
-  } whole_map_iterate_filtered_end;
+  if (NULL != filter) {
+    tiles = fc_malloc(MAP_INDEX_SIZE * sizeof(*tiles));
+    whole_map_iterate_filtered(ptile, data, filter) {
+      tiles[total++] = tile_index(ptile);
+    } whole_map_iterate_filtered_end;
+  } else {
+    total = MAP_INDEX_SIZE;
+  }
 
   if (total == 0) {
+    free(tiles);
     return;
   }
 
+  /* Determine minimum and maximum value. */
+  idx = (NULL != tiles ? tiles[0] : 0);
+  minval = maxval = int_map[idx];
+  for (i = 1; i < total; i++) {
+    idx = (NULL != tiles ? tiles[i] : i);
+    maxval = MAX(maxval, int_map[idx]);
+    minval = MIN(minval, int_map[idx]);
+  }
+
   {
     int const size = 1 + maxval - minval;
-    int i, count = 0, frequencies[size];
-
-    INITIALIZE_ARRAY(frequencies, size, 0);
+    int count = 0;
+    int *frequencies = fc_calloc(size, sizeof(*frequencies));
 
     /* Translate value so the minimum value is 0
        and count the number of occurencies of all values to initialize the 
        frequencies[] */
-    whole_map_iterate_filtered(ptile, data, filter) {
-      int_map[tile_index(ptile)] -= minval;
-      frequencies[int_map[tile_index(ptile)]]++;
-    } whole_map_iterate_filtered_end;
+    for (i = 0; i < total; i++) {
+      idx = (NULL != tiles ? tiles[i] : i);
+      int_map[idx] -= minval;
+      frequencies[int_map[idx]]++;
+    }
 
     /* create the linearize function as "incremental" frequencies */
     for (i =  0; i < size; i++) {
@@ -165,10 +172,15 @@ void adjust_int_map_filtered(int *int_map, int int_map_max, void *data,
     }
 
     /* apply the linearize function */
-    whole_map_iterate_filtered(ptile, data, filter) {
-      int_map[tile_index(ptile)] = frequencies[int_map[tile_index(ptile)]];
-    } whole_map_iterate_filtered_end;
+    for (i = 0; i < total; i++) {
+      idx = (NULL != tiles ? tiles[i] : i);
+      int_map[idx] = frequencies[int_map[idx]];
+    }
+
+    free(frequencies);
   }
+
+  free(tiles);
 }
 
 /****************************************************************************
@@ -181,50 +193,116 @@ bool is_normal_nat_pos(int x, int y)
 }
 
 /*******************************************************************************
-  Apply a Gaussian diffusion filter on the map. The size of the map is
-  MAP_INDEX_SIZE and the map is indexed by native_pos_to_index function.
-  If zeroes_at_edges is set, any unreal position on diffusion has 0 value
-  if zeroes_at_edges in unset the unreal position are not counted.
+  One pass of smooth_int_map() along the native rows (is_X_axis) or
+  columns of the map. Works on whole rows at a time, with the wrapping
+  handled once per row or column instead of once per filter tap.
 *******************************************************************************/
-void smooth_int_map(int *int_map, bool zeroes_at_edges)
+static void smooth_int_map_pass(const int *source_map, int *target_map,
+                                const float *weight, bool is_X_axis,
+                                bool zeroes_at_edges)
 {
-  static const float weight_standard[5] = { 0.13, 0.19, 0.37, 0.19, 0.13 };
-  static const float weight_isometric[5] = { 0.15, 0.21, 0.29, 0.21, 0.15 };
-  const float *weight;
-  bool axe = TRUE;
-  int *target_map, *source_map;
-  int *alt_int_map = fc_calloc(MAP_INDEX_SIZE, sizeof(*alt_int_map));
+  const int xsize = wld.map.xsize;
+  const int ysize = wld.map.ysize;
+  float *N = fc_malloc(xsize * sizeof(*N));
+  int x, y, i;
+
+  if (is_X_axis) {
+    const bool wrap = current_topo_has_flag(TF_WRAPX);
+    /* The row, padded by the two tiles each side the filter reaches.
+     * Unreal positions are 0, which adds nothing to the sum. */
+    int *row = fc_malloc((xsize + 4) * sizeof(*row));
+    float *D = fc_malloc(xsize * sizeof(*D));
+
+    for (x = 0; x < xsize; x++) {
+      D[x] = 0;
+      for (i = -2; i <= 2; i++) {
+        if (wrap || (x + i >= 0 && x + i < xsize)) {
+          D[x] += weight[i + 2];
+        }
+      }
+      if (zeroes_at_edges) {
+        D[x] = 1;
+      }
+    }
 
-  fc_assert_ret(NULL != int_map);
+    for (y = 0; y < ysize; y++) {
+      const int *src = source_map + y * xsize;
+      int *dst = target_map + y * xsize;
 
-  weight = weight_standard;
-  target_map = alt_int_map;
-  source_map = int_map;
+      for (i = -2; i < xsize + 2; i++) {
+        if (wrap) {
+          row[i + 2] = src[FC_WRAP(i, xsize)];
+        } else {
+          row[i + 2] = (i >= 0 && i < xsize) ? src[i] : 0;
+        }
+      }
+      for (x = 0; x < xsize; x++) {
+        N[x] = 0;
+        for (i = 0; i < 5; i++) {
+          N[x] += weight[i] * row[x + i];
+        }
+        dst[x] = (float)N[x] / D[x];
+      }
+    }
+
+    free(D);
+    free(row);
+  } else {
+    const bool wrap = current_topo_has_flag(TF_WRAPY);
 
-  do {
-    whole_map_iterate(&(wld.map), ptile) {
-      float N = 0, D = 0;
+    for (y = 0; y < ysize; y++) {
+      int *dst = target_map + y * xsize;
+      float D = 0;
 
-      axis_iterate(ptile, pnear, i, 2, axe) {
+      for (x = 0; x < xsize; x++) {
+        N[x] = 0;
+      }
+      for (i = -2; i <= 2; i++) {
+        const int *src;
+
+        if (wrap) {
+          src = source_map + FC_WRAP(y + i, ysize) * xsize;
+        } else if (y + i >= 0 && y + i < ysize) {
+          src = source_map + (y + i) * xsize;
+        } else {
+          continue;
+        }
         D += weight[i + 2];
-        N += weight[i + 2] * source_map[tile_index(pnear)];
-      } axis_iterate_end;
+        for (x = 0; x < xsize; x++) {
+          N[x] += weight[i + 2] * src[x];
+        }
+      }
       if (zeroes_at_edges) {
         D = 1;
       }
-      target_map[tile_index(ptile)] = (float)N / D;
-    } whole_map_iterate_end;
-
-    if (MAP_IS_ISOMETRIC) {
-      weight = weight_isometric;
+      for (x = 0; x < xsize; x++) {
+        dst[x] = (float)N[x] / D;
+      }
     }
+  }
+
+  free(N);
+}
 
-    axe = !axe;
+/*******************************************************************************
+  Apply a Gaussian diffusion filter on the map. The size of the map is
+  MAP_INDEX_SIZE and the map is indexed by native_pos_to_index function.
+  If zeroes_at_edges is set, any unreal position on diffusion has 0 value
+  if zeroes_at_edges in unset the unreal position are not counted.
+*******************************************************************************/
+void smooth_int_map(int *int_map, bool zeroes_at_edges)
+{
+  static const float weight_standard[5] = { 0.13, 0.19, 0.37, 0.19, 0.13 };
+  static const float weight_isometric[5] = { 0.15, 0.21, 0.29, 0.21, 0.15 };
+  int *alt_int_map = fc_calloc(MAP_INDEX_SIZE, sizeof(*alt_int_map));
 
-    source_map = alt_int_map;
-    target_map = int_map;
+  fc_assert_ret(NULL != int_map);
 
-  } while (!axe);
+  smooth_int_map_pass(int_map, alt_int_map, weight_standard, TRUE,
+                      zeroes_at_edges);
+  smooth_int_map_pass(alt_int_map, int_map,
+                      MAP_IS_ISOMETRIC ? weight_isometric : weight_standard,
+                      FALSE, zeroes_at_edges);
 
   FC_FREE(alt_int_map);
 }
@@ -439,7 +517,9 @@ int get_ocean_size(Continent_id id)
 /**************************************************************************
   Assigns continent and ocean numbers to all tiles, and set
   map.num_continents and map.num_oceans.  Recalculates continent and
-  ocean sizes, and lake_surrounders[] arrays.
+  ocean sizes, and lake_surrounders[] arrays.  Bumps
+  map.continent_generation so that caches depending on the numbering
+  can tell it has changed.
 
   Continents have numbers 1 to map.num_continents _inclusive_.
   Oceans have (negative) numbers -1 to -map.num_oceans _inclusive_.
@@ -449,6 +529,7 @@ void assign_continent_numbers(void)
   /* Initialize */
   wld.map.num_continents = 0;
   wld.map.num_oceans = 0;
+  wld.map.continent_generation++;
 
   whole_map_iterate(&(wld.map), ptile) {
     tile_set_continent(ptile, 0);
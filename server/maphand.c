@@ -60,6 +60,18 @@
 /* Suppress send_tile_info() during game_load() */
 static bool send_tile_suppressed = FALSE;
 
+/* Tiles where a border source may want to claim something it didn't want
+ * at the last border calculation: they lost their claimer, a player got
+ * to know them, or a border source covering them changed. See
+ * map_calculate_dirty_borders(). */
+static struct dbv border_dirty;
+static int border_dirty_num = 0;
+/* Set when the dirty tiles aren't known, e.g. before the first full
+ * calculation, or after a change of the continents. */
+static bool border_dirty_all = TRUE;
+
+static void map_border_tile_dirty(struct tile *ptile);
+
 static void player_tile_init(struct tile *ptile, struct player *pplayer);
 static void player_tile_free(struct tile *ptile, struct player *pplayer);
 static void give_tile_info_from_player_to_player(struct player *pfrom,
@@ -361,14 +373,16 @@ static void unbuffer_shared_vision(struct player *pplayer)
 
 /**************************************************************************
   Give information about whole map (all tiles) from player to player.
+  Only the tiles known to pfrom have anything to give.
 **************************************************************************/
 void give_map_from_player_to_player(struct player *pfrom, struct player *pdest)
 {
   buffer_shared_vision(pdest);
 
-  whole_map_iterate(&(wld.map), ptile) {
-    give_tile_info_from_player_to_player(pfrom, pdest, ptile);
-  } whole_map_iterate_end;
+  dbv_iterate_set(&pfrom->tile_known, tindex) {
+    give_tile_info_from_player_to_player(pfrom, pdest,
+                                         index_to_tile(&(wld.map), tindex));
+  } dbv_iterate_set_end;
 
   unbuffer_shared_vision(pdest);
   city_thaw_workers_queue();
@@ -382,11 +396,13 @@ void give_seamap_from_player_to_player(struct player *pfrom, struct player *pdes
 {
   buffer_shared_vision(pdest);
 
-  whole_map_iterate(&(wld.map), ptile) {
+  dbv_iterate_set(&pfrom->tile_known, tindex) {
+    struct tile *ptile = index_to_tile(&(wld.map), tindex);
+
     if (is_ocean_tile(ptile)) {
       give_tile_info_from_player_to_player(pfrom, pdest, ptile);
     }
-  } whole_map_iterate_end;
+  } dbv_iterate_set_end;
 
   unbuffer_shared_vision(pdest);
   city_thaw_workers_queue();
@@ -423,18 +439,31 @@ void give_citymap_from_player_to_player(struct city *pcity,
 **************************************************************************/
 void send_all_known_tiles(struct conn_list *dest)
 {
+  struct dbv known;
   int tiles_sent;
 
   if (!dest) {
     dest = game.est_connections;
   }
 
+  /* Only the tiles known to some player in dest, or all of them for
+   * global observers, are sent. */
+  dbv_init(&known, MAP_INDEX_SIZE);
+  conn_list_iterate(dest, pconn) {
+    if (NULL != pconn->playing) {
+      dbv_or(&known, &pconn->playing->tile_known);
+    } else if (pconn->observer) {
+      dbv_set_all(&known);
+      break;
+    }
+  } conn_list_iterate_end;
+
   /* send whole map piece by piece to each player to balance the load
      of the send buffers better */
   tiles_sent = 0;
   conn_list_do_buffer(dest);
 
-  whole_map_iterate(&(wld.map), ptile) {
+  dbv_iterate_set(&known, tindex) {
     tiles_sent++;
     if ((tiles_sent % wld.map.xsize) == 0) {
       conn_list_do_unbuffer(dest);
@@ -442,11 +471,13 @@ void send_all_known_tiles(struct conn_list *dest)
       conn_list_do_buffer(dest);
     }
 
-    send_tile_info(dest, ptile, FALSE);
-  } whole_map_iterate_end;
+    send_tile_info(dest, index_to_tile(&(wld.map), tindex), FALSE);
+  } dbv_iterate_set_end;
 
   conn_list_do_unbuffer(dest);
   flush_packets();
+
+  dbv_free(&known);
 }
 
 /**************************************************************************
@@ -1058,7 +1089,13 @@ void change_playertile_site(struct player_tile *ptile,
 ***************************************************************/
 void map_set_known(struct tile *ptile, struct player *pplayer)
 {
-  dbv_set(&pplayer->tile_known, tile_index(ptile));
+  if (!dbv_isset(&pplayer->tile_known, tile_index(ptile))) {
+    dbv_set(&pplayer->tile_known, tile_index(ptile));
+    if (game.info.borders < BORDERS_EXPAND) {
+      /* Border sources of pplayer may claim the tile now. */
+      map_border_tile_dirty(ptile);
+    }
+  }
 }
 
 /***************************************************************
@@ -1187,6 +1224,7 @@ void remove_player_from_maps(struct player *pplayer)
     /* Free all claimed tiles. */
     if (tile_owner(ptile) == pplayer) {
       tile_set_owner(ptile, NULL, NULL);
+      map_border_tile_dirty(ptile);
       reality_changed = TRUE;
     }
     if (extra_owner(ptile) == pplayer) {
@@ -1836,6 +1874,9 @@ void check_terrain_change(struct tile *ptile, struct terrain *oldter)
   if (need_to_reassign_continents(oldter, newter)) {
     assign_continent_numbers();
     send_all_known_tiles(NULL);
+    /* Which land and ocean tiles are claimable depends on the continent
+     * numbers, and on the size of the oceans. */
+    map_borders_all_dirty();
   }
 
   claimer = tile_claimer(ptile);
@@ -1934,6 +1975,12 @@ static void map_claim_border_ownership(struct tile *ptile,
 {
   struct player *ploser = tile_owner(ptile);
 
+  if (powner == NULL && (ploser != NULL || tile_claimer(ptile) != NULL)) {
+    /* Other sources may want the tile now. Claims by a stronger source
+     * never make anyone want more. */
+    map_border_tile_dirty(ptile);
+  }
+
   if ((ploser != powner && ploser != NULL)
       && (BORDERS_SEE_INSIDE == game.info.borders
           || BORDERS_EXPAND == game.info.borders
@@ -1990,6 +2037,11 @@ void tile_claim_bases(struct tile *ptile, struct player *powner)
 {
   struct player *base_loser = extra_owner(ptile);
 
+  if (base_loser != powner) {
+    /* The tile may become, or stop being, a border source. */
+    map_border_tile_dirty(ptile);
+  }
+
   /* This MUST be before potentially recursive call to map_claim_base(),
    * so that the recursive call will get new owner == base_loser and
    * abort recursion. */
@@ -2047,6 +2099,72 @@ void map_update_border(struct tile *ptile, struct player *owner,
   }
 }
 
+/*************************************************************************
+  Would border source ptile, owned by owner, claim dtile at squared
+  distance dr from it? Tiles already claimed by ptile are not reclaimed.
+*************************************************************************/
+static bool is_border_claim_wanted(struct tile *dtile, struct tile *ptile,
+                                   struct player *owner, int dr)
+{
+  struct tile *dclaimer = tile_claimer(dtile);
+
+  if (dclaimer == ptile) {
+    /* Already claimed by the ptile */
+    return FALSE;
+  }
+
+  if (dr != 0 && is_border_source(dtile)) {
+    /* Do not claim border sources other than self */
+    /* Note that this is extremely important at the moment for
+     * base claiming to work correctly in case there's two
+     * fortresses near each other. There could be infinite
+     * recursion in them claiming each other. */
+    return FALSE;
+  }
+
+  if (!map_is_known(dtile, owner) && game.info.borders < BORDERS_EXPAND) {
+    return FALSE;
+  }
+
+  /* Always claim source itself (distance, dr, to it 0) */
+  if (dr != 0 && NULL != dclaimer && dclaimer != ptile) {
+    struct city *ccity = tile_city(dclaimer);
+    int strength_old, strength_new;
+
+    if (ccity != NULL) {
+      /* Previously claimed by city */
+      int city_x, city_y;
+
+      map_distance_vector(&city_x, &city_y, ccity->tile, dtile);
+
+      if (map_vector_to_sq_distance(city_x, city_y)
+          <= city_map_radius_sq_get(ccity)
+             + game.info.border_city_permanent_radius_sq) {
+        /* Tile is within region permanently claimed by city */
+        return FALSE;
+      }
+    }
+
+    strength_old = tile_border_strength(dtile, dclaimer);
+    strength_new = tile_border_strength(dtile, ptile);
+
+    if (strength_new <= strength_old) {
+      /* Stronger shall prevail,
+       * in case of equal strength older shall prevail */
+      return FALSE;
+    }
+  }
+
+  if (is_ocean_tile(dtile)) {
+    /* Only certain water tiles are claimable */
+    return is_claimable_ocean(dtile, ptile, owner);
+  } else {
+    /* Only land tiles on the same island as the border source
+     * are claimable */
+    return tile_continent(dtile) == tile_continent(ptile);
+  }
+}
+
 /*************************************************************************
   Update borders for this source. Call this for each new source.
 
@@ -2072,72 +2190,165 @@ void map_claim_border(struct tile *ptile, struct player *owner,
   }
 
   circle_dxyr_iterate(ptile, radius_sq, dtile, dx, dy, dr) {
-    struct tile *dclaimer = tile_claimer(dtile);
-
-    if (dclaimer == ptile) {
-      /* Already claimed by the ptile */
-      continue;
+    if (is_border_claim_wanted(dtile, ptile, owner, dr)) {
+      map_claim_ownership(dtile, owner, ptile, dr == 0);
     }
+  } circle_dxyr_iterate_end;
+}
 
-    if (dr != 0 && is_border_source(dtile)) {
-      /* Do not claim border sources other than self */
-      /* Note that this is extremely important at the moment for
-       * base claiming to work correctly in case there's two
-       * fortresses near each other. There could be infinite
-       * recursion in them claiming each other. */
-      continue;
-    }
+/*************************************************************************
+  Returns TRUE iff map_claim_border() for this source would not change
+  any tile, i.e. the border around it is what a full recalculation with
+  map_calculate_borders() gives. Does not modify anything.
+*************************************************************************/
+bool map_border_source_settled(struct tile *ptile)
+{
+  struct player *owner = tile_owner(ptile);
+  int radius_sq;
 
-    if (!map_is_known(dtile, owner) && game.info.borders < BORDERS_EXPAND) {
-      continue;
+  if (BORDERS_DISABLED == game.info.borders) {
+    return TRUE;
+  }
+
+  radius_sq = tile_border_source_radius_sq(ptile);
+
+  circle_dxyr_iterate(ptile, radius_sq, dtile, dx, dy, dr) {
+    if (owner == NULL) {
+      /* map_claim_border() would clear the border */
+      if (tile_claimer(dtile) == ptile) {
+        return FALSE;
+      }
+    } else if (is_border_claim_wanted(dtile, ptile, owner, dr)) {
+      return FALSE;
     }
+  } circle_dxyr_iterate_end;
 
-    /* Always claim source itself (distance, dr, to it 0) */
-    if (dr != 0 && NULL != dclaimer && dclaimer != ptile) {
-      struct city *ccity = tile_city(dclaimer);
-      int strength_old, strength_new;
+  return TRUE;
+}
 
-      if (ccity != NULL) {
-        /* Previously claimed by city */
-        int city_x, city_y;
+/*************************************************************************
+  Mark the tile as dirty: some border source around it may want to claim
+  it, or other tiles, now.
+*************************************************************************/
+static void map_border_tile_dirty(struct tile *ptile)
+{
+  int tindex = tile_index(ptile);
 
-        map_distance_vector(&city_x, &city_y, ccity->tile, dtile);
+  if (border_dirty_all || dbv_bits(&border_dirty) != MAP_INDEX_SIZE) {
+    /* Everything will be calculated anyway. */
+    return;
+  }
 
-        if (map_vector_to_sq_distance(city_x, city_y)
-            <= city_map_radius_sq_get(ccity)
-               + game.info.border_city_permanent_radius_sq) {
-          /* Tile is within region permanently claimed by city */
-          continue;
-        }
-      }
+  if (!dbv_isset(&border_dirty, tindex)) {
+    dbv_set(&border_dirty, tindex);
+    border_dirty_num++;
+  }
+}
 
-      strength_old = tile_border_strength(dtile, dclaimer);
-      strength_new = tile_border_strength(dtile, ptile);
+/*************************************************************************
+  Call this when the strength, the radius or the city radius of a border
+  source changes, e.g. when a city grows or shrinks. The source itself,
+  and the others wanting any of its tiles, have to be recalculated.
+*************************************************************************/
+void map_border_source_dirty(struct tile *psource)
+{
+  if (border_dirty_all) {
+    return;
+  }
 
-      if (strength_new <= strength_old) {
-        /* Stronger shall prevail,
-         * in case of equal strength older shall prevail */
-        continue;
-      }
+  circle_iterate(psource, tile_border_source_radius_sq(psource), ptile) {
+    map_border_tile_dirty(ptile);
+  } circle_iterate_end;
+}
+
+/*************************************************************************
+  Have the next call to map_calculate_dirty_borders() calculate all the
+  borders.
+*************************************************************************/
+void map_borders_all_dirty(void)
+{
+  border_dirty_all = TRUE;
+}
+
+/*************************************************************************
+  Free the dirty tile data of the borders.
+*************************************************************************/
+void map_borders_free(void)
+{
+  dbv_free(&border_dirty);
+  border_dirty_num = 0;
+  border_dirty_all = TRUE;
+}
+
+/*************************************************************************
+  Returns TRUE iff there is a dirty tile within the radius of the border
+  source.
+*************************************************************************/
+static bool border_source_has_dirty_tile(struct tile *psource)
+{
+  circle_iterate(psource, tile_border_source_radius_sq(psource), ptile) {
+    if (dbv_isset(&border_dirty, tile_index(ptile))) {
+      return TRUE;
     }
+  } circle_iterate_end;
 
-    if (is_ocean_tile(dtile)) {
-      /* Only certain water tiles are claimable */
-      if (is_claimable_ocean(dtile, ptile, owner)) {
-        map_claim_ownership(dtile, owner, ptile, dr == 0);
-      }
-    } else {
-      /* Only land tiles on the same island as the border source
-       * are claimable */
-      if (tile_continent(dtile) == tile_continent(ptile)) {
-        map_claim_ownership(dtile, owner, ptile, dr == 0);
+  return FALSE;
+}
+
+/*************************************************************************
+  Update borders for the sources with a dirty tile within their radius.
+  Call this on turn end.
+
+  This gives the same borders as map_calculate_borders(): a source with
+  no dirty tile in its radius would claim nothing when
+  map_calculate_borders() gets to it, since claims by the sources before
+  it are by stronger ones and don't make it want anything. So only the
+  sources with dirty tiles are claimed for, in the same order.
+*************************************************************************/
+void map_calculate_dirty_borders(void)
+{
+  struct dbv sources;
+
+  if (BORDERS_DISABLED == game.info.borders || wld.map.tiles == NULL) {
+    return;
+  }
+
+  if (border_dirty_all || dbv_bits(&border_dirty) != MAP_INDEX_SIZE) {
+    map_calculate_borders();
+    return;
+  }
+
+  log_verbose("map_calculate_dirty_borders(): %d dirty tiles",
+              border_dirty_num);
+
+  if (border_dirty_num > 0) {
+    dbv_init(&sources, MAP_INDEX_SIZE);
+    whole_map_iterate(&(wld.map), ptile) {
+      if (is_border_source(ptile) && border_source_has_dirty_tile(ptile)) {
+        dbv_set(&sources, tile_index(ptile));
       }
-    }
-  } circle_dxyr_iterate_end;
+    } whole_map_iterate_end;
+
+    /* Claims made from here on are for the next calculation. */
+    dbv_clr_all(&border_dirty);
+    border_dirty_num = 0;
+
+    dbv_iterate_set(&sources, tindex) {
+      struct tile *ptile = index_to_tile(&(wld.map), tindex);
+
+      map_claim_border(ptile, ptile->owner, -1);
+    } dbv_iterate_set_end;
+    dbv_free(&sources);
+  }
+
+  sanity_check_borders();
+
+  city_thaw_workers_queue();
+  city_refresh_queue_processing();
 }
 
 /*************************************************************************
-  Update borders for all sources. Call this on turn end.
+  Update borders for all sources.
 *************************************************************************/
 void map_calculate_borders(void)
 {
@@ -2152,12 +2363,20 @@ void map_calculate_borders(void)
 
   log_verbose("map_calculate_borders()");
 
+  /* Claims made from here on are for the next calculation. */
+  dbv_resize(&border_dirty, MAP_INDEX_SIZE);
+  dbv_clr_all(&border_dirty);
+  border_dirty_num = 0;
+  border_dirty_all = FALSE;
+
   whole_map_iterate(&(wld.map), ptile) {
     if (is_border_source(ptile)) {
       map_claim_border(ptile, ptile->owner, -1);
     }
   } whole_map_iterate_end;
 
+  sanity_check_borders();
+
   log_verbose("map_calculate_borders() workers");
   city_thaw_workers_queue();
   city_refresh_queue_processing();
@@ -106,6 +106,10 @@ void enable_fog_of_war_player(struct player *pplayer);
 void disable_fog_of_war_player(struct player *pplayer);
 
 void map_calculate_borders(void);
+void map_calculate_dirty_borders(void);
+void map_border_source_dirty(struct tile *psource);
+void map_borders_all_dirty(void);
+void map_borders_free(void);
 void map_claim_border(struct tile *ptile, struct player *powner,
                       int radius_sq);
 void map_claim_ownership(struct tile *ptile, struct player *powner,
@@ -113,6 +117,7 @@ void map_claim_ownership(struct tile *ptile, struct player *powner,
 void map_clear_border(struct tile *ptile);
 void map_update_border(struct tile *ptile, struct player *owner,
                        int old_radius_sq, int new_radius_sq);
+bool map_border_source_settled(struct tile *ptile);
 
 void tile_claim_bases(struct tile *ptile, struct player *powner);
 void map_claim_base(struct tile *ptile, struct extra_type *pextra,
@@ -20,7 +20,9 @@
 /* utility */
 #include "bitvector.h"
 #include "log.h"
+#include "mem.h"
 #include "registry.h"
+#include "timing.h"
 
 /* common */
 #include "connection.h"
@@ -60,7 +62,6 @@ static void package_event_full(struct packet_chat_msg *packet,
                                const char *format, va_list vargs)
 {
   char buf[MAX_LEN_MSG];
-  char *str;
 
   fc_assert_ret(NULL != packet);
 
@@ -70,23 +71,18 @@ static void package_event_full(struct packet_chat_msg *packet,
   packet->turn = game.info.turn;
   packet->phase = game.info.phase;
 
-  fc_vsnprintf(buf, sizeof(buf), format, vargs);
-  if (is_capitalization_enabled()) {
-    str = capitalized_string(buf);
-  } else {
-    str = buf;
-  }
-
+  /* Format right into the packet, unless the text still has to be
+   * wrapped in a color tag. The packet is then shared by all the
+   * recipients and the event cache. */
   if (ft_color_requested(color)) {
-    featured_text_apply_tag(str, packet->message, sizeof(packet->message),
+    fc_vsnprintf(buf, sizeof(buf), format, vargs);
+    capitalize_in_place(buf);
+    featured_text_apply_tag(buf, packet->message, sizeof(packet->message),
                             TTT_COLOR, 0, FT_OFFSET_UNSET, color);
   } else {
     /* Simple case */
-    strncpy(packet->message, str, sizeof(packet->message));
-  }
-
-  if (is_capitalization_enabled()) {
-    free_capitalized(str);
+    fc_vsnprintf(packet->message, sizeof(packet->message), format, vargs);
+    capitalize_in_place(packet->message);
   }
 }
 
@@ -189,12 +185,14 @@ void package_event(struct packet_chat_msg *packet,
   NULL == pconn->playing && pconn->observer).  If coords are not required,
   caller should specify (x,y) = (-1,-1); otherwise make sure that the
   coordinates have been normalized.
+
+  The same packet is sent to all connections, only its tile is changed
+  for each; it is back to what it was on return.
 **************************************************************************/
 static void notify_conn_packet(struct conn_list *dest,
-                               const struct packet_chat_msg *packet,
+                               struct packet_chat_msg *packet,
                                bool early)
 {
-  struct packet_chat_msg real_packet = *packet;
   int tile = packet->tile;
   struct tile *ptile = index_to_tile(&(wld.map), tile);
 
@@ -219,18 +217,20 @@ static void notify_conn_packet(struct conn_list *dest,
       /* tile info is OK; see above. */
       /* FIXME: in the case this is a city event, we should check if the
        * city is really known. */
-      real_packet.tile = tile;
+      packet->tile = tile;
     } else {
       /* No tile info. */
-      real_packet.tile = -1;
+      packet->tile = -1;
     }
 
     if (early) {
-      send_packet_early_chat_msg(pconn, (struct packet_early_chat_msg *)(&real_packet));
+      send_packet_early_chat_msg(pconn, (struct packet_early_chat_msg *)packet);
     } else {
-      send_packet_chat_msg(pconn, &real_packet);
+      send_packet_chat_msg(pconn, packet);
     }
   } conn_list_iterate_end;
+
+  packet->tile = tile;
 }
 
 /**************************************************************************
@@ -473,43 +473,160 @@ enum event_cache_target {
   ECT_GLOBAL_OBSERVERS
 };
 
-/* Events are saved in that structure. */
+/* Events are saved in that structure. The message is allocated with its
+ * real length; the other fields of the packet are kept as they are. */
 struct event_cache_data {
-  struct packet_chat_msg packet;
+  char *message;
+  int tile;
+  enum event_type event;
+  int turn;
+  int phase;
+  int conn_id;
   time_t timestamp;
   enum server_states server_state;
   enum event_cache_target target_type;
   bv_player target;     /* Used if target_type == ECT_PLAYERS. */
 };
 
-#define SPECLIST_TAG event_cache_data
-#define SPECLIST_TYPE struct event_cache_data
-#include "speclist.h"
-#define event_cache_iterate(pdata) \
-    TYPED_LIST_ITERATE(struct event_cache_data, event_cache, pdata)
-#define event_cache_iterate_end  LIST_ITERATE_END
-
 struct event_cache_players {
   bv_player vector;
 };
 
-/* The full list of the events. */
-static struct event_cache_data_list *event_cache = NULL;
+/* Sequence numbers of the events of one audience, oldest first. Numbers
+ * of events which already left the cache are dropped lazily. */
+struct event_cache_index {
+  unsigned int *seqs;
+  int size;
+  int head;
+  int count;
+};
+
+/* The events, in a ring buffer of 'capacity' entries. The oldest event
+ * has the sequence number 'first' and is at 'head'. */
+static struct {
+  struct event_cache_data *entries;
+  int capacity;
+  int head;
+  int count;
+  unsigned int first;
+  size_t message_bytes;
+
+  struct event_cache_index all;
+  struct event_cache_index global_observers;
+  struct event_cache_index players[MAX_NUM_PLAYER_SLOTS];
+
+  struct timer *replay_timer;
+  int replays;
+} ecache;
+
+#define event_cache_entry(_seq)                                             \
+  (ecache.entries                                                           \
+   + (ecache.head + (int) ((_seq) - ecache.first)) % ecache.capacity)
+
+#define event_cache_iterate(pdata)                                          \
+{                                                                           \
+  int _ec_num;                                                              \
+  for (_ec_num = 0; _ec_num < ecache.count; _ec_num++) {                    \
+    struct event_cache_data *pdata                                          \
+      = ecache.entries + (ecache.head + _ec_num) % ecache.capacity;
+#define event_cache_iterate_end                                             \
+  }                                                                         \
+}
 
 /* Event cache status: ON(TRUE) / OFF(FALSE); used for saving the
  * event cache */
 static bool event_cache_status = FALSE;
 
 /**************************************************************************
-  Callback for freeing event cache data
+  Drop the sequence numbers of events which are no longer in the cache.
+**************************************************************************/
+static void event_cache_index_prune(struct event_cache_index *pindex)
+{
+  while (pindex->count > 0
+         && (int) (pindex->seqs[pindex->head] - ecache.first) < 0) {
+    pindex->head = (pindex->head + 1) % pindex->size;
+    pindex->count--;
+  }
+}
+
+/**************************************************************************
+  Append a sequence number to an index.
+**************************************************************************/
+static void event_cache_index_push(struct event_cache_index *pindex,
+                                   unsigned int seq)
+{
+  event_cache_index_prune(pindex);
+
+  if (pindex->count == pindex->size) {
+    int new_size = MAX(16, 2 * pindex->size);
+    unsigned int *seqs = fc_malloc(new_size * sizeof(*seqs));
+    int i;
+
+    for (i = 0; i < pindex->count; i++) {
+      seqs[i] = pindex->seqs[(pindex->head + i) % pindex->size];
+    }
+    free(pindex->seqs);
+    pindex->seqs = seqs;
+    pindex->size = new_size;
+    pindex->head = 0;
+  }
+
+  pindex->seqs[(pindex->head + pindex->count) % pindex->size] = seq;
+  pindex->count++;
+}
+
+/**************************************************************************
+  Free an index.
 **************************************************************************/
-static void event_cache_data_free(struct event_cache_data *data)
+static void event_cache_index_free(struct event_cache_index *pindex)
 {
-  free(data);
+  free(pindex->seqs);
+  pindex->seqs = NULL;
+  pindex->size = pindex->head = pindex->count = 0;
 }
 
 /**************************************************************************
-  Creates a new event_cache_data, appened to the list.  It mays remove an
+  Remove the oldest event from the cache.
+**************************************************************************/
+static void event_cache_pop_front(void)
+{
+  struct event_cache_data *pdata = ecache.entries + ecache.head;
+
+  fc_assert_ret(ecache.count > 0);
+
+  ecache.message_bytes -= strlen(pdata->message) + 1;
+  free(pdata->message);
+  pdata->message = NULL;
+  ecache.head = (ecache.head + 1) % ecache.capacity;
+  ecache.count--;
+  ecache.first++;
+}
+
+/**************************************************************************
+  Change the number of events the cache can hold, dropping the oldest
+  ones if there are too many.
+**************************************************************************/
+static void event_cache_resize(int capacity)
+{
+  struct event_cache_data *entries;
+  int i;
+
+  while (ecache.count > capacity) {
+    event_cache_pop_front();
+  }
+
+  entries = fc_malloc(capacity * sizeof(*entries));
+  for (i = 0; i < ecache.count; i++) {
+    entries[i] = ecache.entries[(ecache.head + i) % ecache.capacity];
+  }
+  free(ecache.entries);
+  ecache.entries = entries;
+  ecache.capacity = capacity;
+  ecache.head = 0;
+}
+
+/**************************************************************************
+  Creates a new event_cache_data, appened to the cache.  It mays remove an
   old entry if needed.
 **************************************************************************/
 static struct event_cache_data *
@@ -519,9 +636,10 @@ event_cache_data_new(const struct packet_chat_msg *packet,
                      struct event_cache_players *players)
 {
   struct event_cache_data *pdata;
+  unsigned int seq;
   int max_events;
 
-  if (NULL == event_cache) {
+  if (NULL == ecache.replay_timer) {
     /* Don't do log for this, because this could make an infinite
      * recursion. */
     return NULL;
@@ -543,8 +661,27 @@ event_cache_data_new(const struct packet_chat_msg *packet,
     return NULL;
   }
 
-  pdata = fc_malloc(sizeof(*pdata));
-  pdata->packet = *packet;
+  max_events = game.server.event_cache.max_size
+               ? game.server.event_cache.max_size
+               : GAME_MAX_EVENT_CACHE_MAX_SIZE;
+  if (max_events != ecache.capacity) {
+    event_cache_resize(max_events);
+  }
+  if (ecache.count == ecache.capacity) {
+    event_cache_pop_front();
+  }
+
+  seq = ecache.first + ecache.count;
+  pdata = ecache.entries + (ecache.head + ecache.count) % ecache.capacity;
+  ecache.count++;
+
+  pdata->message = fc_strdup(packet->message);
+  ecache.message_bytes += strlen(pdata->message) + 1;
+  pdata->tile = packet->tile;
+  pdata->event = packet->event;
+  pdata->turn = packet->turn;
+  pdata->phase = packet->phase;
+  pdata->conn_id = packet->conn_id;
   pdata->timestamp = timestamp;
   pdata->server_state = server_status;
   pdata->target_type = target_type;
@@ -553,13 +690,25 @@ event_cache_data_new(const struct packet_chat_msg *packet,
   } else {
     BV_CLR_ALL(pdata->target);
   }
-  event_cache_data_list_append(event_cache, pdata);
 
-  max_events = game.server.event_cache.max_size
-               ? game.server.event_cache.max_size
-               : GAME_MAX_EVENT_CACHE_MAX_SIZE;
-  while (event_cache_data_list_size(event_cache) > max_events) {
-    event_cache_data_list_pop_front(event_cache);
+  switch (target_type) {
+  case ECT_ALL:
+    event_cache_index_push(&ecache.all, seq);
+    break;
+  case ECT_GLOBAL_OBSERVERS:
+    event_cache_index_push(&ecache.global_observers, seq);
+    break;
+  case ECT_PLAYERS:
+    {
+      int i;
+
+      for (i = 0; i < MAX_NUM_PLAYER_SLOTS; i++) {
+        if (BV_ISSET(pdata->target, i)) {
+          event_cache_index_push(ecache.players + i, seq);
+        }
+      }
+    }
+    break;
   }
 
   return pdata;
@@ -570,10 +719,11 @@ event_cache_data_new(const struct packet_chat_msg *packet,
 **************************************************************************/
 void event_cache_init(void)
 {
-  if (event_cache != NULL) {
+  if (ecache.replay_timer != NULL) {
     event_cache_free();
   }
-  event_cache = event_cache_data_list_new_full(event_cache_data_free);
+  ecache.replay_timer = timer_new(TIMER_USER, TIMER_ACTIVE);
+  ecache.replays = 0;
   event_cache_status = TRUE;
 }
 
@@ -582,9 +732,23 @@ void event_cache_init(void)
 **************************************************************************/
 void event_cache_free(void)
 {
-  if (event_cache != NULL) {
-    event_cache_data_list_destroy(event_cache);
-    event_cache = NULL;
+  int i;
+
+  if (ecache.replay_timer != NULL) {
+    event_cache_clear();
+    free(ecache.entries);
+    ecache.entries = NULL;
+    ecache.capacity = 0;
+    ecache.head = 0;
+
+    event_cache_index_free(&ecache.all);
+    event_cache_index_free(&ecache.global_observers);
+    for (i = 0; i < MAX_NUM_PLAYER_SLOTS; i++) {
+      event_cache_index_free(ecache.players + i);
+    }
+
+    timer_destroy(ecache.replay_timer);
+    ecache.replay_timer = NULL;
   }
   event_cache_status = FALSE;
 }
@@ -594,7 +758,9 @@ void event_cache_free(void)
 **************************************************************************/
 void event_cache_clear(void)
 {
-  event_cache_data_list_clear(event_cache);
+  while (ecache.count > 0) {
+    event_cache_pop_front();
+  }
 }
 
 /**************************************************************************
@@ -602,15 +768,11 @@ void event_cache_clear(void)
 **************************************************************************/
 void event_cache_remove_old(void)
 {
-  struct event_cache_data *current;
-
   /* This assumes that entries are in order, the ones to be removed first. */
-  current = event_cache_data_list_get(event_cache, 0);
-
-    while (current != NULL
-           && current->packet.turn + game.server.event_cache.turns <= game.info.turn) {
-    event_cache_data_list_pop_front(event_cache);
-    current = event_cache_data_list_get(event_cache, 0);
+  while (ecache.count > 0
+         && (ecache.entries[ecache.head].turn + game.server.event_cache.turns
+             <= game.info.turn)) {
+    event_cache_pop_front();
   }
 }
 
@@ -653,12 +815,12 @@ void event_cache_add_for_player(const struct packet_chat_msg *packet,
 
   if (0 < game.server.event_cache.turns
       && (server_state() > S_S_INITIAL || !game.info.is_new_game)) {
-    struct event_cache_data *pdata;
+    struct event_cache_players players;
 
-    pdata = event_cache_data_new(packet, time(NULL),
-                                 server_state(), ECT_PLAYERS, NULL);
-    fc_assert_ret(NULL != pdata);
-    BV_SET(pdata->target, player_index(pplayer));
+    BV_CLR_ALL(players.vector);
+    BV_SET(players.vector, player_index(pplayer));
+    (void) event_cache_data_new(packet, time(NULL),
+                                server_state(), ECT_PLAYERS, &players);
   }
 }
 
@@ -729,8 +891,8 @@ static bool event_cache_match(const struct event_cache_data *pdata,
   }
 
   if (server_state() == S_S_RUNNING
-      && game.info.turn < pdata->packet.turn
-      && game.info.turn > pdata->packet.turn - game.server.event_cache.turns) {
+      && game.info.turn < pdata->turn
+      && game.info.turn > pdata->turn - game.server.event_cache.turns) {
     return FALSE;
   }
 
@@ -747,33 +909,125 @@ static bool event_cache_match(const struct event_cache_data *pdata,
   return FALSE;
 }
 
+/**************************************************************************
+  Fill the chat packet of a cached event.
+**************************************************************************/
+static void event_cache_data_packet(const struct event_cache_data *pdata,
+                                    struct packet_chat_msg *packet)
+{
+  sz_strlcpy(packet->message, pdata->message);
+  packet->tile = pdata->tile;
+  packet->event = pdata->event;
+  packet->turn = pdata->turn;
+  packet->phase = pdata->phase;
+  packet->conn_id = pdata->conn_id;
+}
+
 /**************************************************************************
   Send all available events.  If include_public is TRUE, also fully global
   message will be sent.
+
+  Only the indices of the audiences of the connection are walked, merged
+  by sequence number so the events keep their order.
 **************************************************************************/
 void send_pending_events(struct connection *pconn, bool include_public)
 {
   const struct player *pplayer = conn_get_player(pconn);
   bool is_global_observer = conn_is_global_observer(pconn);
+  struct event_cache_index *indices[3];
+  int pos[3], num_indices = 0, i;
   char timestr[64];
   struct packet_chat_msg pcm;
 
-  event_cache_iterate(pdata) {
-    if (event_cache_match(pdata, pplayer,
-                          is_global_observer, include_public)) {
-      if (game.server.event_cache.info) {
-        /* add turn and time to the message */
-        strftime(timestr, sizeof(timestr), "%H:%M:%S",
-                 localtime(&pdata->timestamp));
-        pcm = pdata->packet;
-        fc_snprintf(pcm.message, sizeof(pcm.message), "(T%d - %s) %s",
-                    pdata->packet.turn, timestr, pdata->packet.message);
-        notify_conn_packet(pconn->self, &pcm, FALSE);
-      } else {
-        notify_conn_packet(pconn->self, &pdata->packet, FALSE);
+  if (NULL == ecache.replay_timer || 0 == ecache.count) {
+    return;
+  }
+
+  if (include_public) {
+    indices[num_indices++] = &ecache.all;
+  }
+  if (is_global_observer) {
+    indices[num_indices++] = &ecache.global_observers;
+  }
+  if (NULL != pplayer) {
+    indices[num_indices++] = ecache.players + player_index(pplayer);
+  }
+  for (i = 0; i < num_indices; i++) {
+    event_cache_index_prune(indices[i]);
+    pos[i] = 0;
+  }
+
+  timer_start(ecache.replay_timer);
+  conn_compression_freeze(pconn);
+
+  for (;;) {
+    struct event_cache_data *pdata;
+    unsigned int seq = 0;
+    int best = -1;
+
+    for (i = 0; i < num_indices; i++) {
+      const struct event_cache_index *pindex = indices[i];
+      unsigned int iseq;
+
+      if (pos[i] >= pindex->count) {
+        continue;
+      }
+      iseq = pindex->seqs[(pindex->head + pos[i]) % pindex->size];
+      if (best == -1 || (int) (iseq - seq) < 0) {
+        best = i;
+        seq = iseq;
       }
     }
-  } event_cache_iterate_end;
+    if (best == -1) {
+      break;
+    }
+    pos[best]++;
+
+    pdata = event_cache_entry(seq);
+    if (!event_cache_match(pdata, pplayer,
+                           is_global_observer, include_public)) {
+      continue;
+    }
+
+    event_cache_data_packet(pdata, &pcm);
+    if (game.server.event_cache.info) {
+      /* add turn and time to the message */
+      strftime(timestr, sizeof(timestr), "%H:%M:%S",
+               localtime(&pdata->timestamp));
+      fc_snprintf(pcm.message, sizeof(pcm.message), "(T%d - %s) %s",
+                  pdata->turn, timestr, pdata->message);
+    }
+    notify_conn_packet(pconn->self, &pcm, FALSE);
+  }
+
+  conn_compression_thaw(pconn);
+  timer_stop(ecache.replay_timer);
+  ecache.replays++;
+}
+
+/**************************************************************************
+  Return the number of cached events and the memory used for them, and
+  the number of replays and the total time spent on them since the cache
+  was initialized.
+**************************************************************************/
+void event_cache_stats(int *events, size_t *bytes, int *replays,
+                       double *replay_time)
+{
+  size_t size = ecache.capacity * sizeof(*ecache.entries)
+                + ecache.message_bytes
+                + (ecache.all.size + ecache.global_observers.size)
+                  * sizeof(unsigned int);
+  int i;
+
+  for (i = 0; i < MAX_NUM_PLAYER_SLOTS; i++) {
+    size += ecache.players[i].size * sizeof(unsigned int);
+  }
+
+  *events = ecache.count;
+  *bytes = size;
+  *replays = ecache.replays;
+  *replay_time = (ecache.replay_timer != NULL
+                  ? timer_read_seconds(ecache.replay_timer) : 0.0);
 }
 
 /***************************************************************
@@ -907,7 +1161,7 @@ void event_cache_save(struct section_file *file, const char *section)
   event_cache_status = FALSE;
 
   event_cache_iterate(pdata) {
-    struct tile *ptile = index_to_tile(&(wld.map), pdata->packet.tile);
+    struct tile *ptile = index_to_tile(&(wld.map), pdata->tile);
     char target[MAX_NUM_PLAYER_SLOTS + 1];
     char *p;
     int tile_x = -1, tile_y = -1;
@@ -916,16 +1170,16 @@ void event_cache_save(struct section_file *file, const char *section)
       index_to_map_pos(&tile_x, &tile_y, tile_index(ptile));
     }
 
-    secfile_insert_int(file, pdata->packet.turn, "%s.events%d.turn",
+    secfile_insert_int(file, pdata->turn, "%s.events%d.turn",
                        section, event_count);
-    if (pdata->packet.phase != PHASE_UNKNOWN) {
+    if (pdata->phase != PHASE_UNKNOWN) {
       /* Do not save current value of PHASE_UNKNOWN to savegame.
        * It practically means that "savegame had no phase stored".
        * Note that the only case where phase might be PHASE_UNKNOWN
        * may be present is that the event was loaded from previous
        * savegame created by a freeciv version that did not store event
        * phases. */
-      secfile_insert_int(file, pdata->packet.phase, "%s.events%d.phase",
+      secfile_insert_int(file, pdata->phase, "%s.events%d.phase",
                          section, event_count);
     }
     secfile_insert_int(file, pdata->timestamp, "%s.events%d.timestamp",
@@ -934,7 +1188,7 @@ void event_cache_save(struct section_file *file, const char *section)
     secfile_insert_int(file, tile_y, "%s.events%d.y", section, event_count);
     secfile_insert_str(file, server_states_name(pdata->server_state),
                        "%s.events%d.server_state", section, event_count);
-    secfile_insert_str(file, event_type_name(pdata->packet.event),
+    secfile_insert_str(file, event_type_name(pdata->event),
                        "%s.events%d.event", section, event_count);
     switch (pdata->target_type) {
     case ECT_ALL:
@@ -953,7 +1207,7 @@ void event_cache_save(struct section_file *file, const char *section)
     }
     secfile_insert_str(file, target, "%s.events%d.target",
                        section, event_count);
-    secfile_insert_str(file, pdata->packet.message, "%s.events%d.message",
+    secfile_insert_str(file, pdata->message, "%s.events%d.message",
                        section, event_count);
 
     log_verbose("Event %4d saved.", event_count);
@@ -975,8 +1229,8 @@ void event_cache_save(struct section_file *file, const char *section)
 void event_cache_phases_invalidate(void)
 {
   event_cache_iterate(pdata) {
-    if (pdata->packet.phase >= 0) {
-      pdata->packet.phase = PHASE_INVALIDATED;
+    if (pdata->phase >= 0) {
+      pdata->phase = PHASE_INVALIDATED;
     }
   } event_cache_iterate_end;
 }
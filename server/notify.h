@@ -118,6 +118,8 @@ void event_cache_add_for_players(const struct packet_chat_msg *packet,
                                  struct event_cache_players *players);
 
 void send_pending_events(struct connection *pconn, bool include_public);
+void event_cache_stats(int *events, size_t *bytes, int *replays,
+                       double *replay_time);
 
 void event_cache_phases_invalidate(void);
 
@@ -37,6 +37,7 @@
 #include "packets.h"
 #include "player.h"
 #include "research.h"
+#include "scorelog.h"
 #include "specialist.h"
 #include "unitlist.h"
 #include "version.h"
@@ -57,6 +58,7 @@ struct plrdata_slot {
 
 struct logging_civ_score {
   FILE *fp;
+  enum scorelog_format format;
   int last_turn;
   struct plrdata_slot *plrdata;
 };
@@ -67,11 +69,16 @@ struct history_report latest_history_report = { -2 };
 
 static struct logging_civ_score *score_log = NULL;
 
+/* stdio buffer of binary scorelogs; a turn is written in a few large
+ * records. */
+#define SCORELOG_BUFFER_SIZE (64 * 1024)
+
 static void plrdata_slot_init(struct plrdata_slot *plrdata,
                               const char *name);
 static void plrdata_slot_replace(struct plrdata_slot *plrdata,
                                  const char *name);
 static void plrdata_slot_free(struct plrdata_slot *plrdata);
+static bool scan_score_log_done(const char *id);
 
 static void page_conn_etype(struct conn_list *dest, const char *caption,
 			    const char *headline, const char *lines,
@@ -118,8 +125,6 @@ static const char *historian_name[]={
     N_("Pan Ku")
 };
 
-static const char scorelog_magic[] = "#FREECIV SCORELOG2 ";
-
 struct player_score_entry {
   const struct player *player;
   int value;
@@ -1166,7 +1171,8 @@ static bool scan_score_log(char *id)
     *ptr = '\0';
 
     if (line_nr == 1) {
-      if (strncmp(line, scorelog_magic, strlen(scorelog_magic)) != 0) {
+      if (strncmp(line, SCORELOG_TEXT_MAGIC,
+                  strlen(SCORELOG_TEXT_MAGIC)) != 0) {
         log_error("[%s:%d] Bad file magic!", game.server.scorefile, line_nr);
         return FALSE;
       }
@@ -1260,6 +1266,110 @@ static bool scan_score_log(char *id)
     }
   }
 
+  return scan_score_log_done(id);
+}
+
+/**************************************************************************
+  Reads the whole binary scorelog denoted by fp, past the magic. Does the
+  same checks as scan_score_log(), but reads only the player-turn index
+  of the data records.
+
+  Returns TRUE iff the file had read successfully.
+**************************************************************************/
+static bool scan_score_log_binary(char *id)
+{
+  struct scorelog_record rec;
+  struct plrdata_slot *plrdata;
+  int rec_nr;
+  bool ok = TRUE;
+
+  fc_assert_ret_val(score_log != NULL, FALSE);
+  fc_assert_ret_val(score_log->fp != NULL, FALSE);
+
+  score_log->last_turn = -1;
+  id[0] = '\0';
+  memset(&rec, 0, sizeof(rec));
+
+  for (rec_nr = 1; ok; rec_nr++) {
+    if (!scorelog_binary_read(score_log->fp, &rec, FALSE)) {
+      log_error("[%s:#%d] Can't read scorelog record!",
+                game.server.scorefile, rec_nr);
+      ok = FALSE;
+      break;
+    }
+
+    if (rec.type == SLR_END) {
+      break;
+    }
+
+    switch (rec.type) {
+    case SLR_ID:
+      if (strlen(id) > 0) {
+        log_error("[%s:#%d] Multiple ID entries!", game.server.scorefile,
+                  rec_nr);
+        ok = FALSE;
+        break;
+      }
+      fc_strlcpy(id, rec.text, MAX_LEN_GAME_IDENTIFIER);
+      if (strcmp(id, server.game_identifier) != 0) {
+        log_error("[%s:#%d] IDs don't match! game='%s' scorelog='%s'",
+                  game.server.scorefile, rec_nr, server.game_identifier,
+                  id);
+        ok = FALSE;
+      }
+      break;
+    case SLR_TURN:
+      if (rec.turn <= score_log->last_turn) {
+        log_error("[%s:#%d] Turn %d out of order!", game.server.scorefile,
+                  rec_nr, rec.turn);
+        ok = FALSE;
+        break;
+      }
+      score_log->last_turn = rec.turn;
+      break;
+    case SLR_ADDPLAYER:
+    case SLR_DELPLAYER:
+      if (0 > rec.id || rec.id >= player_slot_count()) {
+        log_error("[%s:#%d] Invalid player number: %d!",
+                  game.server.scorefile, rec_nr, rec.id);
+        ok = FALSE;
+        break;
+      }
+
+      plrdata = score_log->plrdata + rec.id;
+      if (rec.type == SLR_DELPLAYER) {
+        if (plrdata->name == NULL) {
+          log_error("[%s:#%d] Trying to remove undefined player (id %d)!",
+                    game.server.scorefile, rec_nr, rec.id);
+          ok = FALSE;
+          break;
+        }
+        plrdata_slot_free(plrdata);
+      } else {
+        if (plrdata->name != NULL) {
+          log_error("[%s:#%d] Two names for one player (id %d)!",
+                    game.server.scorefile, rec_nr, rec.id);
+          ok = FALSE;
+          break;
+        }
+        plrdata_slot_init(plrdata, rec.text);
+      }
+      break;
+    default:
+      break;
+    }
+  }
+
+  scorelog_record_free(&rec);
+
+  return ok && scan_score_log_done(id);
+}
+
+/**************************************************************************
+  Final checks after a scorelog has been scanned.
+**************************************************************************/
+static bool scan_score_log_done(const char *id)
+{
   if (score_log->last_turn == -1) {
     log_error("[%s:-] Scorelog contains no turn!", game.server.scorefile);
     return FALSE;
@@ -1332,6 +1442,46 @@ void log_civ_score_free(void)
   score_log = NULL;
 }
 
+/**************************************************************************
+  Write one record to the score log, in the format of the log file.
+**************************************************************************/
+static void score_log_write(const struct scorelog_record *prec)
+{
+  if (score_log->format == SLF_TEXT) {
+    scorelog_text_write(score_log->fp, prec);
+  } else {
+    scorelog_binary_write(score_log->fp, prec,
+                          score_log->format == SLF_BINARY_ZLIB);
+  }
+}
+
+/**************************************************************************
+  Write a record which has only a text.
+**************************************************************************/
+static void score_log_text(enum scorelog_record_type type, const char *text)
+{
+  struct scorelog_record rec = { .type = type };
+
+  sz_strlcpy(rec.text, text);
+  score_log_write(&rec);
+}
+
+/**************************************************************************
+  Write an addplayer or delplayer record for pplayer.
+**************************************************************************/
+static void score_log_player(enum scorelog_record_type type, int turn,
+                             const struct player *pplayer)
+{
+  struct scorelog_record rec = {
+    .type = type,
+    .turn = turn,
+    .id = player_number(pplayer)
+  };
+
+  sz_strlcpy(rec.text, player_name(pplayer));
+  score_log_write(&rec);
+}
+
 /**************************************************************************
   Create a log file of the civilizations so you can see what was happening.
 **************************************************************************/
@@ -1339,6 +1489,7 @@ void log_civ_score_now(void)
 {
   enum { SL_CREATE, SL_APPEND, SL_UNSPEC } oper = SL_UNSPEC;
   char id[MAX_LEN_GAME_IDENTIFIER];
+  struct scorelog_record columns;
   int i = 0;
 
   /* Add new tags only at end of this list. Maintaining the order of
@@ -1396,13 +1547,32 @@ void log_civ_score_now(void)
     if (game.info.year == GAME_START_YEAR) {
       oper = SL_CREATE;
     } else {
-      score_log->fp = fc_fopen(game.server.scorefile, "r");
+      score_log->fp = fc_fopen(game.server.scorefile, "rb");
       if (!score_log->fp) {
         oper = SL_CREATE;
       } else {
-        if (!scan_score_log(id)) {
+        bool scanned;
+
+        if (scorelog_binary_check_magic(score_log->fp)) {
+          /* Keep appending binary records; compression is decided per
+           * record, so both binary settings can continue the file. */
+          score_log->format = (game.server.scorelogformat == SLF_TEXT
+                               ? SLF_BINARY : game.server.scorelogformat);
+          scanned = scan_score_log_binary(id);
+        } else {
+          fclose(score_log->fp);
+          score_log->fp = fc_fopen(game.server.scorefile, "r");
+          score_log->format = SLF_TEXT;
+          scanned = (score_log->fp != NULL && scan_score_log(id));
+        }
+        if (!scanned) {
           goto log_civ_score_disable;
         }
+        if ((score_log->format == SLF_TEXT)
+            != (game.server.scorelogformat == SLF_TEXT)) {
+          log_normal(_("Continuing scorelog '%s' in its existing format."),
+                     game.server.scorefile);
+        }
         oper = SL_APPEND;
 
         fclose(score_log->fp);
@@ -1412,31 +1582,39 @@ void log_civ_score_now(void)
 
     switch (oper) {
     case SL_CREATE:
-      score_log->fp = fc_fopen(game.server.scorefile, "w");
+      score_log->format = game.server.scorelogformat;
+      score_log->fp = fc_fopen(game.server.scorefile,
+                               score_log->format == SLF_TEXT ? "w" : "wb");
       if (!score_log->fp) {
         log_error("Can't open scorelog file '%s' for creation!",
                   game.server.scorefile);
         goto log_civ_score_disable;
       }
-      fprintf(score_log->fp, "%s%s\n", scorelog_magic, VERSION_STRING);
-      fprintf(score_log->fp,
-              "\n"
-              "# For a specification of the format of this see doc/README.scorelog or \n"
-              "# <http://svn.gna.org/viewcvs/freeciv/trunk/doc/README.scorelog?view=auto>.\n"
-              "\n");
-
-      fprintf(score_log->fp, "id %s\n", server.game_identifier);
+      if (score_log->format != SLF_TEXT) {
+        setvbuf(score_log->fp, NULL, _IOFBF, SCORELOG_BUFFER_SIZE);
+        scorelog_binary_write_magic(score_log->fp);
+      }
+
+      score_log_text(SLR_VERSION, VERSION_STRING);
+      score_log_text(SLR_ID, server.game_identifier);
       for (i = 0; i < ARRAY_SIZE(score_tags); i++) {
-        fprintf(score_log->fp, "tag %d %s\n", i, score_tags[i].name);
+        struct scorelog_record rec = { .type = SLR_TAG, .id = i };
+
+        sz_strlcpy(rec.text, score_tags[i].name);
+        score_log_write(&rec);
       }
       break;
     case SL_APPEND:
-      score_log->fp = fc_fopen(game.server.scorefile, "a");
+      score_log->fp = fc_fopen(game.server.scorefile,
+                               score_log->format == SLF_TEXT ? "a" : "ab");
       if (!score_log->fp) {
         log_error("Can't open scorelog file '%s' for appending!",
                   game.server.scorefile);
         goto log_civ_score_disable;
       }
+      if (score_log->format != SLF_TEXT) {
+        setvbuf(score_log->fp, NULL, _IOFBF, SCORELOG_BUFFER_SIZE);
+      }
       break;
     default:
       log_error("[%s] bad operation %d", __FUNCTION__, (int) oper);
@@ -1445,8 +1623,14 @@ void log_civ_score_now(void)
   }
 
   if (game.info.turn > score_log->last_turn) {
-    fprintf(score_log->fp, "turn %d %d %s\n", game.info.turn, game.info.year,
-            calendar_text());
+    struct scorelog_record rec = {
+      .type = SLR_TURN,
+      .turn = game.info.turn,
+      .year = game.info.year
+    };
+
+    sz_strlcpy(rec.text, calendar_text());
+    score_log_write(&rec);
     score_log->last_turn = game.info.turn;
   }
 
@@ -1458,8 +1642,7 @@ void log_civ_score_now(void)
       struct player *pplayer = player_slot_get_player(pslot);
 
       if (!GOOD_PLAYER(pplayer)) {
-        fprintf(score_log->fp, "delplayer %d %d\n", game.info.turn - 1,
-                player_number(pplayer));
+        score_log_player(SLR_DELPLAYER, game.info.turn - 1, pplayer);
         plrdata_slot_free(plrdata);
       }
     }
@@ -1474,8 +1657,7 @@ void log_civ_score_now(void)
           break;
         }
       case SL_ALL:
-        fprintf(score_log->fp, "addplayer %d %d %s\n", game.info.turn,
-              player_number(pplayer), player_name(pplayer));
+        score_log_player(SLR_ADDPLAYER, game.info.turn, pplayer);
         plrdata_slot_init(plrdata, player_name(pplayer));
       }
     }
@@ -1495,27 +1677,45 @@ void log_civ_score_now(void)
         if (strcmp(plrdata->name, player_name(pplayer)) != 0) {
           log_debug("player names does not match '%s' != '%s'", plrdata->name,
                   player_name(pplayer));
-          fprintf(score_log->fp, "delplayer %d %d\n", game.info.turn - 1,
-                  player_number(pplayer));
-          fprintf(score_log->fp, "addplayer %d %d %s\n", game.info.turn,
-                  player_number(pplayer), player_name(pplayer));
+          score_log_player(SLR_DELPLAYER, game.info.turn - 1, pplayer);
+          score_log_player(SLR_ADDPLAYER, game.info.turn, pplayer);
           plrdata_slot_replace(plrdata, player_name(pplayer));
         }
       }
     }
   } players_iterate_end;
 
-  for (i = 0; i < ARRAY_SIZE(score_tags); i++) {
-    players_iterate(pplayer) {
-      if (!GOOD_PLAYER(pplayer)
-          || (game.server.scoreloglevel == SL_HUMANS && is_ai(pplayer))) {
-        continue;
-      }
+  /* All values of the turn go into one record; the text format writes
+   * them tag by tag, as before. */
+  columns.type = SLR_COLUMNS;
+  columns.turn = game.info.turn;
+  columns.ntags = ARRAY_SIZE(score_tags);
+  columns.nplayers = 0;
+  columns.players = fc_malloc(player_slot_count()
+                              * sizeof(*columns.players));
+  players_iterate(pplayer) {
+    if (!GOOD_PLAYER(pplayer)
+        || (game.server.scoreloglevel == SL_HUMANS && is_ai(pplayer))) {
+      continue;
+    }
+    columns.players[columns.nplayers++] = player_number(pplayer);
+  } players_iterate_end;
 
-      fprintf(score_log->fp, "data %d %d %d %d\n", game.info.turn, i,
-              player_number(pplayer), score_tags[i].get_value(pplayer));
-    } players_iterate_end;
+  if (columns.nplayers > 0) {
+    columns.values = fc_malloc(columns.ntags * columns.nplayers
+                               * sizeof(*columns.values));
+    for (i = 0; i < ARRAY_SIZE(score_tags); i++) {
+      int p;
+
+      for (p = 0; p < columns.nplayers; p++) {
+        columns.values[i * columns.nplayers + p]
+          = score_tags[i].get_value(player_by_number(columns.players[p]));
+      }
+    }
+    score_log_write(&columns);
+    free(columns.values);
   }
+  free(columns.players);
 
   fflush(score_log->fp);
 
@@ -20,6 +20,7 @@
 #include "log.h"
 
 /* common */
+#include "borders.h"
 #include "city.h"
 #include "game.h"
 #include "government.h"
@@ -660,6 +661,25 @@ void real_sanity_check(const char *file, const char *function, int line)
   check_connections(file, function, line);
 }
 
+/*****************************************************************************
+  Verify that the borders match a full recalculation, i.e. that no border
+  source would claim anything more. Only valid right after the borders
+  have been (re)calculated.
+*****************************************************************************/
+void real_sanity_check_borders(const char *file, const char *function,
+                               int line)
+{
+  if (BORDERS_DISABLED == game.info.borders) {
+    return;
+  }
+
+  whole_map_iterate(&(wld.map), ptile) {
+    if (is_border_source(ptile)) {
+      SANITY_TILE(ptile, map_border_source_settled(ptile));
+    }
+  } whole_map_iterate_end;
+}
+
 /*****************************************************************************
   Verify that the tile has sane values. This should be called after the
   terrain is changed.
@@ -37,6 +37,7 @@
 
 /* server */
 #include "plrhand.h"
+#include "sanitycheck.h"
 #include "score.h"
 #include "srv_main.h"
 
@@ -49,6 +50,10 @@ static int get_spaceship_score(const struct player *pplayer);
 
 #define USER_AREA_MULT 1000
 
+/* How often (in turns) the land areas are checked against a whole map
+ * scan when sanity checks are enabled. */
+#define LANDAREA_CHECK_INTERVAL 5
+
 struct claim_map {
   struct {
     int landarea, settledarea;
@@ -155,8 +160,10 @@ static void print_landarea_map(struct claim_map *pcmap, int turn)
 
 #endif /* LAND_AREA_DEBUG > 2 */
 
+#ifdef SANITY_CHECKING
 /****************************************************************************
-  Count landarea, settled area, and claims map for all players.
+  Count landarea, settled area, and claims map for all players by scanning
+  the whole map. Only used to check get_player_area().
 ****************************************************************************/
 static void build_landarea_map(struct claim_map *pcmap)
 {
@@ -243,6 +250,78 @@ static void get_player_landarea(struct claim_map *pcmap,
 #endif
   }
 }
+#endif /* SANITY_CHECKING */
+
+/****************************************************************************
+  Is the tile inside the city map of one of the player's cities?
+****************************************************************************/
+static bool is_tile_claimed_by(const struct tile *ptile,
+                               const struct player *pplayer)
+{
+  square_iterate(ptile, CITY_MAP_MAX_RADIUS, ctile) {
+    struct city *pcity = tile_city(ctile);
+    int city_x, city_y;
+
+    if (NULL != pcity && city_owner(pcity) == pplayer
+        && city_base_to_city_map(&city_x, &city_y, pcity, ptile)) {
+      return TRUE;
+    }
+  } square_iterate_end;
+
+  return FALSE;
+}
+
+/****************************************************************************
+  Returns the given player's land and settled areas. Gives the same result
+  as build_landarea_map(), but only looks at the tiles of the player's
+  cities and units; with borders the land area is the number of owned
+  tiles, which tile_set_owner() keeps track of.
+****************************************************************************/
+static void get_player_area(const struct player *pplayer,
+                            int *return_landarea, int *return_settledarea)
+{
+  int landarea = 0, settledarea = 0;
+
+  /* City centers and worked tiles. */
+  city_list_iterate(pplayer->cities, pcity) {
+    city_tile_iterate(city_map_radius_sq_get(pcity), city_tile(pcity),
+                      ptile) {
+      struct city *tcity = tile_city(ptile);
+
+      if (!is_ocean_tile(ptile)
+          && (tcity == pcity
+              || (NULL == tcity && tile_worked(ptile) == pcity))) {
+        settledarea++;
+      }
+    } city_tile_iterate_end;
+  } city_list_iterate_end;
+  landarea = settledarea;
+
+  /* Tiles where one of the player's units is the first one. Because of
+   * allied stacking these calculations are a bit off. */
+  unit_list_iterate(pplayer->units, punit) {
+    struct tile *ptile = unit_tile(punit);
+
+    if (unit_list_get(ptile->units, 0) == punit
+        && !is_ocean_tile(ptile)
+        && NULL == tile_city(ptile)
+        && NULL == tile_worked(ptile)) {
+      landarea++;
+      if (is_tile_claimed_by(ptile, pplayer)) {
+        settledarea++;
+      }
+    }
+  } unit_list_iterate_end;
+
+  if (BORDERS_DISABLED != game.info.borders) {
+    /* If borders are enabled, use owner information directly from the
+     * map. Otherwise use the calculations above. */
+    landarea = pplayer->owned_tiles;
+  }
+
+  *return_landarea = USER_AREA_MULT * landarea;
+  *return_settledarea = USER_AREA_MULT * settledarea;
+}
 
 /**************************************************************************
   Calculates the civilization score for the player.
@@ -252,7 +331,6 @@ void calc_civ_score(struct player *pplayer)
   const struct research *presearch;
   struct city *wonder_city;
   int landarea = 0, settledarea = 0;
-  static struct claim_map cmap;
 
   pplayer->score.happy = 0;
   pplayer->score.content = 0;
@@ -302,9 +380,22 @@ void calc_civ_score(struct player *pplayer)
     pplayer->score.literacy += (city_population(pcity) * bonus) / 100;
   } city_list_iterate_end;
 
-  build_landarea_map(&cmap);
-
-  get_player_landarea(&cmap, pplayer, &landarea, &settledarea);
+  get_player_area(pplayer, &landarea, &settledarea);
+#ifdef SANITY_CHECKING
+  if (game.info.turn % LANDAREA_CHECK_INTERVAL == 0) {
+    static struct claim_map cmap;
+    int full_landarea = 0, full_settledarea = 0;
+
+    build_landarea_map(&cmap);
+    get_player_landarea(&cmap, pplayer, &full_landarea, &full_settledarea);
+    fc_assert_msg(landarea == full_landarea,
+                  "%s: land area %d, full map scan %d",
+                  player_name(pplayer), landarea, full_landarea);
+    fc_assert_msg(settledarea == full_settledarea,
+                  "%s: settled area %d, full map scan %d",
+                  player_name(pplayer), settledarea, full_settledarea);
+  }
+#endif /* SANITY_CHECKING */
   pplayer->score.landarea = landarea;
   pplayer->score.settledarea = settledarea;
 
@@ -38,11 +38,16 @@
 #endif
 
 /* utility */
+#include "fcthread.h"
 #include "log.h"
 #include "md5.h"
+#include "mem.h"
 #include "registry.h"
 #include "string_vector.h"
 
+/* common */
+#include "connection.h"
+
 /* common/scriptcore */
 #include "luascript.h"
 #include "luascript_types.h"
@@ -70,11 +75,68 @@ static bool script_fcdb_functions_check(const char *fcdb_luafile);
 static void script_fcdb_cmd_reply(struct fc_lua *lfcl, enum log_level level,
                                   const char *format, ...)
             fc__attribute((__format__ (__printf__, 3, 4)));
+static void script_fcdb_log_defer(struct fc_lua *lfcl, enum log_level level,
+                                  const char *format, ...)
+            fc__attribute((__format__ (__printf__, 3, 4)));
+static enum fcdb_status script_fcdb_call_valist(const char *func_name,
+                                                int nargs, va_list args);
+static enum fcdb_status script_fcdb_call_unlocked(const char *func_name,
+                                                  int nargs, ...);
 
 /*****************************************************************************
-  Lua virtual machine state.
+  Lua virtual machine state. Once the database thread runs, it may only be
+  used while holding lua_mutex.
 *****************************************************************************/
 static struct fc_lua *fcl = NULL;
+static fc_mutex lua_mutex;
+
+/*****************************************************************************
+  A request for the database thread. The thread works on a private copy of
+  the connection, so the connection itself may go away meanwhile; the
+  result is only delivered if a connection with the same id still exists.
+*****************************************************************************/
+struct fcdb_job {
+  enum fcdb_request request;
+  int conn_id;
+  struct connection conn;
+  bool success;
+  fcdb_result_func result_func;
+  enum fcdb_status status;
+};
+
+#define SPECLIST_TAG fcdb_job
+#define SPECLIST_TYPE struct fcdb_job
+#include "speclist.h"
+
+#define fcdb_job_list_iterate(joblist, pjob) \
+  TYPED_LIST_ITERATE(struct fcdb_job, joblist, pjob)
+#define fcdb_job_list_iterate_end LIST_ITERATE_END
+
+/* Log messages of the database thread, replayed by the main thread. */
+struct fcdb_log_msg {
+  enum log_level level;
+  char *msg;
+};
+
+#define SPECLIST_TAG fcdb_log_msg
+#define SPECLIST_TYPE struct fcdb_log_msg
+#include "speclist.h"
+
+#define fcdb_log_msg_list_iterate(msglist, pmsg) \
+  TYPED_LIST_ITERATE(struct fcdb_log_msg, msglist, pmsg)
+#define fcdb_log_msg_list_iterate_end LIST_ITERATE_END
+
+static struct {
+  fc_thread thread;
+  fc_mutex mutex;               /* Protects the lists and 'quit'. */
+  fc_thread_cond cond;
+  struct fcdb_job_list *todo;
+  struct fcdb_job_list *done;
+  struct fcdb_log_msg_list *logs;
+  bool quit;
+  bool running;
+  int pending;                  /* Main thread only. */
+} fcdb_thr;
 
 /*****************************************************************************
   Add fcdb callback functions; these must be defined in the lua script
@@ -173,6 +235,154 @@ static void script_fcdb_cmd_reply(struct fc_lua *lfcl, enum log_level level,
 
   cmd_reply(CMD_FCDB, lfcl->caller, rfc_status, "%s", buf);
 }
+
+/*****************************************************************************
+  Keep a message of the database thread for the main thread; the server
+  log callback sends errors to the clients, which may only be done from
+  the main thread.
+*****************************************************************************/
+static void script_fcdb_log_defer(struct fc_lua *lfcl, enum log_level level,
+                                  const char *format, ...)
+{
+  struct fcdb_log_msg *pmsg = fc_malloc(sizeof(*pmsg));
+  va_list args;
+  char buf[1024];
+
+  va_start(args, format);
+  fc_vsnprintf(buf, sizeof(buf), format, args);
+  va_end(args);
+
+  pmsg->level = level;
+  pmsg->msg = fc_strdup(buf);
+
+  fc_allocate_mutex(&fcdb_thr.mutex);
+  fcdb_log_msg_list_append(fcdb_thr.logs, pmsg);
+  fc_release_mutex(&fcdb_thr.mutex);
+}
+
+/*****************************************************************************
+  Log and free the deferred messages of the database thread.
+*****************************************************************************/
+static void script_fcdb_log_replay(struct fcdb_log_msg_list *logs)
+{
+  fcdb_log_msg_list_iterate(logs, pmsg) {
+    log_base(pmsg->level, "%s", pmsg->msg);
+    free(pmsg->msg);
+    free(pmsg);
+  } fcdb_log_msg_list_iterate_end;
+  fcdb_log_msg_list_destroy(logs);
+}
+
+/*****************************************************************************
+  Run one request in the database thread.
+*****************************************************************************/
+static void script_fcdb_job_run(struct fcdb_job *pjob)
+{
+  const char *func_name = fcdb_request_name(pjob->request);
+
+  fc_allocate_mutex(&lua_mutex);
+  fcl->output_fct = script_fcdb_log_defer;
+  if (pjob->request == FCDB_USER_LOG) {
+    pjob->status = script_fcdb_call_unlocked(func_name, 2,
+                                             API_TYPE_CONNECTION, &pjob->conn,
+                                             API_TYPE_BOOL, pjob->success);
+  } else {
+    pjob->status = script_fcdb_call_unlocked(func_name, 1,
+                                             API_TYPE_CONNECTION, &pjob->conn);
+  }
+  fcl->output_fct = NULL;
+  fc_release_mutex(&lua_mutex);
+}
+
+/*****************************************************************************
+  Main function of the database thread. Runs requests until it is told to
+  quit and nothing is left to do.
+*****************************************************************************/
+static void script_fcdb_thread(void *arg)
+{
+  fc_allocate_mutex(&fcdb_thr.mutex);
+  while (TRUE) {
+    struct fcdb_job *pjob;
+
+    while (!fcdb_thr.quit && fcdb_job_list_size(fcdb_thr.todo) == 0) {
+      fc_thread_cond_wait(&fcdb_thr.cond, &fcdb_thr.mutex);
+    }
+    if (fcdb_job_list_size(fcdb_thr.todo) == 0) {
+      break;
+    }
+
+    pjob = fcdb_job_list_front(fcdb_thr.todo);
+    fcdb_job_list_pop_front(fcdb_thr.todo);
+    fc_release_mutex(&fcdb_thr.mutex);
+
+    script_fcdb_job_run(pjob);
+
+    fc_allocate_mutex(&fcdb_thr.mutex);
+    fcdb_job_list_append(fcdb_thr.done, pjob);
+  }
+  fc_release_mutex(&fcdb_thr.mutex);
+}
+
+/*****************************************************************************
+  Start the database thread.
+*****************************************************************************/
+static void script_fcdb_thread_start(void)
+{
+  if (!has_thread_cond_impl()) {
+    log_verbose("No thread condition support; database requests will "
+                "block the server.");
+    return;
+  }
+
+  fc_init_mutex(&fcdb_thr.mutex);
+  fc_thread_cond_init(&fcdb_thr.cond);
+  fcdb_thr.todo = fcdb_job_list_new();
+  fcdb_thr.done = fcdb_job_list_new();
+  fcdb_thr.logs = fcdb_log_msg_list_new();
+  fcdb_thr.quit = FALSE;
+  fcdb_thr.pending = 0;
+
+  if (fc_thread_start(&fcdb_thr.thread, script_fcdb_thread, NULL) != 0) {
+    log_error("Could not start the database thread; database requests "
+              "will block the server.");
+    fcdb_job_list_destroy(fcdb_thr.todo);
+    fcdb_job_list_destroy(fcdb_thr.done);
+    fcdb_log_msg_list_destroy(fcdb_thr.logs);
+    fc_thread_cond_destroy(&fcdb_thr.cond);
+    fc_destroy_mutex(&fcdb_thr.mutex);
+    return;
+  }
+
+  fcdb_thr.running = TRUE;
+}
+
+/*****************************************************************************
+  Stop the database thread. Requests which are still queued are run first
+  and their results are delivered.
+*****************************************************************************/
+static void script_fcdb_thread_stop(void)
+{
+  if (!fcdb_thr.running) {
+    return;
+  }
+
+  fc_allocate_mutex(&fcdb_thr.mutex);
+  fcdb_thr.quit = TRUE;
+  fc_thread_cond_signal(&fcdb_thr.cond);
+  fc_release_mutex(&fcdb_thr.mutex);
+
+  fc_thread_wait(&fcdb_thr.thread);
+
+  script_fcdb_process_results();
+  fcdb_thr.running = FALSE;
+
+  fc_assert(fcdb_job_list_size(fcdb_thr.done) == 0);
+  script_fcdb_log_replay(fcdb_thr.logs);
+  fcdb_job_list_destroy(fcdb_thr.todo);
+  fcdb_job_list_destroy(fcdb_thr.done);
+  fc_thread_cond_destroy(&fcdb_thr.cond);
+  fc_destroy_mutex(&fcdb_thr.mutex);
+}
 #endif /* HAVE_FCDB */
 
 /*****************************************************************************
@@ -198,6 +408,7 @@ bool script_fcdb_init(const char *fcdb_luafile)
     log_error("Error loading the Freeciv database lua definition.");
     return FALSE;
   }
+  fc_init_mutex(&lua_mutex);
 
   tolua_common_a_open(fcl->state);
   tolua_fcdb_open(fcl->state);
@@ -233,45 +444,206 @@ bool script_fcdb_init(const char *fcdb_luafile)
     script_fcdb_free();
     return FALSE;
   }
+
+  script_fcdb_thread_start();
 #endif /* HAVE_FCDB */
 
   return TRUE;
 }
 
+#ifdef HAVE_FCDB
 /*****************************************************************************
-  Call a lua function.
-
-  Example call to the lua function 'user_load()':
-    script_fcdb_call("user_load", 1, API_TYPE_CONNECTION, pconn);
+  Call a lua function. The caller has to hold lua_mutex.
 *****************************************************************************/
-enum fcdb_status script_fcdb_call(const char *func_name, int nargs, ...)
+static enum fcdb_status script_fcdb_call_valist(const char *func_name,
+                                                int nargs, va_list args)
 {
-#ifdef HAVE_FCDB
   enum fcdb_status status = FCDB_ERROR; /* Default return value. */
   bool success;
   int ret;
 
-  va_list args;
-  va_start(args, nargs);
   success = luascript_func_call_valist(fcl, func_name, &ret, nargs, args);
-  va_end(args);
 
   if (success && fcdb_status_is_valid(ret)) {
     status = (enum fcdb_status) ret;
   }
 
+  return status;
+}
+
+/*****************************************************************************
+  Call a lua function. The caller has to hold lua_mutex.
+*****************************************************************************/
+static enum fcdb_status script_fcdb_call_unlocked(const char *func_name,
+                                                  int nargs, ...)
+{
+  enum fcdb_status status;
+  va_list args;
+
+  va_start(args, nargs);
+  status = script_fcdb_call_valist(func_name, nargs, args);
+  va_end(args);
+
+  return status;
+}
+#endif /* HAVE_FCDB */
+
+/*****************************************************************************
+  Call a lua function and wait for the result.
+
+  Example call to the lua function 'user_load()':
+    script_fcdb_call("user_load", 1, API_TYPE_CONNECTION, pconn);
+*****************************************************************************/
+enum fcdb_status script_fcdb_call(const char *func_name, int nargs, ...)
+{
+#ifdef HAVE_FCDB
+  enum fcdb_status status;
+  va_list args;
+
+  fc_assert_ret_val(fcl != NULL, FCDB_ERROR);
+
+  fc_allocate_mutex(&lua_mutex);
+  va_start(args, nargs);
+  status = script_fcdb_call_valist(func_name, nargs, args);
+  va_end(args);
+  fc_release_mutex(&lua_mutex);
+
   return status;
 #else
   return FCDB_SUCCESS_TRUE;
 #endif /* HAVE_FCDB */
 }
 
+/*****************************************************************************
+  Queue a request for the database thread. 'success' is only used by the
+  FCDB_USER_LOG request. Once the request is done, result_func (if not
+  NULL) is called from script_fcdb_process_results(); it is not called if
+  the connection was closed meanwhile. A password set by FCDB_USER_LOAD
+  is copied to the connection before that.
+
+  Without a database thread the request is run right away.
+*****************************************************************************/
+void script_fcdb_request(enum fcdb_request request, struct connection *pconn,
+                         bool success, fcdb_result_func result_func)
+{
+#ifdef HAVE_FCDB
+  struct fcdb_job *pjob;
+
+  fc_assert_ret(fcdb_request_is_valid(request));
+  fc_assert_ret(conn_is_valid(pconn));
+
+  if (!fcdb_thr.running) {
+    enum fcdb_status status;
+
+    if (request == FCDB_USER_LOG) {
+      status = script_fcdb_call(fcdb_request_name(request), 2,
+                                API_TYPE_CONNECTION, pconn,
+                                API_TYPE_BOOL, success);
+    } else {
+      status = script_fcdb_call(fcdb_request_name(request), 1,
+                                API_TYPE_CONNECTION, pconn);
+    }
+    if (result_func != NULL) {
+      result_func(pconn, status);
+    }
+    return;
+  }
+
+  pjob = fc_calloc(1, sizeof(*pjob));
+  pjob->request = request;
+  pjob->conn_id = pconn->id;
+  pjob->conn.used = TRUE;
+  pjob->conn.id = pconn->id;
+  sz_strlcpy(pjob->conn.username, pconn->username);
+  sz_strlcpy(pjob->conn.server.ipaddr, pconn->server.ipaddr);
+  sz_strlcpy(pjob->conn.server.password, pconn->server.password);
+  pjob->success = success;
+  pjob->result_func = result_func;
+  pjob->status = FCDB_ERROR;
+
+  fcdb_thr.pending++;
+
+  fc_allocate_mutex(&fcdb_thr.mutex);
+  fcdb_job_list_append(fcdb_thr.todo, pjob);
+  fc_thread_cond_signal(&fcdb_thr.cond);
+  fc_release_mutex(&fcdb_thr.mutex);
+#else  /* HAVE_FCDB */
+  if (result_func != NULL) {
+    result_func(pconn, FCDB_SUCCESS_TRUE);
+  }
+#endif /* HAVE_FCDB */
+}
+
+/*****************************************************************************
+  Deliver the results of the finished database requests. Called by the
+  main loop.
+*****************************************************************************/
+void script_fcdb_process_results(void)
+{
+#ifdef HAVE_FCDB
+  struct fcdb_job_list *done;
+  struct fcdb_log_msg_list *logs;
+
+  if (!fcdb_thr.running) {
+    return;
+  }
+
+  fc_allocate_mutex(&fcdb_thr.mutex);
+  if (fcdb_job_list_size(fcdb_thr.done) == 0
+      && fcdb_log_msg_list_size(fcdb_thr.logs) == 0) {
+    fc_release_mutex(&fcdb_thr.mutex);
+    return;
+  }
+  done = fcdb_thr.done;
+  logs = fcdb_thr.logs;
+  fcdb_thr.done = fcdb_job_list_new();
+  fcdb_thr.logs = fcdb_log_msg_list_new();
+  fc_release_mutex(&fcdb_thr.mutex);
+
+  script_fcdb_log_replay(logs);
+
+  fcdb_job_list_iterate(done, pjob) {
+    struct connection *pconn = conn_by_number(pjob->conn_id);
+
+    fcdb_thr.pending--;
+    if (conn_is_valid(pconn)) {
+      if (pjob->request == FCDB_USER_LOAD) {
+        sz_strlcpy(pconn->server.password, pjob->conn.server.password);
+      }
+      if (pjob->result_func != NULL) {
+        pjob->result_func(pconn, pjob->status);
+      }
+    } else {
+      log_debug("Dropping the '%s' result for the closed connection %d.",
+                fcdb_request_name(pjob->request), pjob->conn_id);
+    }
+    free(pjob);
+  } fcdb_job_list_iterate_end;
+  fcdb_job_list_destroy(done);
+#endif /* HAVE_FCDB */
+}
+
+/*****************************************************************************
+  Return the number of database requests whose results were not delivered
+  yet.
+*****************************************************************************/
+int script_fcdb_pending(void)
+{
+#ifdef HAVE_FCDB
+  return fcdb_thr.running ? fcdb_thr.pending : 0;
+#else
+  return 0;
+#endif /* HAVE_FCDB */
+}
+
 /*****************************************************************************
   Free the scripting data.
 *****************************************************************************/
 void script_fcdb_free(void)
 {
 #ifdef HAVE_FCDB
+  script_fcdb_thread_stop();
+
   if (script_fcdb_call("database_free", 0) != FCDB_SUCCESS_TRUE) {
     log_error("Error closing the database connection. Continuing anyway ...");
   }
@@ -280,6 +652,7 @@ void script_fcdb_free(void)
     /* luascript_func_free() is called by luascript_destroy(). */
     luascript_destroy(fcl);
     fcl = NULL;
+    fc_destroy_mutex(&lua_mutex);
   }
 #endif /* HAVE_FCDB */
 }
@@ -295,6 +668,8 @@ bool script_fcdb_do_string(struct connection *caller, const char *str)
   struct connection *save_caller;
   luascript_log_func_t save_output_fct;
 
+  fc_allocate_mutex(&lua_mutex);
+
   /* Set a log callback function which allows to send the results of the
    * command to the clients. */
   save_caller = fcl->caller;
@@ -308,6 +683,8 @@ bool script_fcdb_do_string(struct connection *caller, const char *str)
   fcl->caller = save_caller;
   fcl->output_fct = save_output_fct;
 
+  fc_release_mutex(&lua_mutex);
+
   return (status == 0);
 #else
   return TRUE;
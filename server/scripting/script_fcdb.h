@@ -30,11 +30,32 @@
 #define SPECENUM_VALUE2 FCDB_SUCCESS_FALSE
 #include "specenum_gen.h"
 
+/* Requests which are run in the database thread. The names are the names
+ * of the lua functions. */
+#define SPECENUM_NAME fcdb_request
+#define SPECENUM_VALUE0 FCDB_USER_LOAD
+#define SPECENUM_VALUE0NAME "user_load"
+#define SPECENUM_VALUE1 FCDB_USER_SAVE
+#define SPECENUM_VALUE1NAME "user_save"
+#define SPECENUM_VALUE2 FCDB_USER_LOG
+#define SPECENUM_VALUE2NAME "user_log"
+#include "specenum_gen.h"
+
+struct connection;
+
+typedef void (*fcdb_result_func)(struct connection *pconn,
+                                 enum fcdb_status status);
+
 /* fcdb script functions. */
 bool script_fcdb_init(const char *fcdb_luafile);
 enum fcdb_status script_fcdb_call(const char *func_name, int nargs, ...);
 void script_fcdb_free(void);
 
+void script_fcdb_request(enum fcdb_request request, struct connection *pconn,
+                         bool success, fcdb_result_func result_func);
+void script_fcdb_process_results(void);
+int script_fcdb_pending(void);
+
 bool script_fcdb_do_string(struct connection *caller, const char *str);
 
 #endif /* FC__SCRIPT_FCDB_H */
@@ -329,6 +329,52 @@ void script_server_signal_emit(const char *signal_name, int nargs, ...)
   va_end(args);
 }
 
+/*****************************************************************************
+  Report how often each connected signal callback was invoked and how much
+  time it took, to find expensive scenario scripts.
+*****************************************************************************/
+void script_server_signal_stats(struct connection *caller)
+{
+  const char *signal_name;
+  int i, shown = 0;
+
+  fc_assert_ret(fcl_main != NULL);
+
+  for (i = 0; (signal_name = luascript_signal_by_index(fcl_main, i));
+       i++) {
+    const char *callback_name;
+    int j;
+
+    for (j = 0;
+         (callback_name = luascript_signal_callback_by_index(fcl_main,
+                                                             signal_name,
+                                                             j));
+         j++) {
+      int calls;
+      double seconds;
+
+      if (!luascript_signal_callback_stats(fcl_main, signal_name, j,
+                                           &calls, &seconds)) {
+        continue;
+      }
+
+      if (shown++ == 0) {
+        cmd_reply(CMD_LUA, caller, C_COMMENT,
+                  /* TRANS: column headers; keep the widths. */
+                  _("%-24s %-34s %8s %10s"), _("Signal"), _("Callback"),
+                  _("Calls"), _("Seconds"));
+      }
+      cmd_reply(CMD_LUA, caller, C_COMMENT, "%-24s %-34s %8d %10.4f",
+                signal_name, callback_name, calls, seconds);
+    }
+  }
+
+  if (shown == 0) {
+    cmd_reply(CMD_LUA, caller, C_COMMENT,
+              _("No signal callbacks are connected."));
+  }
+}
+
 /*****************************************************************************
   Declare any new signal types you need here.
 *****************************************************************************/
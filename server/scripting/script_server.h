@@ -38,6 +38,7 @@ void script_server_state_save(struct section_file *file);
 
 /* Signals. */
 void script_server_signal_emit(const char *signal_name, int nargs, ...);
+void script_server_signal_stats(struct connection *caller);
 
 /* Functions */
 bool script_server_call(const char *func_name, int nargs, ...);
@@ -65,6 +65,7 @@
 #include "log.h"
 #include "mem.h"
 #include "netintf.h"
+#include "perfzone.h"
 #include "shared.h"
 #include "support.h"
 #include "timing.h"
@@ -76,6 +77,7 @@
 #include "packets.h"
 
 /* server/scripting */
+#include "script_fcdb.h"
 #include "script_server.h"
 
 /* server */
@@ -122,6 +124,10 @@ static int socklan;
 
 #define PROCESSING_TIME_STATISTICS 0
 
+/* How often the main loop looks for answers of the user database while
+ * requests are pending. */
+#define FCDB_POLLS_PER_SECOND 20
+
 static int server_accept_connection(int sockfd);
 static void start_processing_request(struct connection *pconn,
                                      int request_id);
@@ -348,7 +354,7 @@ static void cut_lagging_connection(struct connection *pconn)
   Attempt to flush all information in the send buffers for upto 'netwait'
   seconds.
 *****************************************************************************/
-void flush_packets(void)
+static void flush_packets_wait(void)
 {
   int i;
   int max_desc;
@@ -412,6 +418,16 @@ void flush_packets(void)
   }
 }
 
+/****************************************************************************
+  Flush the send buffers of all connections, see flush_packets_wait().
+*****************************************************************************/
+void flush_packets(void)
+{
+  PERF_ZONE_BEGIN("flush_packets");
+  flush_packets_wait();
+  PERF_ZONE_END("flush_packets");
+}
+
 struct packet_to_handle {
   void *data;
   enum packet_type type;
@@ -496,6 +512,8 @@ enum server_events server_sniff_all_input(void)
   int i, s;
   int max_desc;
   bool excepting;
+  bool fcdb_wait;
+  int fcdb_idle_polls = 0;
   fd_set readfs, writefs, exceptfs;
   fc_timeval tv;
 #ifdef FREECIV_SOCKET_ZERO_NOT_STDIN
@@ -639,6 +657,9 @@ enum server_events server_sniff_all_input(void)
       game.server.last_ping = time(NULL);
     }
 
+    /* deliver the answers of the user database */
+    script_fcdb_process_results();
+
     /* if we've waited long enough after a failure, respond to the client */
     conn_list_iterate(game.all_connections, pconn) {
       if (srvarg.auth_enabled
@@ -656,8 +677,15 @@ enum server_events server_sniff_all_input(void)
       return S_E_END_OF_TURN_TIMEOUT;
     }
 
-    tv.tv_sec = 1;
-    tv.tv_usec = 0;
+    fcdb_wait = (script_fcdb_pending() > 0);
+    if (fcdb_wait) {
+      /* Look for the database answers more often; see below. */
+      tv.tv_sec = 0;
+      tv.tv_usec = 1000000 / FCDB_POLLS_PER_SECOND;
+    } else {
+      tv.tv_sec = 1;
+      tv.tv_usec = 0;
+    }
 
     FC_FD_ZERO(&readfs);
     FC_FD_ZERO(&writefs);
@@ -696,6 +724,12 @@ enum server_events server_sniff_all_input(void)
 
     if (fc_select(max_desc + 1, &readfs, &writefs, &exceptfs, &tv) == 0) {
       /* timeout */
+      if (fcdb_wait && ++fcdb_idle_polls < FCDB_POLLS_PER_SECOND) {
+        /* Only a short wait for the database; do the things below once
+         * the server was idle for a whole second, as usual. */
+        continue;
+      }
+      fcdb_idle_polls = 0;
       call_ai_refresh();
       script_server_signal_emit("pulse", 0);
       (void) send_server_info_to_metaserver(META_REFRESH);
@@ -749,6 +783,8 @@ enum server_events server_sniff_all_input(void)
       }
     }
 
+    fcdb_idle_polls = 0;
+
     excepting = FALSE;
     for (i = 0; i < listen_count; i++) {
       if (FD_ISSET(listen_socks[i], &exceptfs)) {
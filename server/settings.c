@@ -517,6 +517,23 @@ scoreloglevel_name(enum scorelog_level sl_level)
   return NULL;
 }
 
+/****************************************************************************
+  Scorelog format names accessor.
+****************************************************************************/
+static const struct sset_val_name *
+scorelogformat_name(enum scorelog_format sl_format)
+{
+  switch (sl_format) {
+  NAME_CASE(SLF_TEXT, "TEXT", N_("Text lines"));
+  NAME_CASE(SLF_BINARY, "BINARY", N_("Binary columns"));
+#ifdef FREECIV_HAVE_LIBZ
+  NAME_CASE(SLF_BINARY_ZLIB, "BINARYZ",
+            N_("Binary columns, compressed with zlib"));
+#endif
+  }
+  return NULL;
+}
+
 /****************************************************************************
   Savegame compress type names accessor.
 ****************************************************************************/
@@ -2585,6 +2602,23 @@ static struct setting settings[] = {
                 "     4 = No controller allowed, observers allowed"),
              allowtake_callback, NULL, GAME_DEFAULT_ALLOW_TAKE)
 
+  GEN_INT("aipfbudget", game.server.ai_pf_budget,
+          SSET_META, SSET_INTERNAL, SSET_RARE, ALLOW_NONE, ALLOW_BASIC,
+          N_("AI path-finding budget per player and turn (thousands)"),
+          N_("If set to a positive value, an AI player whose path "
+             "finding has visited more than this many thousand map "
+             "positions during a turn limits its more expensive "
+             "optional searches for the rest of that turn: it stops "
+             "looking for boats to reach targets and city sites "
+             "overseas, and searches for hunter targets and city sites "
+             "only near its units. The budget counts work rather than "
+             "time, so a game plays out the same on any machine. Set "
+             "to zero to never limit AI players. Use '/debug timing' to "
+             "see where the AI spends its time."),
+          NULL, NULL, NULL,
+          GAME_MIN_AI_PF_BUDGET, GAME_MAX_AI_PF_BUDGET,
+          GAME_DEFAULT_AI_PF_BUDGET)
+
   GEN_BOOL("autotoggle", game.server.auto_ai_toggle,
            SSET_META, SSET_NETWORK, SSET_SITUATIONAL,
            ALLOW_NONE, ALLOW_BASIC,
@@ -2884,6 +2918,21 @@ static struct setting settings[] = {
               "or only for human players."), NULL, NULL, NULL,
            scoreloglevel_name, GAME_DEFAULT_SCORELOGLEVEL)
 
+  GEN_ENUM("scorelogformat", game.server.scorelogformat,
+           SSET_META, SSET_INTERNAL, SSET_RARE,
+           ALLOW_HACK, ALLOW_HACK,
+           N_("Scorelog file format"),
+           /* TRANS: The strings between single quotes are setting names
+            * and values and should not be translated. */
+           N_("Format of new score log files. 'TEXT' is the traditional "
+              "line based format; the binary formats store the values of "
+              "each turn column by column and are much smaller and "
+              "faster to process. Use the freeciv-scorelog tool to "
+              "convert, filter and aggregate binary logs. An existing "
+              "'scorefile' is always continued in the format it has."),
+           NULL, NULL, NULL,
+           scorelogformat_name, GAME_DEFAULT_SCORELOGFORMAT)
+
 #ifndef FREECIV_WEB
   GEN_STRING("scorefile", game.server.scorefile,
              SSET_META, SSET_INTERNAL, SSET_SITUATIONAL,
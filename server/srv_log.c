@@ -20,6 +20,7 @@
 /* utility */
 #include "astring.h"
 #include "log.h"
+#include "mem.h"
 #include "shared.h"
 #include "support.h"
 #include "timing.h"
@@ -42,6 +43,61 @@
 
 static struct timer *aitimer[AIT_LAST][2];
 static int recursion[AIT_LAST];
+static int aitimer_calls[AIT_LAST][2];
+static int aitimer_turn = -1;
+static FILE *aitimer_dump = NULL;
+
+#ifdef FREECIV_MEMSTATS
+static FILE *memory_dump = NULL;
+#endif
+
+#ifdef FREECIV_DEBUG
+bool timing_log_enabled = TRUE;
+#else
+bool timing_log_enabled = FALSE;
+#endif
+
+/* Report layout of the AI timers. Each timer is listed after its parent,
+ * which is used for indenting the report. */
+static const struct {
+  enum ai_timer timer;
+  const char *name;
+  int depth;
+} aitimer_report[] = {
+  { AIT_ALL,             "Total AI time",   0 },
+  { AIT_MOVEMAP,         "Movemap",         0 },
+  { AIT_UNITS,           "Units",           0 },
+  { AIT_MILITARY,        "Military",        1 },
+  { AIT_ATTACK,          "Attack",          1 },
+  { AIT_DEFENDERS,       "Defense",         1 },
+  { AIT_FERRY,           "Ferry",           1 },
+  { AIT_RAMPAGE,         "Rampage",         1 },
+  { AIT_BODYGUARD,       "Bodyguard",       1 },
+  { AIT_RECOVER,         "Recover",         1 },
+  { AIT_CARAVAN,         "Caravan",         1 },
+  { AIT_HUNTER,          "Hunter",          1 },
+  { AIT_AIRLIFT,         "Airlift",         1 },
+  { AIT_DIPLOMAT,        "Diplomat",        1 },
+  { AIT_AIRUNIT,         "Air",             1 },
+  { AIT_EXPLORER,        "Explore",         1 },
+  { AIT_EMERGENCY,       "Emergency",       1 },
+  { AIT_FSTK,            "fstk",            0 },
+  { AIT_SETTLERS,        "Settlers",        0 },
+  { AIT_WORKERS,         "Workers",         0 },
+  { AIT_AIDATA,          "AI data",         0 },
+  { AIT_DIPLOMACY,       "Diplomacy",       0 },
+  { AIT_GOVERNMENT,      "Government",      0 },
+  { AIT_TAXES,           "Taxes",           0 },
+  { AIT_CITIES,          "Cities",          0 },
+  { AIT_BUILDINGS,       "Buildings",       1 },
+  { AIT_BUILDING_WANTS,  "Building wants",  2 },
+  { AIT_DANGER,          "Danger",          1 },
+  { AIT_CITY_TERRAIN,    "Worker want",     1 },
+  { AIT_CITY_MILITARY,   "Military want",   1 },
+  { AIT_CITY_SETTLERS,   "Settler want",    1 },
+  { AIT_CITIZEN_ARRANGE, "Citizen arrange", 0 },
+  { AIT_TECH,            "Tech",            0 }
+};
 
 /* General AI logging functions */
 
@@ -121,27 +177,61 @@ void real_unit_log(const char *file, const char *function, int line,
   do_log(file, function, line, FALSE, level, "%s", buffer);
 }
 
+/**************************************************************************
+  Write the per-turn values of all AI timers to the dump file, if one
+  is open. One line per timer: turn,timer,seconds,calls
+**************************************************************************/
+static void timing_log_dump_turn(void)
+{
+  int i;
+
+  if (aitimer_dump == NULL || aitimer_turn < 0) {
+    return;
+  }
+
+  for (i = 0; i < ARRAY_SIZE(aitimer_report); i++) {
+    enum ai_timer timer = aitimer_report[i].timer;
+
+    fprintf(aitimer_dump, "%d,%s,%g,%d\n", aitimer_turn,
+            aitimer_report[i].name,
+            timer_read_seconds(aitimer[timer][0]),
+            aitimer_calls[timer][0]);
+  }
+  fflush(aitimer_dump);
+}
+
+/**************************************************************************
+  Clear the per-turn timers and start counting for the current turn.
+**************************************************************************/
+static void timing_log_new_turn(void)
+{
+  int i;
+
+  timing_log_dump_turn();
+
+  aitimer_turn = game.info.turn;
+  for (i = 0; i < AIT_LAST; i++) {
+    timer_clear(aitimer[i][0]);
+    aitimer_calls[i][0] = 0;
+  }
+}
+
 /**************************************************************************
   Measure the time between the calls.  Used to see where in the AI too
   much CPU is being used.
 **************************************************************************/
 void timing_log_real(enum ai_timer timer, enum ai_timer_activity activity)
 {
-  static int turn = -1;
-
-  if (game.info.turn != turn) {
-    int i;
-
-    turn = game.info.turn;
-    for (i = 0; i < AIT_LAST; i++) {
-      timer_clear(aitimer[i][0]);
-    }
+  if (game.info.turn != aitimer_turn) {
+    timing_log_new_turn();
     fc_assert(activity == TIMER_START);
   }
 
   if (activity == TIMER_START && recursion[timer] == 0) {
     timer_start(aitimer[timer][0]);
     timer_start(aitimer[timer][1]);
+    aitimer_calls[timer][0]++;
+    aitimer_calls[timer][1]++;
     recursion[timer]++;
   } else if (activity == TIMER_STOP && recursion[timer] == 1) {
     timer_stop(aitimer[timer][0]);
@@ -156,59 +246,95 @@ void timing_log_real(enum ai_timer timer, enum ai_timer_activity activity)
 void timing_results_real(void)
 {
   char buf[200];
+  int i;
+
+  if (!timing_log_enabled) {
+    notify_conn(NULL, NULL, E_AI_DEBUG, ftc_log,
+                "  AI timing is disabled; enable it with "
+                "'debug timing on'.");
+    return;
+  }
 
 #ifdef LOG_TIMERS
+  log_test("  --- AI timing results ---");
+#endif
+  notify_conn(NULL, NULL, E_AI_DEBUG, ftc_log,
+              "  --- AI timing results ---");
 
-#define AILOG_OUT(text, which)                                              \
-  fc_snprintf(buf, sizeof(buf), "  %s: %g sec turn, %g sec game", text,     \
-              timer_read_seconds(aitimer[which][0]),                        \
-              timer_read_seconds(aitimer[which][1]));                       \
-  log_test("%s", buf);                                                      \
-  notify_conn(NULL, NULL, E_AI_DEBUG, ftc_log, "%s", buf);
+  for (i = 0; i < ARRAY_SIZE(aitimer_report); i++) {
+    enum ai_timer timer = aitimer_report[i].timer;
 
-  log_test("  --- AI timing results ---");
+    fc_snprintf(buf, sizeof(buf),
+                "  %*s%s: %g sec turn (%d calls), %g sec game (%d calls)",
+                2 * aitimer_report[i].depth, "", aitimer_report[i].name,
+                timer_read_seconds(aitimer[timer][0]),
+                aitimer_calls[timer][0],
+                timer_read_seconds(aitimer[timer][1]),
+                aitimer_calls[timer][1]);
+#ifdef LOG_TIMERS
+    log_test("%s", buf);
+#endif
+    notify_conn(NULL, NULL, E_AI_DEBUG, ftc_log, "%s", buf);
+  }
+}
 
-#else  /* LOG_TIMERS */
+/**************************************************************************
+  Turn AI timing on or off. Timers still running are stopped, as their
+  matching TIMING_LOG() calls may never reach timing_log_real().
+**************************************************************************/
+void timing_log_enable(bool enable)
+{
+  int i;
 
-#define AILOG_OUT(text, which)                                          \
-  fc_snprintf(buf, sizeof(buf), "  %s: %g sec turn, %g sec game", text, \
-              timer_read_seconds(aitimer[which][0]),                    \
-              timer_read_seconds(aitimer[which][1]));                   \
-  notify_conn(NULL, NULL, E_AI_DEBUG, ftc_log, "%s", buf);
+  if (enable == timing_log_enabled) {
+    return;
+  }
 
-#endif /* LOG_TIMERS */
+  for (i = 0; i < AIT_LAST; i++) {
+    if (recursion[i] > 0) {
+      timer_stop(aitimer[i][0]);
+      timer_stop(aitimer[i][1]);
+      recursion[i] = 0;
+    }
+  }
 
-  notify_conn(NULL, NULL, E_AI_DEBUG, ftc_log,
-              "  --- AI timing results ---");
-  AILOG_OUT("Total AI time", AIT_ALL);
-  AILOG_OUT("Movemap", AIT_MOVEMAP);
-  AILOG_OUT("Units", AIT_UNITS);
-  AILOG_OUT(" - Military", AIT_MILITARY);
-  AILOG_OUT(" - Attack", AIT_ATTACK);
-  AILOG_OUT(" - Defense", AIT_DEFENDERS);
-  AILOG_OUT(" - Ferry", AIT_FERRY);
-  AILOG_OUT(" - Rampage", AIT_RAMPAGE);
-  AILOG_OUT(" - Bodyguard", AIT_BODYGUARD);
-  AILOG_OUT(" - Recover", AIT_RECOVER);
-  AILOG_OUT(" - Caravan", AIT_CARAVAN);
-  AILOG_OUT(" - Hunter", AIT_HUNTER);
-  AILOG_OUT(" - Airlift", AIT_AIRLIFT);
-  AILOG_OUT(" - Diplomat", AIT_DIPLOMAT);
-  AILOG_OUT(" - Air", AIT_AIRUNIT);
-  AILOG_OUT(" - Explore", AIT_EXPLORER);
-  AILOG_OUT("fstk", AIT_FSTK);
-  AILOG_OUT("Settlers", AIT_SETTLERS);
-  AILOG_OUT("Workers", AIT_WORKERS);
-  AILOG_OUT("Government", AIT_GOVERNMENT);
-  AILOG_OUT("Taxes", AIT_TAXES);
-  AILOG_OUT("Cities", AIT_CITIES);
-  AILOG_OUT(" - Buildings", AIT_BUILDINGS);
-  AILOG_OUT(" - Danger", AIT_DANGER);
-  AILOG_OUT(" - Worker want", AIT_CITY_TERRAIN);
-  AILOG_OUT(" - Military want", AIT_CITY_MILITARY);
-  AILOG_OUT(" - Settler want", AIT_CITY_SETTLERS);
-  AILOG_OUT("Citizen arrange", AIT_CITIZEN_ARRANGE);
-  AILOG_OUT("Tech", AIT_TECH);
+  /* Timing may be turned on in the middle of a turn, so don't wait
+   * for the next TIMER_START to notice the turn. */
+  if (enable && aitimer_turn != game.info.turn) {
+    timing_log_new_turn();
+  }
+
+  timing_log_enabled = enable;
+}
+
+/**************************************************************************
+  Start writing per-turn AI timing values to the given file in CSV
+  format. Any previously opened dump file is closed first.
+**************************************************************************/
+bool timing_log_dump_open(const char *filename)
+{
+  timing_log_dump_close();
+
+  aitimer_dump = fc_fopen(filename, "w");
+  if (aitimer_dump == NULL) {
+    log_error("Can't open AI timing dump file \"%s\".", filename);
+    return FALSE;
+  }
+  fprintf(aitimer_dump, "turn,timer,seconds,calls\n");
+
+  return TRUE;
+}
+
+/**************************************************************************
+  Write the values of the current turn and close the timing dump file.
+**************************************************************************/
+void timing_log_dump_close(void)
+{
+  if (aitimer_dump != NULL) {
+    timing_log_dump_turn();
+    fclose(aitimer_dump);
+    aitimer_dump = NULL;
+  }
 }
 
 /**************************************************************************
@@ -221,8 +347,11 @@ void timing_log_init(void)
   for (i = 0; i < AIT_LAST; i++) {
     aitimer[i][0] = timer_new(TIMER_CPU, TIMER_ACTIVE);
     aitimer[i][1] = timer_new(TIMER_CPU, TIMER_ACTIVE);
+    aitimer_calls[i][0] = 0;
+    aitimer_calls[i][1] = 0;
     recursion[i] = 0;
   }
+  aitimer_turn = -1;
 }
 
 /**************************************************************************
@@ -232,8 +361,71 @@ void timing_log_free(void)
 {
   int i;
 
+  timing_log_dump_close();
+
   for (i = 0; i < AIT_LAST; i++) {
     timer_destroy(aitimer[i][0]);
     timer_destroy(aitimer[i][1]);
   }
 }
+
+#ifdef FREECIV_MEMSTATS
+/**************************************************************************
+  Write the memory use of each source file to the dump file, if one is
+  open. One line per file: turn,file,live_bytes,peak_bytes,live_blocks,
+  allocs, followed by the sums over all files.
+**************************************************************************/
+void memory_log_dump_turn(int turn)
+{
+  struct mem_stats stats[MEM_STATS_MAX_TAGS], total;
+  int num, i;
+
+  if (memory_dump == NULL) {
+    return;
+  }
+
+  num = mem_stats_get(stats, ARRAY_SIZE(stats), &total);
+  for (i = 0; i < num; i++) {
+    fprintf(memory_dump, "%d,%s,%lu,%lu,%lu,%lu\n", turn, stats[i].tag,
+            (unsigned long) stats[i].live_bytes,
+            (unsigned long) stats[i].peak_bytes,
+            stats[i].live_blocks, stats[i].allocs);
+  }
+  fprintf(memory_dump, "%d,%s,%lu,%lu,%lu,%lu\n", turn, total.tag,
+          (unsigned long) total.live_bytes,
+          (unsigned long) total.peak_bytes,
+          total.live_blocks, total.allocs);
+  fflush(memory_dump);
+}
+
+/**************************************************************************
+  Start writing the memory use of each source file to the given file in
+  CSV format, once per turn. Any previously opened dump file is closed
+  first.
+**************************************************************************/
+bool memory_log_dump_open(const char *filename)
+{
+  memory_log_dump_close();
+
+  memory_dump = fc_fopen(filename, "w");
+  if (memory_dump == NULL) {
+    log_error("Can't open memory dump file \"%s\".", filename);
+    return FALSE;
+  }
+  fprintf(memory_dump,
+          "turn,file,live_bytes,peak_bytes,live_blocks,allocs\n");
+
+  return TRUE;
+}
+
+/**************************************************************************
+  Close the memory dump file.
+**************************************************************************/
+void memory_log_dump_close(void)
+{
+  if (memory_dump != NULL) {
+    fclose(memory_dump);
+    memory_dump = NULL;
+  }
+}
+#endif /* FREECIV_MEMSTATS */
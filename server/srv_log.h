@@ -49,6 +49,7 @@ enum ai_timer {
   AIT_CITIES,
   AIT_CITIZEN_ARRANGE,
   AIT_BUILDINGS,
+  AIT_BUILDING_WANTS,
   AIT_DANGER,
   AIT_TECH,
   AIT_FSTK,
@@ -69,6 +70,7 @@ enum ai_timer {
   AIT_BODYGUARD,
   AIT_FERRY,
   AIT_RAMPAGE,
+  AIT_DIPLOMACY,
   AIT_LAST
 };
 
@@ -118,12 +120,27 @@ void timing_log_free(void);
 void timing_log_real(enum ai_timer timer, enum ai_timer_activity activity);
 void timing_results_real(void);
 
-#ifdef FREECIV_DEBUG
-#define TIMING_LOG(timer, activity) timing_log_real(timer, activity)
+void timing_log_enable(bool enable);
+bool timing_log_dump_open(const char *filename);
+void timing_log_dump_close(void);
+
+#ifdef FREECIV_MEMSTATS
+void memory_log_dump_turn(int turn);
+bool memory_log_dump_open(const char *filename);
+void memory_log_dump_close(void);
+#endif /* FREECIV_MEMSTATS */
+
+/* Timers are compiled in always, but only run when enabled with
+ * '/debug timing on' (or by default in debug builds), so that normal
+ * builds only pay for one flag check per call. */
+extern bool timing_log_enabled;
+
+#define TIMING_LOG(timer, activity)                                         \
+{                                                                           \
+  if (timing_log_enabled) {                                                 \
+    timing_log_real(timer, activity);                                       \
+  }                                                                         \
+}
 #define TIMING_RESULTS() timing_results_real()
-#else  /* FREECIV_DEBUG */
-#define TIMING_LOG(timer, activity)
-#define TIMING_RESULTS()
-#endif /* FREECIV_DEBUG */
 
 #endif  /* FC__SRV_LOG_H */
@@ -52,6 +52,7 @@
 #include "log.h"
 #include "mem.h"
 #include "netintf.h"
+#include "perfzone.h"
 #include "rand.h"
 #include "registry.h"
 #include "support.h"
@@ -923,11 +924,13 @@ static void kill_dying_players(void)
 **************************************************************************/
 static void ai_start_phase(void)
 {
+  PERF_ZONE_BEGIN("ai_first_activities");
   phase_players_iterate(pplayer) {
     if (is_ai(pplayer)) {
       CALL_PLR_AI_FUNC(first_activities, pplayer, pplayer);
     }
   } phase_players_iterate_end;
+  PERF_ZONE_END("ai_first_activities");
   kill_dying_players();
 }
 
@@ -1065,25 +1068,31 @@ static void begin_phase(bool is_new_phase)
   }
 
   /* Must be the first thing as it is needed for lots of functions below! */
+  PERF_ZONE_BEGIN("ai_phase_begin");
   phase_players_iterate(pplayer) {
     /* human players also need this for building advice */
     adv_data_phase_init(pplayer, is_new_phase);
     CALL_PLR_AI_FUNC(phase_begin, pplayer, pplayer, is_new_phase);
   } phase_players_iterate_end;
+  PERF_ZONE_END("ai_phase_begin");
 
   if (is_new_phase) {
     /* Unit "end of turn" activities - of course these actually go at
      * the start of the turn! */
+    PERF_ZONE_BEGIN("update_unit_activities");
     phase_players_iterate(pplayer) {
       update_unit_activities(pplayer);
       flush_packets();
     } phase_players_iterate_end;
+    PERF_ZONE_END("update_unit_activities");
     /* Execute orders after activities have been completed (roads built,
      * pillage done, etc.). */
+    PERF_ZONE_BEGIN("execute_unit_orders");
     phase_players_iterate(pplayer) {
       execute_unit_orders(pplayer);
       flush_packets();
     } phase_players_iterate_end;
+    PERF_ZONE_END("execute_unit_orders");
     phase_players_iterate(pplayer) {
       finalize_unit_phase_beginning(pplayer);
     } phase_players_iterate_end;
@@ -1111,11 +1120,13 @@ static void begin_phase(bool is_new_phase)
 
   if (is_new_phase) {
     /* Try to avoid hiding events under a diplomacy dialog */
+    PERF_ZONE_BEGIN("ai_diplomacy_actions");
     phase_players_iterate(pplayer) {
       if (is_ai(pplayer)) {
         CALL_PLR_AI_FUNC(diplomacy_actions, pplayer, pplayer);
       }
     } phase_players_iterate_end;
+    PERF_ZONE_END("ai_diplomacy_actions");
 
     log_debug("Aistartturn");
     ai_start_phase();
@@ -1196,6 +1207,7 @@ static void end_phase(void)
   send_city_suppression(TRUE);
 
   /* AI end of turn activities */
+  PERF_ZONE_BEGIN("ai_last_activities");
   players_iterate(pplayer) {
     unit_list_iterate(pplayer->units, punit) {
       CALL_PLR_AI_FUNC(unit_turn_end, pplayer, punit);
@@ -1207,12 +1219,14 @@ static void end_phase(void)
       CALL_PLR_AI_FUNC(last_activities, pplayer, pplayer);
     }
   } phase_players_iterate_end;
+  PERF_ZONE_END("ai_last_activities");
 
   /* Refresh cities */
   phase_players_iterate(pplayer) {
     research_get(pplayer)->got_tech = FALSE;
   } phase_players_iterate_end;
 
+  PERF_ZONE_BEGIN("update_city_activities");
   phase_players_iterate(pplayer) {
     do_tech_parasite_effect(pplayer);
     player_restore_units(pplayer);
@@ -1233,6 +1247,7 @@ static void end_phase(void)
     update_bulbs(pplayer, -player_tech_upkeep(pplayer), TRUE);
     flush_packets();
   } phase_players_iterate_end;
+  PERF_ZONE_END("update_city_activities");
 
   /* Some player/global effect may have changed cities' vision range */
   phase_players_iterate(pplayer) {
@@ -1253,6 +1268,7 @@ static void end_phase(void)
   do_have_contacts_effect();
   do_border_vision_effect();
 
+  PERF_ZONE_BEGIN("ai_phase_finished");
   phase_players_iterate(pplayer) {
     CALL_PLR_AI_FUNC(phase_finished, pplayer, pplayer);
     /* This has to be after all access to advisor data. */
@@ -1260,6 +1276,7 @@ static void end_phase(void)
        is initialized for human players also. */
     adv_data_phase_done(pplayer);
   } phase_players_iterate_end;
+  PERF_ZONE_END("ai_phase_finished");
 }
 
 /**************************************************************************
@@ -1281,7 +1298,9 @@ static void end_turn(void)
 
   lsend_packet_end_turn(game.est_connections);
 
-  map_calculate_borders();
+  PERF_ZONE_BEGIN("map_calculate_dirty_borders");
+  map_calculate_dirty_borders();
+  PERF_ZONE_END("map_calculate_dirty_borders");
 
   /* Output some AI measurement information */
   players_iterate(pplayer) {
@@ -1618,6 +1637,10 @@ void server_quit(void)
   rulesets_deinit();
   ruleset_choices_free();
   timing_log_free();
+  perfzone_trace_close();
+#ifdef FREECIV_MEMSTATS
+  memory_log_dump_close();
+#endif
   registry_module_close();
   fc_destroy_mutex(&game.server.mutexes.city_list);
   free_libfreeciv();
@@ -2557,12 +2580,16 @@ static void srv_running(void)
 
   fc_assert(S_S_RUNNING == server_state());
   while (S_S_RUNNING == server_state()) {
+    int turn = game.info.turn;
+
     /* The beginning of a turn.
      *
      * We have to initialize data as well as do some actions.  However when
      * loading a game we don't want to do these actions (like AI unit
      * movement and AI diplomacy). */
+    PERF_ZONE_BEGIN("begin_turn");
     begin_turn(is_new_turn);
+    PERF_ZONE_END("begin_turn");
 
     if (game.server.num_phases != 1) {
       /* We allow everyone to begin adjusting cities and such
@@ -2575,7 +2602,9 @@ static void srv_running(void)
     for (; game.info.phase < game.server.num_phases; game.info.phase++) {
       log_debug("Starting phase %d/%d.", game.info.phase,
                 game.server.num_phases);
+      PERF_ZONE_BEGIN("begin_phase");
       begin_phase(is_new_turn);
+      PERF_ZONE_END("begin_phase");
       if (need_send_pending_events) {
         /* When loading a savegame, we need to send loaded events, after
          * the clients switched to the game page (after the first
@@ -2638,9 +2667,11 @@ static void srv_running(void)
         log_debug("Inresponsive between turns %g seconds", game.server.turn_change_time);
       }
 
+      PERF_ZONE_BEGIN("server_sniff_all_input");
       while (server_sniff_all_input() == S_E_OTHERWISE) {
         /* nothing */
       }
+      PERF_ZONE_END("server_sniff_all_input");
 
       between_turns = timer_renew(between_turns, TIMER_USER, TIMER_ACTIVE);
       timer_start(between_turns);
@@ -2658,7 +2689,9 @@ static void srv_running(void)
        */
       lsend_packet_freeze_client(game.est_connections);
 
+      PERF_ZONE_BEGIN("end_phase");
       end_phase();
+      PERF_ZONE_END("end_phase");
 
       conn_list_do_unbuffer(game.est_connections);
 
@@ -2666,7 +2699,13 @@ static void srv_running(void)
 	break;
       }
     }
+    PERF_ZONE_BEGIN("end_turn");
     end_turn();
+    PERF_ZONE_END("end_turn");
+    perfzone_trace_turn(turn);
+#ifdef FREECIV_MEMSTATS
+    memory_log_dump_turn(turn);
+#endif
     log_debug("Sendinfotometaserver");
     (void) send_server_info_to_metaserver(META_REFRESH);
 
@@ -2871,6 +2910,9 @@ static void srv_ready(void)
   test_random1(2000);
   test_random1(20000);
   test_random1(200000);
+  test_random_stream(200);
+  test_random_stream(20000);
+  test_random_stream(2000000);
 #endif
 
   if (game.info.is_new_game) {
@@ -3172,6 +3214,7 @@ void server_game_free(void)
   log_civ_score_free();
   playercolor_free();
   citymap_free();
+  map_borders_free();
   game_free();
 }
 
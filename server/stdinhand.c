@@ -32,6 +32,7 @@
 #include "fcintl.h"
 #include "log.h"
 #include "mem.h"
+#include "perfzone.h"
 #include "registry.h"
 #include "support.h"            /* fc__attribute, bool type, etc. */
 #include "timing.h"
@@ -57,6 +58,7 @@
 #include "citytools.h"
 #include "connecthand.h"
 #include "diplhand.h"
+#include "fcdb.h"
 #include "gamehand.h"
 #include "mapgen.h"
 #include "maphand.h"
@@ -2622,6 +2624,36 @@ static bool cancelvote_command(struct connection *caller,
   return TRUE;
 }
 
+#ifdef FREECIV_MEMSTATS
+/**************************************************************************
+  Show the source files holding the most memory.
+**************************************************************************/
+static void show_memory_stats(struct connection *caller)
+{
+  struct mem_stats stats[20], total;
+  int num, i;
+
+  num = mem_stats_get(stats, ARRAY_SIZE(stats), &total);
+
+  cmd_reply(CMD_DEBUG, caller, C_COMMENT,
+            _("Memory in use: %lu KiB in %lu blocks (peak %lu KiB)."),
+            (unsigned long) (total.live_bytes / 1024), total.live_blocks,
+            (unsigned long) (total.peak_bytes / 1024));
+  cmd_reply(CMD_DEBUG, caller, C_COMMENT, horiz_line);
+  for (i = 0; i < num; i++) {
+    /* TRANS: memory use of a source file: live KiB, blocks, peak KiB,
+     * number of allocations. */
+    cmd_reply(CMD_DEBUG, caller, C_COMMENT,
+              _("%-28s %9lu KiB %9lu blocks %9lu KiB peak %10lu allocs"),
+              stats[i].tag, (unsigned long) (stats[i].live_bytes / 1024),
+              stats[i].live_blocks,
+              (unsigned long) (stats[i].peak_bytes / 1024),
+              stats[i].allocs);
+  }
+  cmd_reply(CMD_DEBUG, caller, C_COMMENT, horiz_line);
+}
+#endif /* FREECIV_MEMSTATS */
+
 /******************************************************************
   Turn on selective debugging.
 ******************************************************************/
@@ -2632,22 +2664,33 @@ static bool debug_command(struct connection *caller, char *str,
   char *arg[3];
   int ntokens = 0, i;
 
-  if (game.info.is_new_game) {
+  if (str != NULL && strlen(str) > 0) {
+    sz_strlcpy(buf, str);
+    ntokens = get_tokens(buf, arg, 3, TOKEN_DELIMITERS);
+  } else {
+    ntokens = 0;
+  }
+
+  /* A trace, memory or timing dump can be started before the game, to
+   * cover it from the first turn. */
+  if (game.info.is_new_game
+      && (ntokens == 0 || (strcmp(arg[0], "trace") != 0
+                           && strcmp(arg[0], "memory") != 0
+                           && strcmp(arg[0], "timing") != 0))) {
     cmd_reply(CMD_DEBUG, caller, C_SYNTAX,
               _("Can only use this command once game has begun."));
+    for (i = 0; i < ntokens; i++) {
+      free(arg[i]);
+    }
     return FALSE;
   }
   if (check) {
+    for (i = 0; i < ntokens; i++) {
+      free(arg[i]);
+    }
     return TRUE; /* whatever! */
   }
 
-  if (str != NULL && strlen(str) > 0) {
-    sz_strlcpy(buf, str);
-    ntokens = get_tokens(buf, arg, 3, TOKEN_DELIMITERS);
-  } else {
-    ntokens = 0;
-  }
-
   if (ntokens > 0 && strcmp(arg[0], "diplomacy") == 0) {
     struct player *pplayer;
     enum m_pre_result match_result;
@@ -2700,6 +2743,9 @@ static bool debug_command(struct connection *caller, char *str,
     }
   } else if (ntokens > 0 && strcmp(arg[0], "info") == 0) {
     int cities = 0, players = 0, units = 0, citizen_count = 0;
+    int events, replays;
+    size_t event_bytes;
+    double replay_time;
 
     players_iterate(plr) {
       players++;
@@ -2714,6 +2760,15 @@ static bool debug_command(struct connection *caller, char *str,
     notify_conn(game.est_connections, NULL, E_AI_DEBUG, ftc_log,
                 _("players=%d cities=%d citizens=%d units=%d"),
                 players, cities, citizen_count, units);
+
+    event_cache_stats(&events, &event_bytes, &replays, &replay_time);
+    log_normal(_("events=%d (%lu KiB) replays=%d (%.3f s)"),
+               events, (unsigned long) (event_bytes / 1024), replays,
+               replay_time);
+    notify_conn(game.est_connections, NULL, E_AI_DEBUG, ftc_log,
+                _("events=%d (%lu KiB) replays=%d (%.3f s)"),
+                events, (unsigned long) (event_bytes / 1024), replays,
+                replay_time);
   } else if (ntokens > 0 && strcmp(arg[0], "city") == 0) {
     int x, y;
     struct tile *ptile;
@@ -2778,7 +2833,87 @@ static bool debug_command(struct connection *caller, char *str,
       }
     } unit_list_iterate_end;
   } else if (ntokens > 0 && strcmp(arg[0], "timing") == 0) {
-    TIMING_RESULTS();
+    if (ntokens == 1) {
+      TIMING_RESULTS();
+    } else if (ntokens == 2 && strcmp(arg[1], "on") == 0) {
+      timing_log_enable(TRUE);
+      cmd_reply(CMD_DEBUG, caller, C_OK, _("AI timing enabled."));
+    } else if (ntokens == 2 && strcmp(arg[1], "off") == 0) {
+      timing_log_enable(FALSE);
+      timing_log_dump_close();
+      cmd_reply(CMD_DEBUG, caller, C_OK, _("AI timing disabled."));
+    } else if (ntokens == 3 && strcmp(arg[1], "dump") == 0) {
+      if (!is_safe_filename(arg[2]) && is_restricted(caller)) {
+        cmd_reply(CMD_DEBUG, caller, C_FAIL,
+                  _("Name \"%s\" disallowed for security reasons."),
+                  arg[2]);
+      } else if (timing_log_dump_open(arg[2])) {
+        timing_log_enable(TRUE);
+        cmd_reply(CMD_DEBUG, caller, C_OK,
+                  _("Writing per-turn AI timing to \"%s\"."), arg[2]);
+      } else {
+        cmd_reply(CMD_DEBUG, caller, C_FAIL,
+                  _("Could not open \"%s\" for writing."), arg[2]);
+      }
+    } else {
+      cmd_reply(CMD_DEBUG, caller, C_SYNTAX,
+                _("Undefined argument.  Usage:\n%s"),
+                command_synopsis(command_by_number(CMD_DEBUG)));
+    }
+  } else if (ntokens > 0 && strcmp(arg[0], "trace") == 0) {
+    if (ntokens == 2 && strcmp(arg[1], "off") == 0) {
+      if (perfzone_trace_is_open()) {
+        perfzone_trace_close();
+        cmd_reply(CMD_DEBUG, caller, C_OK, _("Trace file closed."));
+      } else {
+        cmd_reply(CMD_DEBUG, caller, C_FAIL, _("No trace is being written."));
+      }
+    } else if (ntokens == 2) {
+      if (!is_safe_filename(arg[1]) && is_restricted(caller)) {
+        cmd_reply(CMD_DEBUG, caller, C_FAIL,
+                  _("Name \"%s\" disallowed for security reasons."),
+                  arg[1]);
+      } else if (perfzone_trace_open(arg[1])) {
+        cmd_reply(CMD_DEBUG, caller, C_OK,
+                  _("Writing server timing trace to \"%s\"."), arg[1]);
+      } else {
+        cmd_reply(CMD_DEBUG, caller, C_FAIL,
+                  _("Could not open \"%s\" for writing."), arg[1]);
+      }
+    } else {
+      cmd_reply(CMD_DEBUG, caller, C_SYNTAX,
+                _("Undefined argument.  Usage:\n%s"),
+                command_synopsis(command_by_number(CMD_DEBUG)));
+    }
+  } else if (ntokens > 0 && strcmp(arg[0], "memory") == 0) {
+#ifdef FREECIV_MEMSTATS
+    if (ntokens == 1) {
+      show_memory_stats(caller);
+    } else if (ntokens == 2 && strcmp(arg[1], "off") == 0) {
+      memory_log_dump_close();
+      cmd_reply(CMD_DEBUG, caller, C_OK, _("Memory dump file closed."));
+    } else if (ntokens == 3 && strcmp(arg[1], "dump") == 0) {
+      if (!is_safe_filename(arg[2]) && is_restricted(caller)) {
+        cmd_reply(CMD_DEBUG, caller, C_FAIL,
+                  _("Name \"%s\" disallowed for security reasons."),
+                  arg[2]);
+      } else if (memory_log_dump_open(arg[2])) {
+        cmd_reply(CMD_DEBUG, caller, C_OK,
+                  _("Writing per-turn memory use to \"%s\"."), arg[2]);
+      } else {
+        cmd_reply(CMD_DEBUG, caller, C_FAIL,
+                  _("Could not open \"%s\" for writing."), arg[2]);
+      }
+    } else {
+      cmd_reply(CMD_DEBUG, caller, C_SYNTAX,
+                _("Undefined argument.  Usage:\n%s"),
+                command_synopsis(command_by_number(CMD_DEBUG)));
+    }
+#else  /* FREECIV_MEMSTATS */
+    cmd_reply(CMD_DEBUG, caller, C_FAIL,
+              _("Memory accounting is not available in this server; "
+                "it must be built with --enable-memstats."));
+#endif /* FREECIV_MEMSTATS */
   } else if (ntokens > 0 && strcmp(arg[0], "ferries") == 0) {
     if (game.server.debug[DEBUG_FERRIES]) {
       game.server.debug[DEBUG_FERRIES] = FALSE;
@@ -4642,6 +4777,8 @@ static bool default_command(struct connection *caller, char *arg, bool check)
 #define SPECENUM_VALUE0NAME "cmd"
 #define SPECENUM_VALUE1     LUA_FILE
 #define SPECENUM_VALUE1NAME "file"
+#define SPECENUM_VALUE2     LUA_STATS
+#define SPECENUM_VALUE2NAME "stats"
 #include "specenum_gen.h"
 
 /*****************************************************************************
@@ -4673,6 +4810,15 @@ static bool lua_command(struct connection *caller, char *arg, bool check)
     result = match_prefix(lua_accessor, lua_args_max() + 1, 0,
                           fc_strncasecmp, NULL, tokens[0], &ind);
 
+    if ((M_PRE_EXACT == result || M_PRE_ONLY == result)
+        && LUA_STATS == ind
+        && (0 != fc_strcasecmp(tokens[0], lua_args_name(ind))
+            || '\0' != *skip_leading_spaces(arg + strlen(tokens[0])))) {
+      /* 'stats' is newer than the deprecated syntax, so anything but
+       * exactly 'lua stats' is taken as a script line. */
+      result = M_PRE_FAIL;
+    }
+
     switch (result) {
     case M_PRE_EXACT:
     case M_PRE_ONLY:
@@ -4707,6 +4853,7 @@ static bool lua_command(struct connection *caller, char *arg, bool check)
 
   switch (ind) {
   case LUA_CMD:
+  case LUA_STATS:
     /* Nothing to check. */
     break;
   case LUA_FILE:
@@ -4756,6 +4903,10 @@ static bool lua_command(struct connection *caller, char *arg, bool check)
   case LUA_CMD:
     ret = script_server_do_string(caller, luaarg);
     break;
+  case LUA_STATS:
+    script_server_signal_stats(caller);
+    ret = TRUE;
+    break;
   case LUA_FILE:
     cmd_reply(CMD_LUA, caller, C_COMMENT,
               _("Loading Freeciv script file '%s'."), real_filename);
@@ -5677,7 +5828,7 @@ static bool fcdb_command(struct connection *caller, char *arg, bool check)
   case FCDB_RELOAD:
     /* Reload database lua script. */
     script_fcdb_free();
-    script_fcdb_init(NULL);
+    script_fcdb_init(fcdb_option_get("script"));
     break;
 
   case FCDB_LUA:
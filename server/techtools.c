@@ -137,6 +137,7 @@ void do_tech_parasite_effect(struct player *pplayer)
 {
   struct effect_list *plist = effect_list_new();
   struct astring effects;
+  char effects_buf[MAX_LEN_MSG];
   struct research *presearch;
   char research_name[MAX_LEN_NAME * 2];
   const char *advance_name;
@@ -186,7 +187,7 @@ void do_tech_parasite_effect(struct player *pplayer)
   /* Notify. */
   research_pretty_name(presearch, research_name, sizeof(research_name));
   advance_name = research_advance_name_translation(presearch, tech);
-  astr_init(&effects);
+  astr_init_buf(&effects, effects_buf, sizeof(effects_buf));
   get_effect_list_req_text(plist, &effects);
 
   notify_player(pplayer, NULL, E_TECH_GAIN, ftc_server,
@@ -393,6 +394,12 @@ void found_new_tech(struct research *presearch, Tech_type_id tech_found,
   } else {
     research_invention_set(presearch, tech_found, TECH_KNOWN);
     research_update(presearch);
+
+    if (advance_has_flag(tech_found, TF_CLAIM_OCEAN)
+        || advance_has_flag(tech_found, TF_CLAIM_OCEAN_LIMITED)) {
+      /* The borders of the players may extend over the ocean now. */
+      map_borders_all_dirty();
+    }
   }
 
   /* Inform players about their new tech. */
@@ -1238,8 +1238,10 @@ static void explain_why_no_action_enabled(struct unit *punit,
       }
 
       if (0 < i) {
-        struct astring astr = ASTRING_INIT;
+        struct astring astr;
+        char buf[MAX_LEN_MSG];
 
+        astr_init_buf(&astr, buf, sizeof(buf));
         notify_player(pplayer, unit_tile(punit),
                       E_BAD_COMMAND, ftc_server,
                       _("Your %s cannot act from %s. "
@@ -1637,8 +1639,10 @@ void illegal_action_msg(struct player *pplayer,
   switch (explnat->kind) {
   case ANEK_ACTOR_UNIT:
     {
-      struct astring astr = ASTRING_INIT;
+      struct astring astr;
+      char buf[MAX_LEN_MSG];
 
+      astr_init_buf(&astr, buf, sizeof(buf));
       if (role_units_translations(&astr,
                                   action_get_role(stopped_action),
                                   TRUE)) {
@@ -1689,8 +1693,10 @@ void illegal_action_msg(struct player *pplayer,
       }
 
       if (0 < i) {
-        struct astring astr = ASTRING_INIT;
+        struct astring astr;
+        char buf[MAX_LEN_MSG];
 
+        astr_init_buf(&astr, buf, sizeof(buf));
         notify_player(pplayer, unit_tile(actor),
                       event, ftc_server,
                       _("Your %s can't do %s from %s. "
@@ -2652,6 +2658,7 @@ static bool city_add_unit(struct player *pplayer, struct unit *punit,
                             API_TYPE_INT, amount,
                             API_TYPE_STRING, "unit_added");
   city_size_add(pcity, amount);
+  map_border_source_dirty(city_tile(pcity));
   /* Make the new people something, otherwise city fails the checks */
   pcity->specialists[DEFAULT_SPECIALIST] += amount;
   citizens_update(pcity, unit_nationality(punit));
@@ -0,0 +1,48 @@
+-- Freeciv - Copyright (C) 2020 - The Freeciv Project
+--   This program is free software; you can redistribute it and/or modify
+--   it under the terms of the GNU General Public License as published by
+--   the Free Software Foundation; either version 2, or (at your option)
+--   any later version.
+--
+--   This program is distributed in the hope that it will be useful,
+--   but WITHOUT ANY WARRANTY; without even the implied warranty of
+--   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+--   GNU General Public License for more details.
+
+-- Database script for fcdb_latency.py. It stands in for a slow database:
+-- there is no backend, every user exists, and user_load() keeps the
+-- database thread busy for a while. The [fcdb] option "spin" sets how
+-- long, in millions of loop rounds. Keep it well below the 5 seconds the
+-- server allows a script call.
+
+local spin = 0
+
+function database_init()
+  spin = tonumber(fcdb.option("spin") or "100") * 1000000
+  return fcdb.status.TRUE
+end
+
+function database_free()
+  return fcdb.status.TRUE
+end
+
+function user_load(conn)
+  local rounds = 0
+
+  for i = 1, spin do
+    rounds = rounds + 1
+  end
+  log.verbose("Loaded user '%s' after %d rounds.",
+              auth.get_username(conn), rounds)
+  auth.set_password(conn, "x")
+
+  return fcdb.status.TRUE
+end
+
+function user_save(conn)
+  return fcdb.status.TRUE
+end
+
+function user_log(conn, success)
+  return fcdb.status.TRUE
+end
@@ -0,0 +1,181 @@
+#!/usr/bin/env python3
+
+#
+# Freeciv - Copyright (C) 2020 - The Freeciv Project
+#   This program is free software; you can redistribute it and/or modify
+#   it under the terms of the GNU General Public License as published by
+#   the Free Software Foundation; either version 2, or (at your option)
+#   any later version.
+#
+#   This program is distributed in the hope that it will be useful,
+#   but WITHOUT ANY WARRANTY; without even the implied warranty of
+#   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#   GNU General Public License for more details.
+#
+
+# Checks that a slow authentication database does not hold up the
+# server. A server with fcdb_latency.lua as its database script is
+# started; while the lookup of one user keeps the database thread busy,
+# a guest logs in. The guest has to be let in well before the lookup
+# is done.
+#
+# Usage: fcdb_latency.py <freeciv-server> [spin] [port]
+#
+# 'spin' is passed to fcdb_latency.lua (default 100). The server has to
+# find its data files, e.g. through FREECIV_DATA_PATH.
+
+import os
+import shutil
+import socket
+import struct
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+import zlib
+
+PACKET_SERVER_JOIN_REQ = 4
+PACKET_SERVER_JOIN_REPLY = 5
+PACKET_AUTHENTICATION_REQ = 6
+
+srcdir = os.path.dirname(os.path.abspath(__file__))
+
+def read_version():
+    """Return the mandatory capability string and the version numbers."""
+    values = {}
+    with open(os.path.join(srcdir, "..", "fc_version")) as f:
+        for line in f:
+            name, sep, value = line.strip().partition("=")
+            if sep and value.startswith('"'):
+                values[name] = value.strip('"')
+    return (values["NETWORK_CAPSTRING_MANDATORY"],
+            int(values["MAJOR_VERSION"]), int(values["MINOR_VERSION"]),
+            int(values["PATCH_VERSION"]))
+
+def string(s):
+    return s.encode() + b"\0"
+
+def recv_exact(sock, n):
+    data = b""
+    while len(data) < n:
+        chunk = sock.recv(n - len(data))
+        if not chunk:
+            raise EOFError
+        data += chunk
+    return data
+
+def recv_packets(sock):
+    """Return the type and body of the next initial protocol packets; a
+    compressed chunk holds several of them."""
+    length, = struct.unpack(">H", recv_exact(sock, 2))
+    if length == 0xffff:
+        # Compressed, with a 32 bit length.
+        length, = struct.unpack(">I", recv_exact(sock, 4))
+        data = zlib.decompress(recv_exact(sock, length - 6))
+    elif length >= 16385:
+        # Compressed.
+        data = zlib.decompress(recv_exact(sock, length - 16385 - 2))
+    else:
+        data = struct.pack(">H", length) + recv_exact(sock, length - 2)
+    types = []
+    while data:
+        # Before the capabilities are known, packet types are one byte.
+        length, ptype = struct.unpack(">HB", data[:3])
+        types.append((ptype, data[3:length]))
+        data = data[length:]
+    return types
+
+def login(port, username, version, results):
+    """Time a login until the server asks for the password or answers
+    the join request."""
+    capability, major, minor, patch = version
+    start = time.time()
+    sock = socket.create_connection(("127.0.0.1", port))
+    body = (string(username) + string(capability) + string("")
+            + struct.pack(">III", major, minor, patch))
+    sock.sendall(struct.pack(">HB", 3 + len(body), PACKET_SERVER_JOIN_REQ)
+                 + body)
+    try:
+        while username not in results:
+            for ptype, body in recv_packets(sock):
+                if ptype == PACKET_AUTHENTICATION_REQ:
+                    results[username] = (time.time() - start,
+                                         "password asked")
+                    break
+                if ptype == PACKET_SERVER_JOIN_REPLY:
+                    results[username] = (time.time() - start,
+                                         "joined" if body[0] else "rejected")
+                    break
+    except (EOFError, ConnectionError):
+        results[username] = (time.time() - start, "disconnected")
+    sock.close()
+
+def wait_for_server(port, server):
+    for i in range(200):
+        if server.poll() is not None:
+            return False
+        try:
+            socket.create_connection(("127.0.0.1", port)).close()
+            return True
+        except ConnectionError:
+            time.sleep(0.1)
+    return False
+
+def main(argv):
+    if len(argv) < 2:
+        sys.stderr.write("Usage: %s <freeciv-server> [spin] [port]\n"
+                         % argv[0])
+        return 2
+    spin = argv[2] if len(argv) > 2 else "100"
+    port = int(argv[3]) if len(argv) > 3 else 5599
+    version = read_version()
+
+    tmpdir = tempfile.mkdtemp()
+    conf = os.path.join(tmpdir, "fcdb.conf")
+    with open(conf, "w") as f:
+        f.write('[fcdb]\nscript="%s"\nspin="%s"\n'
+                % (os.path.join(srcdir, "fcdb_latency.lua"), spin))
+    log = os.path.join(tmpdir, "server.log")
+    server = subprocess.Popen([argv[1], "-p", str(port), "-a", "-D", conf,
+                               "-G", "-d", "3", "-l", log, "-s", tmpdir],
+                              stdin=subprocess.DEVNULL,
+                              stdout=subprocess.DEVNULL,
+                              stderr=subprocess.DEVNULL)
+    try:
+        if not wait_for_server(port, server):
+            sys.stderr.write("The server did not start, see %s.\n" % log)
+            return 1
+
+        results = {}
+        slow = threading.Thread(target=login,
+                                args=(port, "slowuser", version, results))
+        slow.start()
+        # Let the lookup of slowuser start first.
+        time.sleep(0.2)
+        login(port, "guest", version, results)
+        slow.join()
+    finally:
+        server.terminate()
+        server.wait()
+
+    for name in ("slowuser", "guest"):
+        print("%-8s %-15s after %.2f s" % ((name,) + results[name][::-1]))
+
+    slow_time, slow_what = results["slowuser"]
+    guest_time, guest_what = results["guest"]
+    if slow_what != "password asked" or guest_what != "joined":
+        print("FAIL: unexpected answers, see %s" % log)
+        return 1
+    if slow_time < 0.5:
+        print("FAIL: the lookup took only %.2f s; raise 'spin'" % slow_time)
+        return 1
+    if guest_time + 0.2 > slow_time / 2:
+        print("FAIL: the guest waited for the database")
+        return 1
+    print("PASS")
+    shutil.rmtree(tmpdir)
+    return 0
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
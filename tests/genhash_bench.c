@@ -0,0 +1,325 @@
+/***********************************************************************
+ Freeciv - Copyright (C) 2020 - The Freeciv Project
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2, or (at your option)
+   any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+***********************************************************************/
+
+/* Compares flat (open addressing) and chained genhash tables.
+ *
+ * First a randomized run of 3M operations checks that both kinds give
+ * the same results. Then int keys are timed the way the idex tables use
+ * them, and struct keys the way the delta protocol packet caches do.
+ * Build and run with "make -C tests genhash-bench". */
+
+#ifdef HAVE_CONFIG_H
+#include <fc_config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined(__GLIBC__) \
+    && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+#include <malloc.h>
+#define HAVE_MALLINFO2
+#endif
+
+/* utility */
+#include "fciconv.h"
+#include "genhash.h"
+#include "log.h"
+#include "mem.h"
+#include "rand.h"
+#include "shared.h"
+#include "timing.h"
+
+#define BENCH_PROBES 5000000
+#define BENCH_CHURN 2000000
+#define BENCH_MAX_IDS 500000
+#define BENCH_PACKETS 5000
+
+/* Stands in for a cached packet: hashed and compared on two fields. */
+struct bench_packet {
+  int id;
+  int owner;
+  int payload[8];
+};
+
+static int probes[BENCH_PROBES];
+static int nfreed;
+
+/**********************************************************************
+  Hash function of struct bench_packet keys.
+***********************************************************************/
+static genhash_val_t packet_hash(const void *key)
+{
+  const struct bench_packet *ppacket = key;
+
+  return (genhash_val_t) (ppacket->id + (ppacket->owner << 8));
+}
+
+/**********************************************************************
+  Compare function of struct bench_packet keys.
+***********************************************************************/
+static bool packet_comp(const void *key1, const void *key2)
+{
+  const struct bench_packet *ppacket1 = key1, *ppacket2 = key2;
+
+  return (ppacket1->id == ppacket2->id
+          && ppacket1->owner == ppacket2->owner);
+}
+
+/**********************************************************************
+  Free function which only counts its calls.
+***********************************************************************/
+static void count_free(void *ptr)
+{
+  nfreed++;
+}
+
+/**********************************************************************
+  Bytes in use by malloc, if we can know.
+***********************************************************************/
+static size_t heap_used(void)
+{
+#ifdef HAVE_MALLINFO2
+  struct mallinfo2 info = mallinfo2();
+
+  return info.uordblks + info.hblkhd;
+#else
+  return 0;
+#endif
+}
+
+/**********************************************************************
+  Run the same random operations on a chained and a flat table, and
+  exit if they ever disagree.
+***********************************************************************/
+static void check_flat(void)
+{
+  struct genhash *chained = genhash_new_full(NULL, NULL, NULL, NULL, NULL,
+                                             count_free);
+  struct genhash *flat = genhash_new_flat_full(NULL, NULL, NULL, NULL, NULL,
+                                               count_free, 0);
+  int i, size;
+
+  fc_srand(1);
+  for (i = 0; i < 3000000; i++) {
+    /* Many keys first, then few, so that the tables grow and shrink. */
+    int op = fc_rand(6);
+    void *key = FC_INT_TO_PTR(fc_rand(i < 1500000 ? 5000 : 50));
+    void *data = FC_INT_TO_PTR(i);
+    void *key1, *key2, *data1 = NULL, *data2 = NULL;
+    bool ret1, ret2;
+
+    switch (op) {
+    case 0:
+    case 1:
+      ret1 = genhash_insert(chained, key, data);
+      ret2 = genhash_insert(flat, key, data);
+      break;
+    case 2:
+      ret1 = genhash_replace_full(chained, key, data, &key1, &data1);
+      ret2 = genhash_replace_full(flat, key, data, &key2, &data2);
+      ret1 = ret1 && key1 == key2;
+      ret2 = ret2 && key1 == key2;
+      break;
+    case 3:
+    case 4:
+      ret1 = genhash_remove_full(chained, key, &key1, &data1);
+      ret2 = genhash_remove_full(flat, key, &key2, &data2);
+      ret1 = ret1 && key1 == key2;
+      ret2 = ret2 && key1 == key2;
+      break;
+    default:
+      ret1 = genhash_lookup(chained, key, &data1);
+      ret2 = genhash_lookup(flat, key, &data2);
+      break;
+    }
+    if (ret1 != ret2 || data1 != data2
+        || genhash_size(chained) != genhash_size(flat)) {
+      fc_fprintf(stderr, "Operation %d, number %d, differs.\n", op, i);
+      exit(EXIT_FAILURE);
+    }
+
+    if (i % 100000 == 0) {
+      struct genhash *copy = genhash_copy(flat);
+      long sum1 = 0, sum2 = 0;
+
+      if (!genhashs_are_equal(chained, flat)
+          || !genhashs_are_equal(flat, chained)
+          || !genhashs_are_equal(copy, chained)) {
+        fc_fprintf(stderr, "Tables differ after %d operations.\n", i);
+        exit(EXIT_FAILURE);
+      }
+      genhash_iterate(chained, iter) {
+        sum1 += FC_PTR_TO_INT(genhash_iter_key(iter)) * 7
+                + FC_PTR_TO_INT(genhash_iter_value(iter));
+      } genhash_iterate_end;
+      genhash_iterate(copy, iter) {
+        sum2 += FC_PTR_TO_INT(genhash_iter_key(iter)) * 7
+                + FC_PTR_TO_INT(genhash_iter_value(iter));
+      } genhash_iterate_end;
+      if (sum1 != sum2) {
+        fc_fprintf(stderr, "Iteration differs after %d operations.\n", i);
+        exit(EXIT_FAILURE);
+      }
+      genhash_destroy(copy);
+    }
+  }
+
+  nfreed = 0;
+  size = genhash_size(flat);
+  genhash_clear(flat);
+  if (nfreed != size) {
+    fc_fprintf(stderr, "Clearing freed %d of %d entries.\n", nfreed, size);
+    exit(EXIT_FAILURE);
+  }
+  fc_printf("Flat and chained tables agree on 3M operations.\n");
+
+  genhash_destroy(chained);
+  genhash_destroy(flat);
+}
+
+/**********************************************************************
+  Time int keys like the idex tables: lookups with 10% misses (units
+  which died meanwhile), and units dying and being built.
+***********************************************************************/
+static void bench_ids(bool flat, int nids)
+{
+  static int ids[BENCH_MAX_IDS];
+  struct timer *ptimer;
+  struct genhash *phash;
+  size_t heap = heap_used();
+  int next_id = 100, found = 0;
+  int i, r;
+
+  fc_assert_ret(nids <= BENCH_MAX_IDS);
+
+  ptimer = timer_new(TIMER_USER, TIMER_ACTIVE);
+  phash = (flat
+           ? genhash_new_flat_full(NULL, NULL, NULL, NULL, NULL, NULL, 0)
+           : genhash_new_full(NULL, NULL, NULL, NULL, NULL, NULL));
+  timer_start(ptimer);
+  for (i = 0; i < nids; i++) {
+    ids[i] = next_id++;
+    genhash_replace(phash, FC_INT_TO_PTR(ids[i]), &ids[i]);
+  }
+  timer_stop(ptimer);
+  fc_printf("%-7s %6d ids: %5.1f bytes/entry, fill %6.1f ms",
+            flat ? "flat" : "chained", nids,
+            (double) (heap_used() - heap) / nids,
+            timer_read_seconds(ptimer) * 1000.0);
+
+  fc_srand(2);
+  for (r = 0; r < BENCH_PROBES; r++) {
+    probes[r] = (r % 10 ? ids[fc_rand(nids)] : next_id + fc_rand(nids));
+  }
+  timer_clear(ptimer);
+  timer_start(ptimer);
+  for (r = 0; r < BENCH_PROBES; r++) {
+    void *data;
+
+    if (genhash_lookup(phash, FC_INT_TO_PTR(probes[r]), &data)) {
+      found++;
+    }
+  }
+  timer_stop(ptimer);
+  fc_printf(", 5M lookups %6.1f ms", timer_read_seconds(ptimer) * 1000.0);
+
+  for (r = 0; r < BENCH_CHURN; r++) {
+    probes[r] = fc_rand(nids);
+  }
+  timer_clear(ptimer);
+  timer_start(ptimer);
+  for (r = 0; r < BENCH_CHURN; r++) {
+    i = probes[r];
+    genhash_remove(phash, FC_INT_TO_PTR(ids[i]));
+    ids[i] = next_id++;
+    genhash_replace(phash, FC_INT_TO_PTR(ids[i]), &ids[i]);
+  }
+  timer_stop(ptimer);
+  fc_printf(", 2M remove+insert %6.1f ms (%d)\n",
+            timer_read_seconds(ptimer) * 1000.0, found);
+
+  genhash_destroy(phash);
+  timer_destroy(ptimer);
+}
+
+/**********************************************************************
+  Time struct keys like the packet caches; one lookup in 20 misses, as
+  for a new receiver.
+***********************************************************************/
+static void bench_packets(bool flat)
+{
+  static struct bench_packet keys[BENCH_PACKETS];
+  struct timer *ptimer = timer_new(TIMER_USER, TIMER_ACTIVE);
+  struct genhash *phash;
+  int found = 0;
+  int i, r;
+
+  phash = (flat
+           ? genhash_new_flat_full(packet_hash, packet_comp, NULL, NULL,
+                                   NULL, fc_real_free, 0)
+           : genhash_new_full(packet_hash, packet_comp, NULL, NULL, NULL,
+                              fc_real_free));
+  for (i = 0; i < BENCH_PACKETS; i++) {
+    struct bench_packet *ppacket = fc_malloc(sizeof(*ppacket));
+
+    keys[i].id = i * 3;
+    keys[i].owner = i % 7;
+    *ppacket = keys[i];
+    genhash_insert(phash, ppacket, ppacket);
+  }
+
+  fc_srand(3);
+  for (r = 0; r < BENCH_PROBES; r++) {
+    probes[r] = fc_rand(BENCH_PACKETS);
+  }
+  timer_start(ptimer);
+  for (r = 0; r < BENCH_PROBES; r++) {
+    struct bench_packet probe = keys[probes[r]];
+    void *data;
+
+    if (r % 20 == 0) {
+      probe.owner = 9;
+    }
+    if (genhash_lookup(phash, &probe, &data)) {
+      found++;
+    }
+  }
+  timer_stop(ptimer);
+  fc_printf("%-7s packet cache, %d entries: 5M lookups %6.1f ms (%d)\n",
+            flat ? "flat" : "chained", BENCH_PACKETS,
+            timer_read_seconds(ptimer) * 1000.0, found);
+
+  genhash_destroy(phash);
+  timer_destroy(ptimer);
+}
+
+/**********************************************************************
+  Entry point.
+***********************************************************************/
+int main(int argc, char *argv[])
+{
+  const int sizes[] = { 2000, 20000, 500000 };
+  int i;
+
+  check_flat();
+
+  for (i = 0; i < ARRAY_SIZE(sizes); i++) {
+    bench_ids(FALSE, sizes[i]);
+    bench_ids(TRUE, sizes[i]);
+  }
+  bench_packets(FALSE);
+  bench_packets(TRUE);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,77 @@
+#!/bin/sh
+#
+# Time the stages of the map generator at several map sizes and with
+# several generators.
+#
+# Usage: mapgen_bench.sh <freeciv-server> [sizes] [generators]
+#
+# Sizes are in thousands of tiles, as for the 'size' server setting.
+# Each map is made by a one-turn game of two AI players, with a
+# performance trace ('debug trace') open from the start. The stage times
+# are read back from the "mapgen ..." zones of the trace. The server has
+# to find its data files, e.g. through FREECIV_DATA_PATH.
+
+server="$1"
+sizes="${2:-16 64 256 1024}"
+generators="${3:-FRACTAL RANDOM ISLAND FRACTURE}"
+
+if test -z "$server" ; then
+  echo "Usage: $0 <freeciv-server> [sizes] [generators]" >&2
+  exit 1
+fi
+
+tmp=`mktemp -d` || exit 1
+trap 'rm -rf "$tmp"' 0
+
+echo "# Map generation time (seconds) by stage:"
+printf "%-9s %5s" generator size
+printf " %7s" setup hmap land temp relief terrain rivers water res start \
+  total
+printf "\n"
+
+for generator in $generators ; do
+  for size in $sizes ; do
+    rm -f "$tmp/trace.json"
+    cat > "$tmp/bench.serv" <<EOF
+set mapsize FULLSIZE
+set size $size
+set generator $generator
+set mapseed 1
+set gameseed 1
+set aifill 2
+set minplayers 0
+set endturn 1
+set timeout -1
+set autosaves ""
+debug trace $tmp/trace.json
+start
+EOF
+    "$server" -r "$tmp/bench.serv" -s "$tmp" -l "$tmp/server.log" -d 1 \
+      < /dev/null > /dev/null 2>&1
+
+    if ! test -f "$tmp/trace.json" ; then
+      echo "$generator $size: no trace written, see the server log:" >&2
+      cat "$tmp/server.log" >&2
+      exit 1
+    fi
+
+    # Complete events look like
+    # {"name":"mapgen rivers","ph":"X",...,"dur":123.456},
+    awk -F'"' -v gen="$generator" -v size="$size" '
+      $4 ~ /^mapgen/ && $8 == "X" {
+        dur = $0
+        sub(/.*"dur":/, "", dur)
+        sub(/}.*/, "", dur)
+        sec[$4] += dur / 1e6
+      }
+      END {
+        printf "%-9s %5s", gen, size
+        n = split("setup,height map,land,temperature,relief,terrains," \
+                  "rivers,water,resources,startpos", stage, ",")
+        for (i = 1; i <= n; i++) {
+          printf " %7.2f", sec["mapgen " stage[i]]
+        }
+        printf " %7.2f\n", sec["mapgen"]
+      }' "$tmp/trace.json"
+  done
+done
@@ -0,0 +1,253 @@
+/***********************************************************************
+ Freeciv - Copyright (C) 2020 - The Freeciv Project
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2, or (at your option)
+   any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+***********************************************************************/
+
+/* Compares the way server/notify.c used to build chat packets with the
+ * way it does now, over a turn's worth of event messages.
+ *
+ * The old way formats into a buffer, makes a capitalized copy of it,
+ * copies that into the packet (zero filling the rest of it) and copies
+ * the whole packet once more for the recipients. The new way formats
+ * straight into the packet, capitalizes it in place and hands the same
+ * packet to every recipient. Lists of unit types are built in a stack
+ * buffer with astr_init_buf() instead of allocated storage. Sending is
+ * replaced with reading the packet.
+ * Build and run with "make -C tests notify-bench". */
+
+#ifdef HAVE_CONFIG_H
+#include <fc_config.h>
+#endif
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* utility */
+#include "astring.h"
+#include "fciconv.h"
+#include "fcintl.h"
+#include "support.h"
+#include "timing.h"
+
+/* common */
+#include "featured_text.h"
+#include "packets.h"
+
+/* Messages in a turn, and how many of them carry an "or" list. */
+#define BENCH_MESSAGES 8000
+#define BENCH_LISTS 1000
+#define BENCH_RUNS 50
+
+static volatile int sink;
+
+/**********************************************************************
+  Stands in for send_packet_chat_msg(): reads the packet.
+***********************************************************************/
+static void bench_send(const struct packet_chat_msg *packet)
+{
+  sink += packet->message[3] + packet->tile;
+}
+
+/**********************************************************************
+  Fill the packet like package_event_full() used to.
+***********************************************************************/
+static void package_old(struct packet_chat_msg *packet,
+                        const struct ft_color color,
+                        const char *format, va_list vargs)
+{
+  char buf[MAX_LEN_MSG];
+  char *str;
+
+  packet->tile = 5;
+  packet->event = E_CITY_GROWTH;
+  packet->conn_id = -1;
+  packet->turn = 2;
+  packet->phase = 0;
+
+  fc_vsnprintf(buf, sizeof(buf), format, vargs);
+  if (is_capitalization_enabled()) {
+    str = capitalized_string(buf);
+  } else {
+    str = buf;
+  }
+
+  if (ft_color_requested(color)) {
+    featured_text_apply_tag(str, packet->message, sizeof(packet->message),
+                            TTT_COLOR, 0, FT_OFFSET_UNSET, color);
+  } else {
+    strncpy(packet->message, str, sizeof(packet->message));
+  }
+
+  if (is_capitalization_enabled()) {
+    free_capitalized(str);
+  }
+}
+
+/**********************************************************************
+  Fill the packet like package_event_full() does now.
+***********************************************************************/
+static void package_new(struct packet_chat_msg *packet,
+                        const struct ft_color color,
+                        const char *format, va_list vargs)
+{
+  char buf[MAX_LEN_MSG];
+
+  packet->tile = 5;
+  packet->event = E_CITY_GROWTH;
+  packet->conn_id = -1;
+  packet->turn = 2;
+  packet->phase = 0;
+
+  if (ft_color_requested(color)) {
+    fc_vsnprintf(buf, sizeof(buf), format, vargs);
+    capitalize_in_place(buf);
+    featured_text_apply_tag(buf, packet->message, sizeof(packet->message),
+                            TTT_COLOR, 0, FT_OFFSET_UNSET, color);
+  } else {
+    fc_vsnprintf(packet->message, sizeof(packet->message), format, vargs);
+    capitalize_in_place(packet->message);
+  }
+}
+
+/**********************************************************************
+  Build a message and send it to nconns connections, the old or the new
+  way. Only the first connection gets to see the tile.
+***********************************************************************/
+static void bench_notify(bool new_way, int nconns,
+                         const struct ft_color color,
+                         const char *format, ...)
+{
+  struct packet_chat_msg genmsg;
+  va_list args;
+  int tile, i;
+
+  va_start(args, format);
+  if (new_way) {
+    package_new(&genmsg, color, format, args);
+  } else {
+    package_old(&genmsg, color, format, args);
+  }
+  va_end(args);
+
+  tile = genmsg.tile;
+  if (new_way) {
+    for (i = 0; i < nconns; i++) {
+      genmsg.tile = (0 == i ? tile : -1);
+      bench_send(&genmsg);
+    }
+    genmsg.tile = tile;
+  } else {
+    struct packet_chat_msg real_packet = genmsg;
+
+    for (i = 0; i < nconns; i++) {
+      real_packet.tile = (0 == i ? tile : -1);
+      bench_send(&real_packet);
+    }
+  }
+}
+
+/**********************************************************************
+  Send one turn of messages: a third of them colored, half of them to
+  two connections, and some with a list of unit types.
+***********************************************************************/
+static void bench_turn(bool new_way)
+{
+  static const char *const types[] = {
+    "Warriors", "Phalanx", "Archers", "Legion"
+  };
+  int i;
+
+  for (i = 0; i < BENCH_MESSAGES; i++) {
+    bench_notify(new_way, 1 + i % 2, 0 == i % 3 ? ftc_server : ftc_any,
+                 "%s grows to size %d.", "amsterdam", i % 30);
+  }
+
+  for (i = 0; i < BENCH_LISTS; i++) {
+    struct astring astr = ASTRING_INIT;
+    char buf[MAX_LEN_MSG];
+
+    if (new_way) {
+      astr_init_buf(&astr, buf, sizeof(buf));
+    }
+    bench_notify(new_way, 1, ftc_any, "Only %s can act from here.",
+                 astr_build_or_list(&astr, types, ARRAY_SIZE(types)));
+    astr_free(&astr);
+  }
+}
+
+/**********************************************************************
+  Check that an astring moves out of a too small buffer of the caller
+  when it grows, and exit if it doesn't.
+***********************************************************************/
+static void check_astr_init_buf(void)
+{
+  struct astring astr;
+  char small[8];
+  char *str;
+
+  astr_init_buf(&astr, small, sizeof(small));
+  astr_set(&astr, "abc");
+  if (0 != strcmp(astr_str(&astr), "abc") || astr_str(&astr) != small) {
+    fc_fprintf(stderr, "A short string left the buffer.\n");
+    exit(EXIT_FAILURE);
+  }
+  astr_add(&astr, "defghijklmnop%d", 42);
+  if (0 != strcmp(astr_str(&astr), "abcdefghijklmnop42")
+      || astr_str(&astr) == small) {
+    fc_fprintf(stderr, "A long string stayed in the buffer.\n");
+    exit(EXIT_FAILURE);
+  }
+  astr_free(&astr);
+
+  astr_init_buf(&astr, small, sizeof(small));
+  astr_add_line(&astr, "x");
+  astr_add_line(&astr, "y");
+  str = astr_to_str(&astr);
+  if (0 != strcmp(str, "x\ny") || str == small) {
+    fc_fprintf(stderr, "astr_to_str() returned the buffer.\n");
+    exit(EXIT_FAILURE);
+  }
+  free(str);
+}
+
+/**********************************************************************
+  Entry point.
+***********************************************************************/
+int main(int argc, char *argv[])
+{
+  struct timer *ptimer = timer_new(TIMER_USER, TIMER_ACTIVE);
+  double best[2] = { -1.0, -1.0 };
+  int run, way;
+
+  check_astr_init_buf();
+  capitalization_opt_in(TRUE);
+
+  for (run = 0; run < BENCH_RUNS; run++) {
+    for (way = 0; way < 2; way++) {
+      timer_clear(ptimer);
+      timer_start(ptimer);
+      bench_turn(1 == way);
+      timer_stop(ptimer);
+      if (0 > best[way] || timer_read_seconds(ptimer) < best[way]) {
+        best[way] = timer_read_seconds(ptimer);
+      }
+    }
+  }
+
+  fc_printf("%d messages, %d with a list; best of %d turns: "
+            "old %.2f ms, new %.2f ms\n", BENCH_MESSAGES, BENCH_LISTS,
+            BENCH_RUNS, best[0] * 1000.0, best[1] * 1000.0);
+  timer_destroy(ptimer);
+
+  return EXIT_SUCCESS;
+}
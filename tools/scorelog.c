@@ -0,0 +1,844 @@
+/***********************************************************************
+ Freeciv - Copyright (C) 1996 - A Kjeldberg, L Gregersen, P Unold
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2, or (at your option)
+   any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+***********************************************************************/
+
+/* freeciv-scorelog: convert, filter and aggregate score logs written by
+ * the server, in either the text or the binary format. */
+
+#ifdef HAVE_CONFIG_H
+#include <fc_config.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+/* utility */
+#include "fc_cmdline.h"
+#include "fciconv.h"
+#include "fcintl.h"
+#include "log.h"
+#include "mem.h"
+#include "shared.h"
+#include "support.h"
+
+/* common */
+#include "fc_cmdhelp.h"
+#include "fc_types.h"
+#include "scorelog.h"
+#include "version.h"
+
+enum sl_aggregate {
+  SLA_NONE = 0,
+  SLA_LAST,
+  SLA_MIN,
+  SLA_MAX,
+  SLA_SUM,
+  SLA_AVG
+};
+
+/* A whole score log, as a list of records in file order. */
+struct sl_log {
+  struct scorelog_record *recs;
+  int count;
+  int alloced;
+};
+
+static struct {
+  const char *output;
+  enum scorelog_format format;
+  char *tags;
+  char *players;
+  int first_turn;
+  int last_turn;
+  enum sl_aggregate aggregate;
+  int num_inputs;
+  char **inputs;
+} sl_args = {
+  .output = NULL,
+  .format = SLF_TEXT,
+  .tags = NULL,
+  .players = NULL,
+  .first_turn = -1,
+  .last_turn = -1,
+  .aggregate = SLA_NONE,
+  .num_inputs = 0,
+  .inputs = NULL
+};
+
+/**************************************************************************
+  Append a record to the log. Ownership of the arrays of a SLR_COLUMNS
+  record passes to the log.
+**************************************************************************/
+static void sl_log_append(struct sl_log *plog,
+                          const struct scorelog_record *prec)
+{
+  if (plog->count == plog->alloced) {
+    plog->alloced = MAX(64, 2 * plog->alloced);
+    plog->recs = fc_realloc(plog->recs,
+                            plog->alloced * sizeof(*plog->recs));
+  }
+  plog->recs[plog->count++] = *prec;
+}
+
+/**************************************************************************
+  Free all records of the log.
+**************************************************************************/
+static void sl_log_free(struct sl_log *plog)
+{
+  int i;
+
+  for (i = 0; i < plog->count; i++) {
+    scorelog_record_free(plog->recs + i);
+  }
+  free(plog->recs);
+  plog->recs = NULL;
+  plog->count = plog->alloced = 0;
+}
+
+/**************************************************************************
+  Read a binary score log; fp is positioned after the magic.
+**************************************************************************/
+static bool sl_read_binary(FILE *fp, const char *filename,
+                           struct sl_log *plog)
+{
+  struct scorelog_record rec;
+
+  memset(&rec, 0, sizeof(rec));
+  for (;;) {
+    if (!scorelog_binary_read(fp, &rec, TRUE)) {
+      fc_fprintf(stderr, _("%s: broken record %d.\n"), filename,
+                 plog->count + 1);
+      scorelog_record_free(&rec);
+      return FALSE;
+    }
+    if (rec.type == SLR_END) {
+      break;
+    }
+
+    sl_log_append(plog, &rec);
+    /* The log owns the arrays now. */
+    rec.players = NULL;
+    rec.values = NULL;
+  }
+
+  return TRUE;
+}
+
+/* Data lines of the text format collected into one SLR_COLUMNS record. */
+struct sl_data_line {
+  int tag, player, value;
+};
+
+struct sl_pending {
+  int turn;
+  int count;
+  int alloced;
+  struct sl_data_line *lines;
+};
+
+/**************************************************************************
+  Turn the collected data lines into one SLR_COLUMNS record. Players are
+  ordered by first appearance, so text -> binary -> text gives the same
+  lines as long as the text log was written by the server.
+**************************************************************************/
+static void sl_pending_flush(struct sl_pending *pend, struct sl_log *plog)
+{
+  struct scorelog_record rec;
+  int i, p;
+
+  if (pend->count == 0) {
+    return;
+  }
+
+  memset(&rec, 0, sizeof(rec));
+  rec.type = SLR_COLUMNS;
+  rec.turn = pend->turn;
+  rec.players = fc_malloc(pend->count * sizeof(*rec.players));
+  for (i = 0; i < pend->count; i++) {
+    const struct sl_data_line *pline = pend->lines + i;
+
+    rec.ntags = MAX(rec.ntags, pline->tag + 1);
+    for (p = 0; p < rec.nplayers; p++) {
+      if (rec.players[p] == pline->player) {
+        break;
+      }
+    }
+    if (p == rec.nplayers) {
+      rec.players[rec.nplayers++] = pline->player;
+    }
+  }
+
+  rec.values = fc_malloc(rec.ntags * rec.nplayers * sizeof(*rec.values));
+  for (i = 0; i < rec.ntags * rec.nplayers; i++) {
+    rec.values[i] = SCORELOG_NO_VALUE;
+  }
+  for (i = 0; i < pend->count; i++) {
+    const struct sl_data_line *pline = pend->lines + i;
+
+    for (p = 0; rec.players[p] != pline->player; p++) {
+      /* Nothing. */
+    }
+    rec.values[pline->tag * rec.nplayers + p] = pline->value;
+  }
+
+  sl_log_append(plog, &rec);
+  pend->count = 0;
+}
+
+/**************************************************************************
+  Read a text score log.
+**************************************************************************/
+static bool sl_read_text(FILE *fp, const char *filename,
+                         struct sl_log *plog)
+{
+  struct sl_pending pend = { .count = 0, .alloced = 0, .lines = NULL };
+  char line[1024], *ptr;
+  int line_nr;
+  bool ok = TRUE;
+
+  for (line_nr = 1; ok && fgets(line, sizeof(line), fp); line_nr++) {
+    struct scorelog_record rec;
+    struct sl_data_line data;
+    int len, turn;
+
+    ptr = strchr(line, '\n');
+    if (ptr == NULL && !feof(fp)) {
+      fc_fprintf(stderr, _("%s:%d: line too long.\n"), filename, line_nr);
+      ok = FALSE;
+      break;
+    }
+    if (ptr != NULL) {
+      *ptr = '\0';
+    }
+
+    memset(&rec, 0, sizeof(rec));
+
+    if (line_nr == 1) {
+      if (strncmp(line, SCORELOG_TEXT_MAGIC,
+                  strlen(SCORELOG_TEXT_MAGIC)) != 0) {
+        fc_fprintf(stderr, _("%s: not a score log.\n"), filename);
+        ok = FALSE;
+        break;
+      }
+      rec.type = SLR_VERSION;
+      sz_strlcpy(rec.text, line + strlen(SCORELOG_TEXT_MAGIC));
+    } else if (line[0] == '\0' || line[0] == '#') {
+      continue;
+    } else if (sscanf(line, "data %d %d %d %d", &turn, &data.tag,
+                      &data.player, &data.value) == 4) {
+      if (data.tag < 0 || data.player < 0) {
+        fc_fprintf(stderr, _("%s:%d: bad data line.\n"), filename, line_nr);
+        ok = FALSE;
+        break;
+      }
+      if (pend.count > 0 && turn != pend.turn) {
+        sl_pending_flush(&pend, plog);
+      }
+      pend.turn = turn;
+      if (pend.count == pend.alloced) {
+        pend.alloced = MAX(256, 2 * pend.alloced);
+        pend.lines = fc_realloc(pend.lines,
+                                pend.alloced * sizeof(*pend.lines));
+      }
+      pend.lines[pend.count++] = data;
+      continue;
+    } else if (strncmp(line, "id ", 3) == 0) {
+      rec.type = SLR_ID;
+      sz_strlcpy(rec.text, line + 3);
+    } else if (sscanf(line, "tag %d %n", &rec.id, &len) == 1) {
+      if (rec.id < 0) {
+        fc_fprintf(stderr, _("%s:%d: bad tag line.\n"), filename, line_nr);
+        ok = FALSE;
+        break;
+      }
+      rec.type = SLR_TAG;
+      sz_strlcpy(rec.text, line + len);
+    } else if (sscanf(line, "turn %d %d %n", &rec.turn, &rec.year,
+                      &len) == 2) {
+      rec.type = SLR_TURN;
+      sz_strlcpy(rec.text, line + len);
+    } else if (sscanf(line, "addplayer %d %d %n", &rec.turn, &rec.id,
+                      &len) == 2) {
+      if (rec.id < 0) {
+        fc_fprintf(stderr, _("%s:%d: bad addplayer line.\n"), filename,
+                   line_nr);
+        ok = FALSE;
+        break;
+      }
+      rec.type = SLR_ADDPLAYER;
+      sz_strlcpy(rec.text, line + len);
+    } else if (sscanf(line, "delplayer %d %d", &rec.turn, &rec.id) == 2) {
+      if (rec.id < 0) {
+        fc_fprintf(stderr, _("%s:%d: bad delplayer line.\n"), filename,
+                   line_nr);
+        ok = FALSE;
+        break;
+      }
+      rec.type = SLR_DELPLAYER;
+    } else {
+      fc_fprintf(stderr, _("%s:%d: unknown line.\n"), filename, line_nr);
+      ok = FALSE;
+      break;
+    }
+
+    sl_pending_flush(&pend, plog);
+    sl_log_append(plog, &rec);
+  }
+
+  if (ok) {
+    sl_pending_flush(&pend, plog);
+  }
+  free(pend.lines);
+
+  return ok;
+}
+
+/**************************************************************************
+  Read a score log in whatever format it is.
+**************************************************************************/
+static bool sl_read(const char *filename, struct sl_log *plog)
+{
+  FILE *fp = fc_fopen(filename, "rb");
+  bool ok;
+
+  if (fp == NULL) {
+    fc_fprintf(stderr, _("Can't open \"%s\".\n"), filename);
+    return FALSE;
+  }
+
+  if (scorelog_binary_check_magic(fp)) {
+    ok = sl_read_binary(fp, filename, plog);
+  } else {
+    fclose(fp);
+    fp = fc_fopen(filename, "r");
+    ok = (fp != NULL && sl_read_text(fp, filename, plog));
+  }
+
+  if (fp != NULL) {
+    fclose(fp);
+  }
+
+  return ok;
+}
+
+/**************************************************************************
+  Return TRUE iff number is in the comma separated list. An empty list
+  contains everything.
+**************************************************************************/
+static bool sl_list_has(const char *list, const char *item)
+{
+  size_t len = strlen(item);
+  const char *pos = list;
+
+  if (list == NULL) {
+    return TRUE;
+  }
+
+  while ((pos = strstr(pos, item)) != NULL) {
+    if ((pos == list || pos[-1] == ',')
+        && (pos[len] == '\0' || pos[len] == ',')) {
+      return TRUE;
+    }
+    pos += len;
+  }
+
+  return FALSE;
+}
+
+/**************************************************************************
+  Apply the --tags, --players, --first and --last filters. Kept tags get
+  new consecutive ids.
+**************************************************************************/
+static void sl_filter(struct sl_log *plog)
+{
+  int *tag_map = NULL, tag_slots = 0, new_tags = 0;
+  int i, j = 0, t, p;
+
+  for (i = 0; i < plog->count; i++) {
+    struct scorelog_record *prec = plog->recs + i;
+    bool keep = TRUE;
+
+    switch (prec->type) {
+    case SLR_TAG:
+      if (prec->id >= tag_slots) {
+        int old = tag_slots;
+
+        tag_slots = prec->id + 1;
+        tag_map = fc_realloc(tag_map, tag_slots * sizeof(*tag_map));
+        for (t = old; t < tag_slots; t++) {
+          tag_map[t] = -1;
+        }
+      }
+      keep = sl_list_has(sl_args.tags, prec->text);
+      if (keep) {
+        tag_map[prec->id] = new_tags;
+        prec->id = new_tags++;
+      }
+      break;
+    case SLR_TURN:
+      keep = ((sl_args.first_turn < 0 || prec->turn >= sl_args.first_turn)
+              && (sl_args.last_turn < 0 || prec->turn <= sl_args.last_turn));
+      break;
+    case SLR_ADDPLAYER:
+    case SLR_DELPLAYER:
+      {
+        char num[16];
+
+        fc_snprintf(num, sizeof(num), "%d", prec->id);
+        keep = sl_list_has(sl_args.players, num);
+      }
+      break;
+    case SLR_COLUMNS:
+      {
+        int *values, nplayers = 0;
+
+        if ((sl_args.first_turn >= 0 && prec->turn < sl_args.first_turn)
+            || (sl_args.last_turn >= 0 && prec->turn > sl_args.last_turn)) {
+          keep = FALSE;
+          break;
+        }
+
+        values = fc_malloc(MAX(1, new_tags * prec->nplayers)
+                           * sizeof(*values));
+        for (p = 0; p < prec->nplayers; p++) {
+          char num[16];
+
+          fc_snprintf(num, sizeof(num), "%d", prec->players[p]);
+          if (!sl_list_has(sl_args.players, num)) {
+            continue;
+          }
+          prec->players[nplayers] = prec->players[p];
+          for (t = 0; t < prec->ntags; t++) {
+            if (t < tag_slots && tag_map[t] >= 0) {
+              values[tag_map[t] * prec->nplayers + nplayers]
+                = prec->values[t * prec->nplayers + p];
+            }
+          }
+          nplayers++;
+        }
+        /* Compact the columns to the kept players. */
+        for (t = 0; t < new_tags; t++) {
+          for (p = 0; p < nplayers; p++) {
+            values[t * nplayers + p] = values[t * prec->nplayers + p];
+          }
+        }
+        /* Tags defined, but without values in this record. */
+        for (t = 0; t < tag_slots; t++) {
+          if (tag_map[t] >= 0 && t >= prec->ntags) {
+            for (p = 0; p < nplayers; p++) {
+              values[tag_map[t] * nplayers + p] = SCORELOG_NO_VALUE;
+            }
+          }
+        }
+        free(prec->values);
+        prec->values = values;
+        prec->ntags = new_tags;
+        prec->nplayers = nplayers;
+        keep = (nplayers > 0 && new_tags > 0);
+      }
+      break;
+    default:
+      break;
+    }
+
+    if (keep) {
+      plog->recs[j++] = *prec;
+    } else {
+      scorelog_record_free(prec);
+    }
+  }
+  plog->count = j;
+
+  free(tag_map);
+}
+
+/**************************************************************************
+  Write the log to fp in the requested format.
+**************************************************************************/
+static bool sl_write(FILE *fp, const struct sl_log *plog)
+{
+  int i;
+
+  if (sl_args.format != SLF_TEXT && !scorelog_binary_write_magic(fp)) {
+    return FALSE;
+  }
+
+  for (i = 0; i < plog->count; i++) {
+    const struct scorelog_record *prec = plog->recs + i;
+    bool ok;
+
+    if (sl_args.format == SLF_TEXT) {
+      ok = scorelog_text_write(fp, prec);
+    } else {
+      ok = scorelog_binary_write(fp, prec,
+                                 sl_args.format == SLF_BINARY_ZLIB);
+    }
+    if (!ok) {
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+/* The aggregate of each tag and player over all logs. Tags are matched
+ * by name, players by number. */
+struct sl_agg {
+  int ntags;
+  char **tags;
+  /* The aggregate of tag t for player p is acc[t * MAX_NUM_PLAYER_SLOTS
+   * + p], over count[] values. */
+  double *acc;
+  int *count;
+  char *names[MAX_NUM_PLAYER_SLOTS];
+};
+
+/**************************************************************************
+  Return the index of the tag with the given name, adding it if needed.
+**************************************************************************/
+static int sl_agg_tag(struct sl_agg *pagg, const char *name)
+{
+  int t;
+
+  for (t = 0; t < pagg->ntags; t++) {
+    if (strcmp(pagg->tags[t], name) == 0) {
+      return t;
+    }
+  }
+
+  pagg->ntags++;
+  pagg->tags = fc_realloc(pagg->tags, pagg->ntags * sizeof(*pagg->tags));
+  pagg->tags[t] = fc_strdup(name);
+  pagg->acc = fc_realloc(pagg->acc, pagg->ntags * MAX_NUM_PLAYER_SLOTS
+                                    * sizeof(*pagg->acc));
+  pagg->count = fc_realloc(pagg->count, pagg->ntags * MAX_NUM_PLAYER_SLOTS
+                                        * sizeof(*pagg->count));
+  memset(pagg->acc + t * MAX_NUM_PLAYER_SLOTS, 0,
+         MAX_NUM_PLAYER_SLOTS * sizeof(*pagg->acc));
+  memset(pagg->count + t * MAX_NUM_PLAYER_SLOTS, 0,
+         MAX_NUM_PLAYER_SLOTS * sizeof(*pagg->count));
+
+  return t;
+}
+
+/**************************************************************************
+  Add the values of the (remaining) turns of the log to the aggregate.
+**************************************************************************/
+static void sl_aggregate_add(struct sl_agg *pagg, const struct sl_log *plog)
+{
+  int *tag_map, ntags = 0;
+  int i, t, p;
+
+  for (i = 0; i < plog->count; i++) {
+    if (plog->recs[i].type == SLR_TAG) {
+      ntags = MAX(ntags, plog->recs[i].id + 1);
+    }
+  }
+  tag_map = fc_malloc(MAX(1, ntags) * sizeof(*tag_map));
+  for (t = 0; t < ntags; t++) {
+    tag_map[t] = -1;
+  }
+
+  for (i = 0; i < plog->count; i++) {
+    const struct scorelog_record *prec = plog->recs + i;
+
+    if (prec->type == SLR_TAG && prec->id >= 0) {
+      tag_map[prec->id] = sl_agg_tag(pagg, prec->text);
+    }
+    if (prec->type == SLR_ADDPLAYER
+        && prec->id >= 0 && prec->id < MAX_NUM_PLAYER_SLOTS) {
+      free(pagg->names[prec->id]);
+      pagg->names[prec->id] = fc_strdup(prec->text);
+    }
+    if (prec->type != SLR_COLUMNS) {
+      continue;
+    }
+
+    for (t = 0; t < MIN(ntags, prec->ntags); t++) {
+      if (tag_map[t] < 0) {
+        continue;
+      }
+      for (p = 0; p < prec->nplayers; p++) {
+        int value = prec->values[t * prec->nplayers + p];
+        int plr = prec->players[p];
+        int idx = tag_map[t] * MAX_NUM_PLAYER_SLOTS + plr;
+        double *pacc;
+
+        if (value == SCORELOG_NO_VALUE
+            || plr < 0 || plr >= MAX_NUM_PLAYER_SLOTS) {
+          continue;
+        }
+
+        pacc = pagg->acc + idx;
+        switch (sl_args.aggregate) {
+        case SLA_MIN:
+          *pacc = (pagg->count[idx] == 0 ? value : MIN(*pacc, value));
+          break;
+        case SLA_MAX:
+          *pacc = (pagg->count[idx] == 0 ? value : MAX(*pacc, value));
+          break;
+        case SLA_SUM:
+        case SLA_AVG:
+          *pacc += value;
+          break;
+        case SLA_LAST:
+        case SLA_NONE:
+          *pacc = value;
+          break;
+        }
+        pagg->count[idx]++;
+      }
+    }
+  }
+
+  free(tag_map);
+}
+
+/**************************************************************************
+  Print one line per player with the aggregate of each tag. Missing
+  values are printed as '-'. Frees the aggregate.
+**************************************************************************/
+static void sl_aggregate_print(FILE *fp, struct sl_agg *pagg)
+{
+  int t, p;
+
+  fprintf(fp, "player\tname");
+  for (t = 0; t < pagg->ntags; t++) {
+    fprintf(fp, "\t%s", pagg->tags[t]);
+  }
+  fprintf(fp, "\n");
+
+  for (p = 0; p < MAX_NUM_PLAYER_SLOTS; p++) {
+    if (pagg->names[p] == NULL) {
+      continue;
+    }
+    fprintf(fp, "%d\t%s", p, pagg->names[p]);
+    for (t = 0; t < pagg->ntags; t++) {
+      int idx = t * MAX_NUM_PLAYER_SLOTS + p;
+
+      if (pagg->count[idx] == 0) {
+        fprintf(fp, "\t-");
+      } else if (sl_args.aggregate == SLA_AVG) {
+        fprintf(fp, "\t%.2f", pagg->acc[idx] / pagg->count[idx]);
+      } else {
+        fprintf(fp, "\t%.0f", pagg->acc[idx]);
+      }
+    }
+    fprintf(fp, "\n");
+    free(pagg->names[p]);
+  }
+
+  for (t = 0; t < pagg->ntags; t++) {
+    free(pagg->tags[t]);
+  }
+  free(pagg->tags);
+  free(pagg->acc);
+  free(pagg->count);
+}
+
+/**************************************************************************
+  Parse a turn number option value.
+**************************************************************************/
+static int sl_turn_arg(const char *option, const char *value)
+{
+  int turn;
+
+  if (!str_to_int(value, &turn) || turn < 0) {
+    fc_fprintf(stderr, _("Invalid turn \"%s\" for %s.\n"), value, option);
+    cmdline_option_values_free();
+    exit(EXIT_FAILURE);
+  }
+
+  return turn;
+}
+
+/**************************************************************************
+  Parse freeciv-scorelog commandline parameters.
+**************************************************************************/
+static void sl_parse_cmdline(int argc, char *argv[])
+{
+  int i = 1;
+
+  sl_args.inputs = fc_calloc(argc, sizeof(*sl_args.inputs));
+
+  while (i < argc) {
+    char *option = NULL;
+
+    if (is_option("--help", argv[i])) {
+      struct cmdhelp *help = cmdhelp_new(argv[0]);
+
+      cmdhelp_add(help, "a",
+                  /* TRANS: "aggregate" is exactly what user must type,
+                   * do not translate. */
+                  _("aggregate OP"),
+                  _("Print one line per player with the last, min, max, "
+                    "sum or avg value of each tag over all given logs, "
+                    "instead of a log"));
+      cmdhelp_add(help, "b", "binary",
+                  _("Write the binary format"));
+      cmdhelp_add(help, "c", "compress",
+                  _("Write the binary format with compressed values"));
+      cmdhelp_add(help, "f",
+                  /* TRANS: "first" is exactly what user must type, do not
+                   * translate. */
+                  _("first TURN"),
+                  _("Skip turns before TURN"));
+      cmdhelp_add(help, "h", "help",
+                  _("Print a summary of the options"));
+      cmdhelp_add(help, "l",
+                  /* TRANS: "last" is exactly what user must type, do not
+                   * translate. */
+                  _("last TURN"),
+                  _("Skip turns after TURN"));
+      cmdhelp_add(help, "o",
+                  /* TRANS: "output" is exactly what user must type, do not
+                   * translate. */
+                  _("output FILE"),
+                  _("Write to FILE instead of the standard output"));
+      cmdhelp_add(help, "p",
+                  /* TRANS: "players" is exactly what user must type, do
+                   * not translate. */
+                  _("players LIST"),
+                  _("Keep only the players with the comma separated "
+                    "numbers"));
+      cmdhelp_add(help, "t",
+                  /* TRANS: "tags" is exactly what user must type, do not
+                   * translate. */
+                  _("tags LIST"),
+                  _("Keep only the comma separated tags"));
+      cmdhelp_add(help, "v", "version",
+                  _("Print the version number"));
+
+      cmdhelp_display(help, TRUE, FALSE, TRUE);
+      cmdhelp_destroy(help);
+
+      cmdline_option_values_free();
+
+      exit(EXIT_SUCCESS);
+    } else if (is_option("--version", argv[i])) {
+      fc_fprintf(stderr, "%s \n", freeciv_name_version());
+
+      cmdline_option_values_free();
+
+      exit(EXIT_SUCCESS);
+    } else if (is_option("--binary", argv[i])) {
+      sl_args.format = SLF_BINARY;
+    } else if (is_option("--compress", argv[i])) {
+      sl_args.format = SLF_BINARY_ZLIB;
+    } else if ((option = get_option_malloc("--output", argv, &i, argc,
+                                           TRUE))) {
+      sl_args.output = option;
+    } else if ((option = get_option_malloc("--tags", argv, &i, argc,
+                                           TRUE))) {
+      sl_args.tags = option;
+    } else if ((option = get_option_malloc("--players", argv, &i, argc,
+                                           TRUE))) {
+      sl_args.players = option;
+    } else if ((option = get_option_malloc("--first", argv, &i, argc,
+                                           TRUE))) {
+      sl_args.first_turn = sl_turn_arg("--first", option);
+    } else if ((option = get_option_malloc("--last", argv, &i, argc,
+                                           TRUE))) {
+      sl_args.last_turn = sl_turn_arg("--last", option);
+    } else if ((option = get_option_malloc("--aggregate", argv, &i, argc,
+                                           TRUE))) {
+      if (fc_strcasecmp(option, "last") == 0) {
+        sl_args.aggregate = SLA_LAST;
+      } else if (fc_strcasecmp(option, "min") == 0) {
+        sl_args.aggregate = SLA_MIN;
+      } else if (fc_strcasecmp(option, "max") == 0) {
+        sl_args.aggregate = SLA_MAX;
+      } else if (fc_strcasecmp(option, "sum") == 0) {
+        sl_args.aggregate = SLA_SUM;
+      } else if (fc_strcasecmp(option, "avg") == 0) {
+        sl_args.aggregate = SLA_AVG;
+      } else {
+        fc_fprintf(stderr, _("Unknown aggregate \"%s\".\n"), option);
+        cmdline_option_values_free();
+        exit(EXIT_FAILURE);
+      }
+    } else if (argv[i][0] == '-') {
+      fc_fprintf(stderr, _("Unrecognized option: \"%s\"\n"), argv[i]);
+      cmdline_option_values_free();
+      exit(EXIT_FAILURE);
+    } else {
+      sl_args.inputs[sl_args.num_inputs++] = argv[i];
+    }
+
+    i++;
+  }
+}
+
+/**************************************************************************
+  Main entry point for freeciv-scorelog
+**************************************************************************/
+int main(int argc, char **argv)
+{
+  FILE *out = stdout;
+  struct sl_agg agg;
+  int i, ret = EXIT_SUCCESS;
+
+  init_nls();
+  init_character_encodings(FC_DEFAULT_DATA_ENCODING, FALSE);
+  log_init(NULL, LOG_NORMAL, NULL, NULL, -1);
+
+  sl_parse_cmdline(argc, argv);
+
+  if (sl_args.num_inputs == 0
+      || (sl_args.num_inputs > 1 && sl_args.aggregate == SLA_NONE)) {
+    fc_fprintf(stderr,
+               _("Give one score log to convert, or any number of score "
+                 "logs with --aggregate. See --help.\n"));
+    ret = EXIT_FAILURE;
+  } else if (sl_args.output != NULL) {
+    out = fc_fopen(sl_args.output,
+                   sl_args.format == SLF_TEXT || sl_args.aggregate != SLA_NONE
+                   ? "w" : "wb");
+    if (out == NULL) {
+      fc_fprintf(stderr, _("Can't open \"%s\" for writing.\n"),
+                 sl_args.output);
+      ret = EXIT_FAILURE;
+    }
+  }
+
+  memset(&agg, 0, sizeof(agg));
+  for (i = 0; ret == EXIT_SUCCESS && i < sl_args.num_inputs; i++) {
+    struct sl_log slog = { .recs = NULL, .count = 0, .alloced = 0 };
+
+    if (!sl_read(sl_args.inputs[i], &slog)) {
+      ret = EXIT_FAILURE;
+    } else {
+      sl_filter(&slog);
+      if (sl_args.aggregate != SLA_NONE) {
+        sl_aggregate_add(&agg, &slog);
+      } else if (!sl_write(out, &slog)) {
+        fc_fprintf(stderr, _("Write error.\n"));
+        ret = EXIT_FAILURE;
+      }
+    }
+    sl_log_free(&slog);
+  }
+  if (ret == EXIT_SUCCESS && sl_args.aggregate != SLA_NONE) {
+    sl_aggregate_print(out, &agg);
+  }
+
+  if (out != NULL && out != stdout) {
+    fclose(out);
+  }
+
+  free(sl_args.inputs);
+  log_close();
+  free_nls();
+  cmdline_option_values_free();
+
+  return ret;
+}
@@ -52,6 +52,12 @@
   same astring on subsequent calls; the caller should behave the
   same (only reading the string and not freeing it).
 
+  Strings which are built, used and dropped within one function, e.g. a
+  message to a player, can start in a buffer of the caller, typically on
+  the stack, with astr_init_buf(). No memory is allocated until the
+  string outgrows that buffer, at which point it is moved to allocated
+  storage like any other astring. astr_free() is still needed after use.
+
 ***********************************************************************/
 
 #ifdef HAVE_CONFIG_H
@@ -75,6 +81,7 @@
 #define str     _private_str_
 #define n       _private_n_
 #define n_alloc _private_n_alloc_
+#define borrowed _private_borrowed_
 
 static const struct astring zero_astr = ASTRING_INIT;
 static char *astr_buffer = NULL;
@@ -129,13 +136,29 @@ void astr_init(struct astring *astr)
   *astr = zero_astr;
 }
 
+/****************************************************************************
+  Initialize the struct to use the given buffer of the caller as storage,
+  until the string needs more than 'size' bytes. The buffer must outlive
+  the use of astr.
+****************************************************************************/
+void astr_init_buf(struct astring *astr, char *buf, size_t size)
+{
+  fc_assert_ret(0 < size);
+
+  astr->str = buf;
+  astr->n = 1;
+  astr->n_alloc = size;
+  astr->borrowed = TRUE;
+  buf[0] = '\0';
+}
+
 /****************************************************************************
   Free the memory associated with astr, and return astr to same
   state as after astr_init.
 ****************************************************************************/
 void astr_free(struct astring *astr)
 {
-  if (astr->n_alloc > 0) {
+  if (astr->n_alloc > 0 && !astr->borrowed) {
     fc_assert_ret(NULL != astr->str);
     free(astr->str);
   }
@@ -149,7 +172,8 @@ void astr_free(struct astring *astr)
 ****************************************************************************/
 char *astr_to_str(struct astring *astr)
 {
-  char *str = astr->str;
+  char *str = astr->borrowed ? fc_strdup(astr->str) : astr->str;
+
   *astr = zero_astr;
   return str;
 }
@@ -164,6 +188,7 @@ char *astr_to_str(struct astring *astr)
 void astr_reserve(struct astring *astr, size_t n)
 {
   int n1;
+  size_t old_alloc = astr->n_alloc;
   bool was_null = (astr->n == 0);
 
   fc_assert_ret(NULL != astr);
@@ -176,7 +201,16 @@ void astr_reserve(struct astring *astr, size_t n)
   /* Allocated more if this is only a small increase on before: */
   n1 = (3 * (astr->n_alloc + 10)) / 2;
   astr->n_alloc = (n > n1) ? n : n1;
-  astr->str = (char *) fc_realloc(astr->str, astr->n_alloc);
+  if (astr->borrowed) {
+    /* Outgrown the buffer of the caller. */
+    char *str = fc_malloc(astr->n_alloc);
+
+    memcpy(str, astr->str, old_alloc);
+    astr->str = str;
+    astr->borrowed = FALSE;
+  } else {
+    astr->str = (char *) fc_realloc(astr->str, astr->n_alloc);
+  }
   if (was_null) {
     astr_clear(astr);
   }
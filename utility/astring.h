@@ -32,18 +32,22 @@ extern "C" {
 #define str     _private_str_
 #define n       _private_n_
 #define n_alloc _private_n_alloc_
+#define borrowed _private_borrowed_
 
 struct astring {
   char *str;                    /* the string */
   size_t n;                     /* size most recently requested */
   size_t n_alloc;               /* total allocated */
+  bool borrowed;                /* str is the caller's, see astr_init_buf() */
 };
 
 /* Can assign this in variable declaration to initialize:
  * Notice a static astring var is exactly this already. */
-#define ASTRING_INIT { NULL, 0, 0 }
+#define ASTRING_INIT { NULL, 0, 0, FALSE }
 
 void astr_init(struct astring *astr) fc__attribute((nonnull (1)));
+void astr_init_buf(struct astring *astr, char *buf, size_t size)
+     fc__attribute((nonnull (1, 2)));
 void astr_free(struct astring *astr) fc__attribute((nonnull (1)));
 
 static inline const char *astr_str(const struct astring *astr)
@@ -126,6 +130,7 @@ static inline bool astr_empty(const struct astring *astr)
 #undef str
 #undef n
 #undef n_alloc
+#undef borrowed
 
 #ifdef __cplusplus
 }
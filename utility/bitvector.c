@@ -39,7 +39,72 @@
    (2) dbv_* - dynamic bitvectors; its size is not known a priori but defined
                by the player (map known bitvectors). This bitvectors are
                given as 'struct dbv' and the information can be accessed
-               using the functions dbv_*(). They uses the BV_* macros. */
+               using the functions dbv_*(). They uses the BV_* macros.
+
+   The storage of a dynamic bitvector is rounded up to whole machine words,
+   and the bits past the end are kept clear, so that the bulk operations
+   can work a word at a time. A bit is still found at the same byte as
+   with the BV_* macros; words are only used where their byte order
+   doesn't matter. */
+
+typedef unsigned long dbv_word;
+
+#define DBV_WORD_BYTES ((int) sizeof(dbv_word))
+#define DBV_WORDS(bits) ((_BV_BYTES(bits) - 1) / DBV_WORD_BYTES + 1)
+#define DBV_BYTES(bits) (DBV_WORDS(bits) * DBV_WORD_BYTES)
+
+/***************************************************************************
+  Return the word at the given word index of a bit vector.
+***************************************************************************/
+static inline dbv_word dbv_word_get(const unsigned char *vec, int word)
+{
+  dbv_word val;
+
+  memcpy(&val, vec + word * DBV_WORD_BYTES, DBV_WORD_BYTES);
+
+  return val;
+}
+
+/***************************************************************************
+  Store the word at the given word index of a bit vector.
+***************************************************************************/
+static inline void dbv_word_put(unsigned char *vec, int word, dbv_word val)
+{
+  memcpy(vec + word * DBV_WORD_BYTES, &val, DBV_WORD_BYTES);
+}
+
+/***************************************************************************
+  Return the number of set bits in the word.
+***************************************************************************/
+static inline int dbv_word_count(dbv_word val)
+{
+#ifdef __GNUC__
+  return __builtin_popcountl(val);
+#else  /* __GNUC__ */
+  int count = 0;
+
+  while (val != 0) {
+    val &= val - 1;
+    count++;
+  }
+
+  return count;
+#endif /* __GNUC__ */
+}
+
+/***************************************************************************
+  Return the index of the lowest set bit in a non-zero byte.
+***************************************************************************/
+static inline int dbv_byte_first(unsigned char val)
+{
+  int i = 0;
+
+  while ((val & (1u << i)) == 0) {
+    i++;
+  }
+
+  return i;
+}
 
 /***************************************************************************
   Initialize a dynamic bitvector of size 'bits'. 'bits' must be greater
@@ -59,7 +124,7 @@ void dbv_init(struct dbv *pdbv, int bits)
   fc_assert_ret(bits > 0 && bits < MAX_DBV_LENGTH);
 
   pdbv->bits = bits;
-  pdbv->vec = fc_calloc(1, _BV_BYTES(pdbv->bits) * sizeof(*pdbv->vec));
+  pdbv->vec = fc_calloc(1, DBV_BYTES(pdbv->bits) * sizeof(*pdbv->vec));
 
   dbv_clr_all(pdbv);
 }
@@ -81,7 +146,7 @@ void dbv_resize(struct dbv *pdbv, int bits)
     if (bits != pdbv->bits) {
       pdbv->bits = bits;
       pdbv->vec = fc_realloc(pdbv->vec,
-                             _BV_BYTES(pdbv->bits) * sizeof(*pdbv->vec));
+                             DBV_BYTES(pdbv->bits) * sizeof(*pdbv->vec));
     }
 
     dbv_clr_all(pdbv);
@@ -130,11 +195,19 @@ bool dbv_isset(const struct dbv *pdbv, int bit)
 ***************************************************************************/
 bool dbv_isset_any(const struct dbv *pdbv)
 {
+  int words, i;
+
   fc_assert_ret_val(pdbv != NULL, FALSE);
   fc_assert_ret_val(pdbv->vec != NULL, FALSE);
 
-  return bv_check_mask(pdbv->vec, pdbv->vec, _BV_BYTES(pdbv->bits),
-                       _BV_BYTES(pdbv->bits));
+  words = DBV_WORDS(pdbv->bits);
+  for (i = 0; i < words; i++) {
+    if (dbv_word_get(pdbv->vec, i) != 0) {
+      return TRUE;
+    }
+  }
+
+  return FALSE;
 }
 
 /***************************************************************************
@@ -157,7 +230,12 @@ void dbv_set_all(struct dbv *pdbv)
   fc_assert_ret(pdbv != NULL);
   fc_assert_ret(pdbv->vec != NULL);
 
-  memset(pdbv->vec, 0xff, _BV_BYTES(pdbv->bits));
+  memset(pdbv->vec, 0, DBV_BYTES(pdbv->bits));
+  memset(pdbv->vec, 0xff, pdbv->bits / 8);
+  if (pdbv->bits % 8 != 0) {
+    /* Keep the bits past the end clear. */
+    pdbv->vec[pdbv->bits / 8] = (1u << (pdbv->bits % 8)) - 1;
+  }
 }
 
 /***************************************************************************
@@ -180,7 +258,143 @@ void dbv_clr_all(struct dbv *pdbv)
   fc_assert_ret(pdbv != NULL);
   fc_assert_ret(pdbv->vec != NULL);
 
-  memset(pdbv->vec, 0, _BV_BYTES(pdbv->bits));
+  memset(pdbv->vec, 0, DBV_BYTES(pdbv->bits));
+}
+
+/***************************************************************************
+  Copy the bits of one dynamic bitvector to another of the same size.
+***************************************************************************/
+void dbv_copy(struct dbv *dest, const struct dbv *src)
+{
+  fc_assert_ret(dest != NULL);
+  fc_assert_ret(dest->vec != NULL);
+  fc_assert_ret(src != NULL);
+  fc_assert_ret(src->vec != NULL);
+  fc_assert_ret(dest->bits == src->bits);
+
+  memcpy(dest->vec, src->vec, DBV_BYTES(src->bits));
+}
+
+/***************************************************************************
+  Keep only the bits of 'dest' which are also set in 'src'
+  (dest &= src). The bitvectors must be of the same size.
+***************************************************************************/
+void dbv_and(struct dbv *dest, const struct dbv *src)
+{
+  int words, i;
+
+  fc_assert_ret(dest != NULL && dest->vec != NULL);
+  fc_assert_ret(src != NULL && src->vec != NULL);
+  fc_assert_ret(dest->bits == src->bits);
+
+  words = DBV_WORDS(dest->bits);
+  for (i = 0; i < words; i++) {
+    dbv_word_put(dest->vec, i,
+                 dbv_word_get(dest->vec, i) & dbv_word_get(src->vec, i));
+  }
+}
+
+/***************************************************************************
+  Set in 'dest' all bits set in 'src' (dest |= src). The bitvectors must
+  be of the same size.
+***************************************************************************/
+void dbv_or(struct dbv *dest, const struct dbv *src)
+{
+  int words, i;
+
+  fc_assert_ret(dest != NULL && dest->vec != NULL);
+  fc_assert_ret(src != NULL && src->vec != NULL);
+  fc_assert_ret(dest->bits == src->bits);
+
+  words = DBV_WORDS(dest->bits);
+  for (i = 0; i < words; i++) {
+    dbv_word_put(dest->vec, i,
+                 dbv_word_get(dest->vec, i) | dbv_word_get(src->vec, i));
+  }
+}
+
+/***************************************************************************
+  Clear in 'dest' all bits set in 'src' (dest &= ~src). The bitvectors
+  must be of the same size.
+***************************************************************************/
+void dbv_andnot(struct dbv *dest, const struct dbv *src)
+{
+  int words, i;
+
+  fc_assert_ret(dest != NULL && dest->vec != NULL);
+  fc_assert_ret(src != NULL && src->vec != NULL);
+  fc_assert_ret(dest->bits == src->bits);
+
+  words = DBV_WORDS(dest->bits);
+  for (i = 0; i < words; i++) {
+    dbv_word_put(dest->vec, i,
+                 dbv_word_get(dest->vec, i) & ~dbv_word_get(src->vec, i));
+  }
+}
+
+/***************************************************************************
+  Return the number of set bits.
+***************************************************************************/
+int dbv_count(const struct dbv *pdbv)
+{
+  int words, i;
+  int count = 0;
+
+  fc_assert_ret_val(pdbv != NULL, 0);
+  fc_assert_ret_val(pdbv->vec != NULL, 0);
+
+  words = DBV_WORDS(pdbv->bits);
+  for (i = 0; i < words; i++) {
+    count += dbv_word_count(dbv_word_get(pdbv->vec, i));
+  }
+
+  return count;
+}
+
+/***************************************************************************
+  Return the first set bit at or after 'bit', or -1 if there is none.
+  Runs of clear bits are skipped a word at a time. See dbv_iterate_set().
+***************************************************************************/
+int dbv_next_set(const struct dbv *pdbv, int bit)
+{
+  int nbytes, byte;
+  unsigned char val;
+
+  fc_assert_ret_val(pdbv != NULL, -1);
+  fc_assert_ret_val(pdbv->vec != NULL, -1);
+  fc_assert_ret_val(bit >= 0, -1);
+
+  if (bit >= pdbv->bits) {
+    return -1;
+  }
+
+  /* The rest of the first byte. */
+  byte = _BV_BYTE_INDEX(bit);
+  val = pdbv->vec[byte] >> (bit & 0x7);
+  if (val != 0) {
+    return bit + dbv_byte_first(val);
+  }
+
+  /* Bytes up to a word boundary, whole words, then the bytes of the first
+   * non-zero word. The bits past the end are clear. */
+  nbytes = DBV_BYTES(pdbv->bits);
+  for (byte++; byte < nbytes && byte % DBV_WORD_BYTES != 0; byte++) {
+    if (pdbv->vec[byte] != 0) {
+      return byte * 8 + dbv_byte_first(pdbv->vec[byte]);
+    }
+  }
+  for (; byte < nbytes; byte += DBV_WORD_BYTES) {
+    if (dbv_word_get(pdbv->vec, byte / DBV_WORD_BYTES) != 0) {
+      break;
+    }
+  }
+  for (; byte < nbytes; byte++) {
+    if (pdbv->vec[byte] != 0) {
+      return byte * 8 + dbv_byte_first(pdbv->vec[byte]);
+    }
+  }
+
+  return -1;
 }
 
 /***************************************************************************
@@ -193,8 +407,8 @@ bool dbv_are_equal(const struct dbv *pdbv1, const struct dbv *pdbv2)
   fc_assert_ret_val(pdbv2 != NULL, FALSE);
   fc_assert_ret_val(pdbv2->vec != NULL, FALSE);
 
-  return bv_are_equal(pdbv1->vec, pdbv2->vec, _BV_BYTES(pdbv1->bits),
-                      _BV_BYTES(pdbv2->bits));
+  return bv_are_equal(pdbv1->vec, pdbv2->vec, DBV_BYTES(pdbv1->bits),
+                      DBV_BYTES(pdbv2->bits));
 }
 
 /***************************************************************************
@@ -234,12 +448,19 @@ bool bv_check_mask(const unsigned char *vec1, const unsigned char *vec2,
   size_t i;
   fc_assert_ret_val(size1 == size2, FALSE);
 
-  for (i = 0; i < size1; i++) {
-    if ((vec1[0] & vec2[0]) != 0) {
+  for (i = 0; i + DBV_WORD_BYTES <= size1; i += DBV_WORD_BYTES) {
+    dbv_word word1, word2;
+
+    memcpy(&word1, vec1 + i, DBV_WORD_BYTES);
+    memcpy(&word2, vec2 + i, DBV_WORD_BYTES);
+    if ((word1 & word2) != 0) {
+      return TRUE;
+    }
+  }
+  for (; i < size1; i++) {
+    if ((vec1[i] & vec2[i]) != 0) {
       return TRUE;
     }
-    vec1++;
-    vec2++;
   }
   return FALSE;
 }
@@ -251,17 +472,9 @@ bool bv_check_mask(const unsigned char *vec1, const unsigned char *vec2,
 bool bv_are_equal(const unsigned char *vec1, const unsigned char *vec2,
                   size_t size1, size_t size2)
 {
-  size_t i;
   fc_assert_ret_val(size1 == size2, FALSE);
 
-  for (i = 0; i < size1; i++) {
-    if (vec1[0] != vec2[0]) {
-      return FALSE;
-    }
-    vec1++;
-    vec2++;
-  }
-  return TRUE;
+  return memcmp(vec1, vec2, size1) == 0;
 }
 
 /**************************************************************************
@@ -49,6 +49,28 @@ void dbv_set_all(struct dbv *pdbv);
 void dbv_clr(struct dbv *pdbv, int bit);
 void dbv_clr_all(struct dbv *pdbv);
 
+void dbv_copy(struct dbv *dest, const struct dbv *src);
+
+void dbv_and(struct dbv *dest, const struct dbv *src);
+void dbv_or(struct dbv *dest, const struct dbv *src);
+void dbv_andnot(struct dbv *dest, const struct dbv *src);
+
+int dbv_count(const struct dbv *pdbv);
+int dbv_next_set(const struct dbv *pdbv, int bit);
+
+/* Iterate over the set bits of a dynamic bitvector, in increasing order.
+ * Bits may be cleared or set during the iteration; bits set after the
+ * current one are visited. */
+#define dbv_iterate_set(pdbv, NAME_bit)                                     \
+{                                                                           \
+  int NAME_bit;                                                             \
+                                                                            \
+  for (NAME_bit = dbv_next_set((pdbv), 0); NAME_bit >= 0;                   \
+       NAME_bit = dbv_next_set((pdbv), NAME_bit + 1)) {
+#define dbv_iterate_set_end                                                 \
+  }                                                                         \
+}
+
 bool dbv_are_equal(const struct dbv *pdbv1, const struct dbv *pdbv2);
 
 void dbv_debug(struct dbv *pdbv);
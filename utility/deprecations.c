@@ -46,7 +46,9 @@ bool are_deprecation_warnings_enabled(void)
 }
 
 /************************************************************************
-  Set callback to call when deprecation warnings are issued
+  Set callback to call when deprecation warnings are issued. Like the
+  log callback, it is only called from the thread which initialised
+  logging.
 ************************************************************************/
 void deprecation_warn_cb_set(deprecation_warn_callback new_cb)
 {
@@ -64,7 +66,7 @@ void do_log_deprecation(const char *format, ...)
   va_start(args, format);
   vdo_log(__FILE__, __FUNCTION__, __FC_LINE__, FALSE, LOG_DEPRECATION,
           buf, sizeof(buf), format, args);
-  if (depr_cb != NULL) {
+  if (depr_cb != NULL && log_in_main_thread()) {
     depr_cb(buf);
   }
   va_end(args);
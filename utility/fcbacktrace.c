@@ -105,6 +105,7 @@ static void backtrace_log(enum log_level level, bool print_from_where,
 
   if (level <= LOG_ERROR) {
     backtrace_print(LOG_BACKTRACE);
+    log_flush();
   }
 }
 
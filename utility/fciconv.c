@@ -362,6 +362,34 @@ void fc_fprintf(FILE *stream, const char *format, ...)
   fflush(stream);
 }
 
+/****************************************************************************
+  Convert the string to the local encoding like fc_fprintf() does, but
+  into the buffer instead of writing it out, and without the iconv setup
+  cost when the encodings are the same. Returns the converted string.
+****************************************************************************/
+char *internal_to_local_string_output(const char *text,
+                                      char *buf, size_t bufsz)
+{
+  static bool recursion = FALSE;
+
+  /* See fc_fprintf(). */
+  if (is_init && !recursion
+      && 0 != fc_strcasecmp(local_encoding, internal_encoding)) {
+    char *output;
+
+    recursion = TRUE;
+    output = internal_to_local_string_buffer(text, buf, bufsz);
+    recursion = FALSE;
+    if (NULL != output) {
+      return output;
+    }
+  }
+
+  fc_strlcpy(buf, text, bufsz);
+
+  return buf;
+}
+
 /****************************************************************************
   Return the length, in *characters*, of the string.  This can be used in
   place of strlen in some places because it returns the number of characters
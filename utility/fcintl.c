@@ -83,6 +83,17 @@ void free_capitalized(char *str)
   FC_FREE(str);
 }
 
+/**********************************************************************
+  Capitalize the string like capitalized_string() does, but in the
+  caller's own buffer instead of a copy.
+***********************************************************************/
+void capitalize_in_place(char *str)
+{
+  if (autocap && (unsigned char) str[0] < 128) {
+    str[0] = fc_toupper(str[0]);
+  }
+}
+
 /**********************************************************************
   Translation opts in to automatic capitalization features.
 ***********************************************************************/
@@ -75,6 +75,7 @@ extern "C" {
 const char *skip_intl_qualifier_prefix(const char *str);
 char *capitalized_string(const char *str);
 void free_capitalized(char *str);
+void capitalize_in_place(char *str);
 void capitalization_opt_in(bool opt_in);
 bool is_capitalization_enabled(void);
 
@@ -73,6 +73,22 @@ void fc_thread_wait(fc_thread *thread)
   thrd_join(*thread, return_value);
 }
 
+/**********************************************************************
+  Return the identity of the calling thread
+***********************************************************************/
+fc_thread_id fc_thread_self(void)
+{
+  return thrd_current();
+}
+
+/**********************************************************************
+  Are the two thread identities the same thread?
+***********************************************************************/
+bool fc_thread_equal(fc_thread_id a, fc_thread_id b)
+{
+  return thrd_equal(a, b) != 0;
+}
+
 /**********************************************************************
   Initialize mutex
 ***********************************************************************/
@@ -196,6 +212,22 @@ void fc_thread_wait(fc_thread *thread)
   pthread_join(*thread, return_value);
 }
 
+/**********************************************************************
+  Return the identity of the calling thread
+***********************************************************************/
+fc_thread_id fc_thread_self(void)
+{
+  return pthread_self();
+}
+
+/**********************************************************************
+  Are the two thread identities the same thread?
+***********************************************************************/
+bool fc_thread_equal(fc_thread_id a, fc_thread_id b)
+{
+  return pthread_equal(a, b) != 0;
+}
+
 /**********************************************************************
   Initialize mutex
 ***********************************************************************/
@@ -326,6 +358,22 @@ void fc_thread_wait(fc_thread *thread)
   CloseHandle(*thread);
 }
 
+/**********************************************************************
+  Return the identity of the calling thread
+***********************************************************************/
+fc_thread_id fc_thread_self(void)
+{
+  return GetCurrentThreadId();
+}
+
+/**********************************************************************
+  Are the two thread identities the same thread?
+***********************************************************************/
+bool fc_thread_equal(fc_thread_id a, fc_thread_id b)
+{
+  return a == b;
+}
+
 /**********************************************************************
   Initialize mutex
 ***********************************************************************/
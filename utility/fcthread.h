@@ -37,6 +37,7 @@ extern "C" {
 #ifdef FREECIV_C11_THR
 
 #define fc_thread      thrd_t
+#define fc_thread_id   thrd_t
 #define fc_mutex       mtx_t
 #define fc_thread_cond cnd_t
 
@@ -45,6 +46,7 @@ extern "C" {
 #include <pthread.h>
 
 #define fc_thread      pthread_t
+#define fc_thread_id   pthread_t
 #define fc_mutex       pthread_mutex_t
 #define fc_thread_cond pthread_cond_t
 
@@ -52,6 +54,7 @@ extern "C" {
 
 #include <windows.h>
 #define fc_thread      HANDLE *
+#define fc_thread_id   DWORD
 #define fc_mutex       HANDLE *
 
 #ifndef FREECIV_HAVE_THREAD_COND
@@ -69,6 +72,9 @@ extern "C" {
 int fc_thread_start(fc_thread *thread, void (*function) (void *arg), void *arg);
 void fc_thread_wait(fc_thread *thread);
 
+fc_thread_id fc_thread_self(void);
+bool fc_thread_equal(fc_thread_id a, fc_thread_id b);
+
 void fc_init_mutex(fc_mutex *mutex);
 void fc_destroy_mutex(fc_mutex *mutex);
 void fc_allocate_mutex(fc_mutex *mutex);
@@ -53,6 +53,17 @@
    Implementation uses open hashing. Collision resolution is done by
    separate chaining with linked lists. Resize hash table when deemed
    necessary by making and populating a new table.
+
+   Tables created with genhash_new_flat_full() use open addressing
+   instead: the entries are stored directly in a power of two sized array
+   and collisions are resolved by linear probing, using the "Robin Hood"
+   rule (an entry far from its home position takes the place of one
+   closer to its own) so that lookups for missing keys can stop early.
+   Deletion shifts the following entries back, so there are no tombstones.
+   There is no allocation per entry, which makes them better suited for
+   tables with small keys stored in the pointer itself (integer ids) or
+   with many insertions and deletions. Both kinds of tables share the
+   same API.
 ****************************************************************************/
 
 #ifdef HAVE_CONFIG_H
@@ -79,9 +90,22 @@ struct genhash_entry {
   struct genhash_entry *next;
 };
 
+/* Entry of a flat (open addressing) table. */
+struct genhash_flat_entry {
+  void *key;
+  void *data;
+  genhash_val_t hash_val;
+  unsigned int dist;            /* Distance from the home slot + 1, or 0 if
+                                 * the slot is empty. */
+};
+
 /* Contents of the opaque type: */
 struct genhash {
   struct genhash_entry **buckets;
+  struct genhash_flat_entry *flat;  /* Flat tables only, then 'buckets' is
+                                     * NULL and 'num_buckets' the number of
+                                     * slots. */
+  unsigned int flat_shift;          /* 32 - log2(num_buckets). */
   genhash_val_fn_t key_val_func;
   genhash_comp_fn_t key_comp_func;
   genhash_copy_fn_t key_copy_func;
@@ -97,6 +121,7 @@ struct genhash_iter {
   struct iterator vtable;
   struct genhash_entry *const *bucket, *const *end;
   const struct genhash_entry *iterator;
+  const struct genhash_flat_entry *flat, *flat_end;     /* Flat tables. */
 };
 
 #define GENHASH_ITER(p) ((struct genhash_iter *) (p))
@@ -213,6 +238,8 @@ genhash_new_nbuckets(genhash_val_fn_t key_val_func,
             (long unsigned) num_buckets);
 
   pgenhash->buckets = fc_calloc(num_buckets, sizeof(*pgenhash->buckets));
+  pgenhash->flat = NULL;
+  pgenhash->flat_shift = 0;
   pgenhash->key_val_func = key_val_func;
   pgenhash->key_comp_func = key_comp_func;
   pgenhash->key_copy_func = key_copy_func;
@@ -226,6 +253,74 @@ genhash_new_nbuckets(genhash_val_fn_t key_val_func,
   return pgenhash;
 }
 
+/****************************************************************************
+  Calculate the number of slots of a flat table for a given number of
+  entries: a power of 2, with at least a factor of 2 of breathing room.
+****************************************************************************/
+#define MIN_FLAT_SLOTS 16
+static size_t genhash_calc_num_slots(size_t num_entries)
+{
+  size_t num_slots = MIN_FLAT_SLOTS;
+
+  num_entries <<= 1; /* breathing room */
+
+  while (num_slots < num_entries) {
+    num_slots <<= 1;
+  }
+  return num_slots;
+}
+
+/****************************************************************************
+  Allocate the slots of a flat table.
+****************************************************************************/
+static void genhash_flat_alloc(struct genhash *pgenhash, size_t num_slots)
+{
+  unsigned int bits = 0;
+
+  while (((size_t) 1 << bits) < num_slots) {
+    bits++;
+  }
+  fc_assert(((size_t) 1 << bits) == num_slots && 32 > bits);
+
+  pgenhash->flat = fc_calloc(num_slots, sizeof(*pgenhash->flat));
+  pgenhash->flat_shift = 32 - bits;
+  pgenhash->num_buckets = num_slots;
+}
+
+/****************************************************************************
+  Constructor of a flat (open addressing) table, see comment at the top of
+  this file. Allows to specify functions to free the memory allocated for
+  the key and user-data that get called when removing the entry from the
+  hash table or changing key/user-data values.
+****************************************************************************/
+struct genhash *
+genhash_new_flat_full(genhash_val_fn_t key_val_func,
+                      genhash_comp_fn_t key_comp_func,
+                      genhash_copy_fn_t key_copy_func,
+                      genhash_free_fn_t key_free_func,
+                      genhash_copy_fn_t data_copy_func,
+                      genhash_free_fn_t data_free_func,
+                      size_t nentries)
+{
+  struct genhash *pgenhash = fc_malloc(sizeof(*pgenhash));
+
+  pgenhash->buckets = NULL;
+  genhash_flat_alloc(pgenhash, genhash_calc_num_slots(nentries));
+  pgenhash->key_val_func = key_val_func;
+  pgenhash->key_comp_func = key_comp_func;
+  pgenhash->key_copy_func = key_copy_func;
+  pgenhash->key_free_func = key_free_func;
+  pgenhash->data_copy_func = data_copy_func;
+  pgenhash->data_free_func = data_free_func;
+  pgenhash->num_entries = 0;
+  pgenhash->no_shrink = FALSE;
+
+  log_debug("New flat genhash table with %lu slots",
+            (long unsigned) pgenhash->num_buckets);
+
+  return pgenhash;
+}
+
 /****************************************************************************
   Constructor specifying number of entries.
   Allows to specify functions to free the memory allocated for the key and
@@ -296,10 +391,126 @@ void genhash_destroy(struct genhash *pgenhash)
   pgenhash->no_shrink = TRUE;
   genhash_clear(pgenhash);
   free(pgenhash->buckets);
+  free(pgenhash->flat);
   free(pgenhash);
 }
 
 
+/****************************************************************************
+  Return the home slot of a hash value in a flat table. The hash value is
+  scrambled first: integer keys are often consecutive and pointer keys
+  aligned.
+****************************************************************************/
+static inline size_t genhash_flat_home(const struct genhash *pgenhash,
+                                       genhash_val_t hash_val)
+{
+  return ((genhash_val_t) (hash_val * 2654435769u)) >> pgenhash->flat_shift;
+}
+
+/****************************************************************************
+  Store an entry known not to be in the flat table yet.
+****************************************************************************/
+static void genhash_flat_place(struct genhash *pgenhash, void *key,
+                               void *data, genhash_val_t hash_val)
+{
+  struct genhash_flat_entry entry, tmp, *slot;
+  size_t mask = pgenhash->num_buckets - 1;
+  size_t idx = genhash_flat_home(pgenhash, hash_val);
+
+  entry.key = key;
+  entry.data = data;
+  entry.hash_val = hash_val;
+  entry.dist = 1;
+
+  for (;; idx = (idx + 1) & mask, entry.dist++) {
+    slot = pgenhash->flat + idx;
+    if (0 == slot->dist) {
+      *slot = entry;
+      return;
+    }
+    if (slot->dist < entry.dist) {
+      /* Take the place of the entry closer to its home. */
+      tmp = *slot;
+      *slot = entry;
+      entry = tmp;
+    }
+  }
+}
+
+/****************************************************************************
+  Return the slot of the flat table where key resides, or NULL.
+****************************************************************************/
+static inline struct genhash_flat_entry *
+genhash_flat_lookup(const struct genhash *pgenhash, const void *key,
+                    genhash_val_t hash_val)
+{
+  struct genhash_flat_entry *slot;
+  genhash_comp_fn_t key_comp_func = pgenhash->key_comp_func;
+  size_t mask = pgenhash->num_buckets - 1;
+  size_t idx = genhash_flat_home(pgenhash, hash_val);
+  unsigned int dist;
+
+  for (dist = 1;; idx = (idx + 1) & mask, dist++) {
+    slot = pgenhash->flat + idx;
+    if (slot->dist < dist) {
+      /* Empty, or the key would have taken this place. */
+      return NULL;
+    }
+    if (NULL != key_comp_func
+        ? (hash_val == slot->hash_val && key_comp_func(slot->key, key))
+        : key == slot->key) {
+      return slot;
+    }
+  }
+}
+
+/****************************************************************************
+  Call the free callbacks for the entry of the flat table and remove it,
+  shifting back the entries which follow.
+****************************************************************************/
+static void genhash_flat_erase(struct genhash *pgenhash,
+                               struct genhash_flat_entry *slot)
+{
+  struct genhash_flat_entry *next;
+  size_t mask = pgenhash->num_buckets - 1;
+  size_t idx = slot - pgenhash->flat;
+
+  if (NULL != pgenhash->key_free_func) {
+    pgenhash->key_free_func(slot->key);
+  }
+  if (NULL != pgenhash->data_free_func) {
+    pgenhash->data_free_func(slot->data);
+  }
+
+  for (;;) {
+    next = pgenhash->flat + ((idx + 1) & mask);
+    if (1 >= next->dist) {
+      break;
+    }
+    pgenhash->flat[idx] = *next;
+    pgenhash->flat[idx].dist--;
+    idx = next - pgenhash->flat;
+  }
+  pgenhash->flat[idx].dist = 0;
+}
+
+/****************************************************************************
+  Resize a flat table: re-place entries.
+****************************************************************************/
+static void genhash_flat_resize(struct genhash *pgenhash, size_t new_nslots)
+{
+  struct genhash_flat_entry *old = pgenhash->flat, *iter, *end;
+
+  end = old + pgenhash->num_buckets;
+  genhash_flat_alloc(pgenhash, new_nslots);
+  for (iter = old; iter < end; iter++) {
+    if (0 != iter->dist) {
+      genhash_flat_place(pgenhash, iter->key, iter->data, iter->hash_val);
+    }
+  }
+  free(old);
+}
+
 /****************************************************************************
   Resize the genhash table: relink entries.
 ****************************************************************************/
@@ -311,6 +522,11 @@ static void genhash_resize_table(struct genhash *pgenhash,
 
   fc_assert(new_nbuckets >= pgenhash->num_entries);
 
+  if (NULL != pgenhash->flat) {
+    genhash_flat_resize(pgenhash, new_nbuckets);
+    return;
+  }
+
   new_buckets = fc_calloc(new_nbuckets, sizeof(*pgenhash->buckets));
 
   bucket = pgenhash->buckets;
@@ -351,7 +567,8 @@ static bool genhash_maybe_resize(struct genhash *pgenhash, bool expandingp)
       return FALSE;
     }
   } else {
-    if (pgenhash->num_buckets <= MIN_BUCKETS) {
+    if (pgenhash->num_buckets <= (NULL != pgenhash->flat
+                                  ? MIN_FLAT_SLOTS : MIN_BUCKETS)) {
       return FALSE;
     }
     limit = MIN_RATIO * pgenhash->num_buckets;
@@ -360,7 +577,9 @@ static bool genhash_maybe_resize(struct genhash *pgenhash, bool expandingp)
     }
   }
 
-  new_nbuckets = genhash_calc_num_buckets(pgenhash->num_entries);
+  new_nbuckets = (NULL != pgenhash->flat
+                  ? genhash_calc_num_slots(pgenhash->num_entries)
+                  : genhash_calc_num_buckets(pgenhash->num_entries));
 
   log_debug("%s genhash (entries = %lu, buckets =  %lu, new = %lu, "
             "%s limit = %lu)",
@@ -506,6 +725,55 @@ static inline void genhash_slot_set(struct genhash *pgenhash,
                  ? pgenhash->data_copy_func(data) : (void *) data);
 }
 
+/****************************************************************************
+  Function to store data, from an entry of a flat table.
+****************************************************************************/
+static inline void genhash_flat_get(const struct genhash_flat_entry *slot,
+                                    void **pkey, void **data)
+{
+  if (NULL != pkey) {
+    *pkey = slot->key;
+  }
+  if (NULL != data) {
+    *data = slot->data;
+  }
+}
+
+/****************************************************************************
+  Call the copy callbacks and store the new entry in the flat table.
+****************************************************************************/
+static inline void genhash_flat_create(struct genhash *pgenhash,
+                                       const void *key, const void *data,
+                                       genhash_val_t hash_val)
+{
+  genhash_flat_place(pgenhash,
+                     (NULL != pgenhash->key_copy_func
+                      ? pgenhash->key_copy_func(key) : (void *) key),
+                     (NULL != pgenhash->data_copy_func
+                      ? pgenhash->data_copy_func(data) : (void *) data),
+                     hash_val);
+}
+
+/****************************************************************************
+  Clear previous values (with free callback) of the flat table entry and
+  call the copy callbacks.
+****************************************************************************/
+static inline void genhash_flat_set(struct genhash *pgenhash,
+                                    struct genhash_flat_entry *slot,
+                                    const void *key, const void *data)
+{
+  if (NULL != pgenhash->key_free_func) {
+    pgenhash->key_free_func(slot->key);
+  }
+  if (NULL != pgenhash->data_free_func) {
+    pgenhash->data_free_func(slot->data);
+  }
+  slot->key = (NULL != pgenhash->key_copy_func
+               ? pgenhash->key_copy_func(key) : (void *) key);
+  slot->data = (NULL != pgenhash->data_copy_func
+                ? pgenhash->data_copy_func(data) : (void *) data);
+}
+
 
 /****************************************************************************
   Prevent or allow the genhash table automatically shrinking. Returns the
@@ -556,6 +824,27 @@ struct genhash *genhash_copy(const struct genhash *pgenhash)
   /* Copy fields. */
   *new_genhash = *pgenhash;
 
+  if (NULL != pgenhash->flat) {
+    struct genhash_flat_entry *iter, *flat_end;
+
+    new_genhash->flat = fc_malloc(pgenhash->num_buckets
+                                  * sizeof(*new_genhash->flat));
+    memcpy(new_genhash->flat, pgenhash->flat,
+           pgenhash->num_buckets * sizeof(*new_genhash->flat));
+    flat_end = new_genhash->flat + new_genhash->num_buckets;
+    for (iter = new_genhash->flat; iter < flat_end; iter++) {
+      if (0 != iter->dist) {
+        if (NULL != new_genhash->key_copy_func) {
+          iter->key = new_genhash->key_copy_func(iter->key);
+        }
+        if (NULL != new_genhash->data_copy_func) {
+          iter->data = new_genhash->data_copy_func(iter->data);
+        }
+      }
+    }
+    return new_genhash;
+  }
+
   /* But make fresh buckets. */
   new_genhash->buckets = fc_calloc(new_genhash->num_buckets,
                                    sizeof(*new_genhash->buckets));
@@ -587,8 +876,25 @@ void genhash_clear(struct genhash *pgenhash)
 
   fc_assert_ret(NULL != pgenhash);
 
+  if (NULL != pgenhash->flat) {
+    struct genhash_flat_entry *iter = pgenhash->flat;
+    struct genhash_flat_entry *max = iter + pgenhash->num_buckets;
+
+    for (; iter < max; iter++) {
+      if (0 != iter->dist) {
+        if (NULL != pgenhash->key_free_func) {
+          pgenhash->key_free_func(iter->key);
+        }
+        if (NULL != pgenhash->data_free_func) {
+          pgenhash->data_free_func(iter->data);
+        }
+        iter->dist = 0;
+      }
+    }
+  }
+
   bucket = pgenhash->buckets;
-  end = bucket + pgenhash->num_buckets;
+  end = bucket + (NULL != bucket ? pgenhash->num_buckets : 0);
   for (; bucket < end; bucket++) {
     while (NULL != *bucket) {
       genhash_slot_free(pgenhash, bucket);
@@ -612,6 +918,16 @@ bool genhash_insert(struct genhash *pgenhash, const void *key,
   fc_assert_ret_val(NULL != pgenhash, FALSE);
 
   hash_val = genhash_val_calc(pgenhash, key);
+  if (NULL != pgenhash->flat) {
+    if (NULL != genhash_flat_lookup(pgenhash, key, hash_val)) {
+      return FALSE;
+    }
+    genhash_maybe_expand(pgenhash);
+    genhash_flat_create(pgenhash, key, data, hash_val);
+    pgenhash->num_entries++;
+    return TRUE;
+  }
+
   slot = genhash_slot_lookup(pgenhash, key, hash_val);
   if (NULL != *slot) {
     return FALSE;
@@ -657,6 +973,24 @@ bool genhash_replace_full(struct genhash *pgenhash, const void *key,
                    genhash_default_get(old_pkey, old_pdata); return FALSE);
 
   hash_val = genhash_val_calc(pgenhash, key);
+  if (NULL != pgenhash->flat) {
+    struct genhash_flat_entry *fslot = genhash_flat_lookup(pgenhash, key,
+                                                           hash_val);
+
+    if (NULL != fslot) {
+      /* Replace. */
+      genhash_flat_get(fslot, old_pkey, old_pdata);
+      genhash_flat_set(pgenhash, fslot, key, data);
+      return TRUE;
+    }
+    /* Insert. */
+    genhash_maybe_expand(pgenhash);
+    genhash_default_get(old_pkey, old_pdata);
+    genhash_flat_create(pgenhash, key, data, hash_val);
+    pgenhash->num_entries++;
+    return FALSE;
+  }
+
   slot = genhash_slot_lookup(pgenhash, key, hash_val);
   if (NULL != *slot) {
     /* Replace. */
@@ -688,6 +1022,18 @@ bool genhash_lookup(const struct genhash *pgenhash, const void *key,
   fc_assert_action(NULL != pgenhash,
                    genhash_default_get(NULL, pdata); return FALSE);
 
+  if (NULL != pgenhash->flat) {
+    const struct genhash_flat_entry *fslot =
+        genhash_flat_lookup(pgenhash, key, genhash_val_calc(pgenhash, key));
+
+    if (NULL != fslot) {
+      genhash_flat_get(fslot, NULL, pdata);
+      return TRUE;
+    }
+    genhash_default_get(NULL, pdata);
+    return FALSE;
+  }
+
   slot = genhash_slot_lookup(pgenhash, key, genhash_val_calc(pgenhash, key));
   if (NULL != *slot) {
     genhash_slot_get(slot, NULL, pdata);
@@ -722,6 +1068,22 @@ bool genhash_remove_full(struct genhash *pgenhash, const void *key,
                    genhash_default_get(deleted_pkey, deleted_pdata);
                    return FALSE);
 
+  if (NULL != pgenhash->flat) {
+    struct genhash_flat_entry *fslot =
+        genhash_flat_lookup(pgenhash, key, genhash_val_calc(pgenhash, key));
+
+    if (NULL != fslot) {
+      genhash_flat_get(fslot, deleted_pkey, deleted_pdata);
+      genhash_flat_erase(pgenhash, fslot);
+      fc_assert(0 < pgenhash->num_entries);
+      pgenhash->num_entries--;
+      genhash_maybe_shrink(pgenhash);
+      return TRUE;
+    }
+    genhash_default_get(deleted_pkey, deleted_pdata);
+    return FALSE;
+  }
+
   slot = genhash_slot_lookup(pgenhash, key, genhash_val_calc(pgenhash, key));
   if (NULL != *slot) {
     genhash_slot_get(slot, deleted_pkey, deleted_pdata);
@@ -746,6 +1108,38 @@ bool genhashs_are_equal(const struct genhash *pgenhash1,
   return genhashs_are_equal_full(pgenhash1, pgenhash2, NULL);
 }
 
+/****************************************************************************
+  Returns TRUE iff the genhash table contains the key with the same data.
+****************************************************************************/
+static bool genhash_has_pair(const struct genhash *pgenhash,
+                             const void *key, const void *data,
+                             genhash_val_t hash_val,
+                             genhash_comp_fn_t data_comp_func)
+{
+  void *found;
+
+  if (NULL != pgenhash->flat) {
+    const struct genhash_flat_entry *fslot =
+        genhash_flat_lookup(pgenhash, key, hash_val);
+
+    if (NULL == fslot) {
+      return FALSE;
+    }
+    found = fslot->data;
+  } else {
+    struct genhash_entry *const *slot =
+        genhash_slot_lookup(pgenhash, key, hash_val);
+
+    if (NULL == *slot) {
+      return FALSE;
+    }
+    found = (*slot)->data;
+  }
+
+  return (data == found
+          || (NULL != data_comp_func && data_comp_func(data, found)));
+}
+
 /****************************************************************************
   Returns TRUE iff the hash tables contains the same pairs of key/data.
 ****************************************************************************/
@@ -753,7 +1147,7 @@ bool genhashs_are_equal_full(const struct genhash *pgenhash1,
                              const struct genhash *pgenhash2,
                              genhash_comp_fn_t data_comp_func)
 {
-  struct genhash_entry *const *bucket1, *const *max1, *const *slot2;
+  struct genhash_entry *const *bucket1, *const *max1;
   const struct genhash_entry *iter1;
 
   /* Check pointers. */
@@ -772,16 +1166,27 @@ bool genhashs_are_equal_full(const struct genhash *pgenhash1,
     return FALSE;
   }
 
+  if (NULL != pgenhash1->flat) {
+    const struct genhash_flat_entry *fiter1 = pgenhash1->flat;
+    const struct genhash_flat_entry *fmax1 = fiter1 + pgenhash1->num_buckets;
+
+    for (; fiter1 < fmax1; fiter1++) {
+      if (0 != fiter1->dist
+          && !genhash_has_pair(pgenhash2, fiter1->key, fiter1->data,
+                               fiter1->hash_val, data_comp_func)) {
+        return FALSE;
+      }
+    }
+    return TRUE;
+  }
+
   /* Compare buckets. */
   bucket1 = pgenhash1->buckets;
   max1 = bucket1 + pgenhash1->num_buckets;
   for (; bucket1 < max1; bucket1++) {
     for (iter1 = *bucket1; NULL != iter1; iter1 = iter1->next) {
-      slot2 = genhash_slot_lookup(pgenhash2, iter1->key, iter1->hash_val);
-      if (NULL == *slot2
-          || (iter1->data != (*slot2)->data
-              && (NULL == data_comp_func
-                  || !data_comp_func(iter1->data, (*slot2)->data)))) {
+      if (!genhash_has_pair(pgenhash2, iter1->key, iter1->data,
+                            iter1->hash_val, data_comp_func)) {
         return FALSE;
       }
     }
@@ -805,6 +1210,10 @@ size_t genhash_iter_sizeof(void)
 void *genhash_iter_key(const struct iterator *genhash_iter)
 {
   struct genhash_iter *iter = GENHASH_ITER(genhash_iter);
+
+  if (NULL != iter->flat) {
+    return iter->flat->key;
+  }
   return (void *) iter->iterator->key;
 }
 
@@ -814,6 +1223,10 @@ void *genhash_iter_key(const struct iterator *genhash_iter)
 void *genhash_iter_value(const struct iterator *genhash_iter)
 {
   struct genhash_iter *iter = GENHASH_ITER(genhash_iter);
+
+  if (NULL != iter->flat) {
+    return iter->flat->data;
+  }
   return (void *) iter->iterator->data;
 }
 
@@ -837,6 +1250,29 @@ static void genhash_iter_next(struct iterator *genhash_iter)
   }
 }
 
+/****************************************************************************
+  Iterator interface 'next' function implementation for flat tables.
+****************************************************************************/
+static void genhash_flat_iter_next(struct iterator *genhash_iter)
+{
+  struct genhash_iter *iter = GENHASH_ITER(genhash_iter);
+
+  for (iter->flat++; iter->flat < iter->flat_end; iter->flat++) {
+    if (0 != iter->flat->dist) {
+      return;
+    }
+  }
+}
+
+/****************************************************************************
+  Iterator interface 'valid' function implementation for flat tables.
+****************************************************************************/
+static bool genhash_flat_iter_valid(const struct iterator *genhash_iter)
+{
+  struct genhash_iter *iter = GENHASH_ITER(genhash_iter);
+  return iter->flat < iter->flat_end;
+}
+
 /****************************************************************************
   Iterator interface 'get' function implementation. This just returns the
   iterator itself, so you would need to use genhash_iter_get_key/value to
@@ -868,9 +1304,27 @@ genhash_iter_init_common(struct genhash_iter *iter,
     return invalid_iter_init(ITERATOR(iter));
   }
 
+  if (NULL != pgenhash->flat) {
+    iter->vtable.next = genhash_flat_iter_next;
+    iter->vtable.get = get;
+    iter->vtable.valid = genhash_flat_iter_valid;
+    iter->flat = pgenhash->flat;
+    iter->flat_end = pgenhash->flat + pgenhash->num_buckets;
+
+    /* Seek to the first used slot. */
+    for (; iter->flat < iter->flat_end; iter->flat++) {
+      if (0 != iter->flat->dist) {
+        break;
+      }
+    }
+
+    return ITERATOR(iter);
+  }
+
   iter->vtable.next = genhash_iter_next;
   iter->vtable.get = get;
   iter->vtable.valid = genhash_iter_valid;
+  iter->flat = NULL;
   iter->bucket = pgenhash->buckets;
   iter->end = pgenhash->buckets + pgenhash->num_buckets;
 
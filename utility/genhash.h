@@ -71,6 +71,15 @@ genhash_new_nentries_full(genhash_val_fn_t key_val_func,
                           genhash_free_fn_t data_free_func,
                           size_t nentries)
 fc__warn_unused_result;
+struct genhash *
+genhash_new_flat_full(genhash_val_fn_t key_val_func,
+                      genhash_comp_fn_t key_comp_func,
+                      genhash_copy_fn_t key_copy_func,
+                      genhash_free_fn_t key_free_func,
+                      genhash_copy_fn_t data_copy_func,
+                      genhash_free_fn_t data_free_func,
+                      size_t nentries)
+fc__warn_unused_result;
 void genhash_destroy(struct genhash *pgenhash);
 
 bool genhash_set_no_shrink(struct genhash *pgenhash, bool no_shrink);
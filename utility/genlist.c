@@ -44,13 +44,28 @@ struct genlist *genlist_new_full(genlist_free_fn_t free_data_func)
   pgenlist->nelements = 0;
   pgenlist->head_link = NULL;
   pgenlist->tail_link = NULL;
+  pgenlist->mutex = NULL;
+  pgenlist->own_link_used = FALSE;
 #endif /* ZERO_VARIABLES_FOR_SEARCHING */
-  fc_init_mutex(&pgenlist->mutex);
   pgenlist->free_data_func = free_data_func;
 
   return pgenlist;
 }
 
+/****************************************************************************
+  Create a new empty genlist with a free data function, which can be
+  locked with genlist_allocate_mutex().
+****************************************************************************/
+struct genlist *genlist_new_mutexed(genlist_free_fn_t free_data_func)
+{
+  struct genlist *pgenlist = genlist_new_full(free_data_func);
+
+  pgenlist->mutex = fc_malloc(sizeof(*pgenlist->mutex));
+  fc_init_mutex(pgenlist->mutex);
+
+  return pgenlist;
+}
+
 /****************************************************************************
   Destroys the genlist.
 ****************************************************************************/
@@ -61,7 +76,10 @@ void genlist_destroy(struct genlist *pgenlist)
   }
 
   genlist_clear(pgenlist);
-  fc_destroy_mutex(&pgenlist->mutex);
+  if (NULL != pgenlist->mutex) {
+    fc_destroy_mutex(pgenlist->mutex);
+    free(pgenlist->mutex);
+  }
   free(pgenlist);
 }
 
@@ -72,7 +90,14 @@ static void genlist_link_new(struct genlist *pgenlist, void *dataptr,
                              struct genlist_link *prev,
                              struct genlist_link *next)
 {
-  struct genlist_link *plink = fc_malloc(sizeof(*plink));
+  struct genlist_link *plink;
+
+  if (!pgenlist->own_link_used) {
+    plink = &pgenlist->own_link;
+    pgenlist->own_link_used = TRUE;
+  } else {
+    plink = fc_malloc(sizeof(*plink));
+  }
 
   plink->dataptr = dataptr;
   plink->prev = prev;
@@ -90,6 +115,19 @@ static void genlist_link_new(struct genlist *pgenlist, void *dataptr,
   pgenlist->nelements++;
 }
 
+/****************************************************************************
+  Release the memory of a link which is no longer part of the list.
+****************************************************************************/
+static inline void genlist_link_free(struct genlist *pgenlist,
+                                     struct genlist_link *plink)
+{
+  if (plink == &pgenlist->own_link) {
+    pgenlist->own_link_used = FALSE;
+  } else {
+    free(plink);
+  }
+}
+
 /****************************************************************************
   Free a link.
 ****************************************************************************/
@@ -115,7 +153,7 @@ static void genlist_link_destroy(struct genlist *pgenlist,
   if (NULL != pgenlist->free_data_func) {
     pgenlist->free_data_func(plink->dataptr);
   }
-  free(plink);
+  genlist_link_free(pgenlist, plink);
 }
 
 /****************************************************************************
@@ -264,12 +302,12 @@ void genlist_clear(struct genlist *pgenlist)
       do {
         plink2 = plink->next;
         free_data_func(plink->dataptr);
-        free(plink);
+        genlist_link_free(pgenlist, plink);
       } while (NULL != (plink = plink2));
     } else {
       do {
         plink2 = plink->next;
-        free(plink);
+        genlist_link_free(pgenlist, plink);
       } while (NULL != (plink = plink2));
     }
   }
@@ -682,7 +720,9 @@ void genlist_reverse(struct genlist *pgenlist)
 ****************************************************************************/
 void genlist_allocate_mutex(struct genlist *pgenlist)
 {
-  fc_allocate_mutex(&pgenlist->mutex);
+  fc_assert_ret(NULL != pgenlist->mutex);
+
+  fc_allocate_mutex(pgenlist->mutex);
 }
 
 /****************************************************************************
@@ -690,5 +730,7 @@ void genlist_allocate_mutex(struct genlist *pgenlist)
 ****************************************************************************/
 void genlist_release_mutex(struct genlist *pgenlist)
 {
-  fc_release_mutex(&pgenlist->mutex);
+  fc_assert_ret(NULL != pgenlist->mutex);
+
+  fc_release_mutex(pgenlist->mutex);
 }
@@ -37,6 +37,12 @@ extern "C" {
   iterator is active, in particular removing the next element pointed
   to by the iterator (see further comments below).
 
+  Lists have no lock of their own unless created with genlist_new_mutexed()
+  (speclists: define SPECLIST_MUTEXED). Only such lists may be used with
+  genlist_allocate_mutex() and genlist_release_mutex(). The first link of
+  every list is stored inside the list itself, so lists holding at most
+  one element (most unit lists of tiles) need no further allocation.
+
   See also the speclist module.
 ****************************************************************************/
 
@@ -44,8 +50,12 @@ extern "C" {
 #include "fcthread.h"
 #include "support.h"    /* bool, fc__warn_unused_result */
 
-/* A single element of a genlist, opaque type. */
-struct genlist_link;
+/* A single element of a genlist, storing the pointer to user
+ * data, and pointers to the next and previous elements: */
+struct genlist_link {
+  struct genlist_link *next, *prev;
+  void *dataptr;
+};
 
 /* Function type definitions. */
 typedef void (*genlist_free_fn_t) (void *);
@@ -58,15 +68,19 @@ typedef bool (*genlist_comp_fn_t) (const void *, const void *);
  * of the list. */
 struct genlist {
   int nelements;
-  fc_mutex mutex;
+  bool own_link_used;
+  fc_mutex *mutex;              /* NULL unless genlist_new_mutexed(). */
   struct genlist_link *head_link;
   struct genlist_link *tail_link;
   genlist_free_fn_t free_data_func;
+  struct genlist_link own_link; /* Used for one of the elements. */
 };
-  
+
 struct genlist *genlist_new(void) fc__warn_unused_result;
 struct genlist *genlist_new_full(genlist_free_fn_t free_data_func)
                 fc__warn_unused_result;
+struct genlist *genlist_new_mutexed(genlist_free_fn_t free_data_func)
+                fc__warn_unused_result;
 void genlist_destroy(struct genlist *pgenlist);
 
 struct genlist *genlist_copy(const struct genlist *pgenlist)
@@ -125,13 +139,6 @@ void genlist_allocate_mutex(struct genlist *pgenlist);
 void genlist_release_mutex(struct genlist *pgenlist);
 
 
-/* A single element of a genlist, storing the pointer to user
- * data, and pointers to the next and previous elements: */
-struct genlist_link {
-  struct genlist_link *next, *prev;
-  void *dataptr;
-};
-
 /****************************************************************************
   Returns the pointer of this link.
 ****************************************************************************/
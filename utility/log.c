@@ -32,6 +32,9 @@
 
 #define MAX_LEN_LOG_LINE 5120
 
+/* Size of the queue of lines waiting for the log file writer thread. */
+#define LOG_QUEUE_SIZE (256 * 1024)
+
 static void log_write(FILE *fs, enum log_level level, bool print_from_where,
                       const char *where, const char *message);
 static void log_real(enum log_level level, bool print_from_where,
@@ -44,6 +47,25 @@ static log_prefix_fn log_prefix = NULL;
 
 static fc_mutex logfile_mutex;
 
+/* The thread which called log_init(). Only that one calls log_callback;
+ * other threads' messages go to the log file or to stderr. */
+static fc_thread_id log_thread;
+static bool log_thread_set = FALSE;
+
+/* When logging to a file, the formatted lines are queued in a ring buffer
+ * and written out by a separate thread, so that callers never wait for
+ * the disk. Lock order is logfile_mutex, log_queue_mutex, log_io_mutex. */
+static char *log_queue = NULL;
+static size_t log_queue_start = 0;
+static size_t log_queue_used = 0;
+static unsigned int log_queue_dropped = 0;
+static bool log_writer_stop = FALSE;
+static char *log_batch = NULL;
+static fc_mutex log_queue_mutex;
+static fc_mutex log_io_mutex;
+static fc_thread_cond log_queue_cond;
+static fc_thread log_writer;
+
 #ifdef FREECIV_DEBUG
 static const enum log_level max_level = LOG_DEBUG;
 #else
@@ -233,6 +255,177 @@ out:
 #endif /* FREECIV_DEBUG */
 }
 
+/**************************************************************************
+  Write out everything in the queue. Must be called with log_queue_mutex
+  held; it is released during the file I/O, and held again on return.
+**************************************************************************/
+static void log_queue_drain(void)
+{
+  size_t len = log_queue_used;
+  size_t first = MIN(len, LOG_QUEUE_SIZE - log_queue_start);
+  unsigned int dropped = log_queue_dropped;
+  FILE *fs;
+
+  if (0 == len && 0 == dropped) {
+    return;
+  }
+
+  /* Taking log_io_mutex before releasing the queue keeps the batches in
+   * order when the writer thread and log_flush() both drain. */
+  fc_allocate_mutex(&log_io_mutex);
+  memcpy(log_batch, log_queue + log_queue_start, first);
+  memcpy(log_batch + first, log_queue, len - first);
+  log_queue_start = (log_queue_start + len) % LOG_QUEUE_SIZE;
+  log_queue_used = 0;
+  log_queue_dropped = 0;
+  fc_release_mutex(&log_queue_mutex);
+
+  /* No logging from here, that would come back to the queue. */
+  if (!(fs = fc_fopen(log_filename, "a"))) {
+    fprintf(stderr, _("Couldn't open logfile: %s for appending.\n"),
+            log_filename);
+    fs = stderr;
+  }
+  fwrite(log_batch, 1, len, fs);
+  if (0 < dropped) {
+    fprintf(fs, "%d: ", LOG_WARN);
+    fprintf(fs, PL_("%u log message dropped, log file too slow.\n",
+                    "%u log messages dropped, log file too slow.\n",
+                    dropped), dropped);
+  }
+  fflush(fs);
+  if (fs != stderr) {
+    fclose(fs);
+  }
+  fc_release_mutex(&log_io_mutex);
+
+  fc_allocate_mutex(&log_queue_mutex);
+}
+
+/**************************************************************************
+  Queue a line for the log file. When the queue is full, verbose and
+  debug messages are dropped (and counted), others wait for the queue to
+  be written out.
+**************************************************************************/
+static void log_queue_push(enum log_level level, const char *line,
+                           size_t len)
+{
+  size_t end, first;
+
+  fc_allocate_mutex(&log_queue_mutex);
+  while (len > LOG_QUEUE_SIZE - log_queue_used) {
+    if (LOG_VERBOSE <= level) {
+      log_queue_dropped++;
+      fc_release_mutex(&log_queue_mutex);
+      return;
+    }
+    log_queue_drain();
+  }
+
+  end = (log_queue_start + log_queue_used) % LOG_QUEUE_SIZE;
+  first = MIN(len, LOG_QUEUE_SIZE - end);
+  memcpy(log_queue + end, line, first);
+  memcpy(log_queue, line + first, len - first);
+  if (0 == log_queue_used) {
+    /* Otherwise the writer is busy and will come back for it. */
+    fc_thread_cond_signal(&log_queue_cond);
+  }
+  log_queue_used += len;
+  fc_release_mutex(&log_queue_mutex);
+}
+
+/**************************************************************************
+  Main function of the log file writer thread.
+**************************************************************************/
+static void log_writer_main(void *arg)
+{
+  fc_allocate_mutex(&log_queue_mutex);
+  while (!log_writer_stop) {
+    if (0 == log_queue_used && 0 == log_queue_dropped) {
+      fc_thread_cond_wait(&log_queue_cond, &log_queue_mutex);
+    } else {
+      log_queue_drain();
+    }
+  }
+  log_queue_drain();
+  fc_release_mutex(&log_queue_mutex);
+}
+
+/**************************************************************************
+  Start the log file writer thread. Without one, the log file is written
+  directly by whoever logs.
+**************************************************************************/
+static void log_writer_start(void)
+{
+  static bool atexit_set = FALSE;
+
+  if (NULL != log_queue || !has_thread_cond_impl()) {
+    return;
+  }
+
+  log_queue = fc_malloc(LOG_QUEUE_SIZE);
+  log_batch = fc_malloc(LOG_QUEUE_SIZE);
+  log_queue_start = 0;
+  log_queue_used = 0;
+  log_queue_dropped = 0;
+  log_writer_stop = FALSE;
+  fc_init_mutex(&log_queue_mutex);
+  fc_init_mutex(&log_io_mutex);
+  fc_thread_cond_init(&log_queue_cond);
+
+  if (0 != fc_thread_start(&log_writer, log_writer_main, NULL)) {
+    fc_thread_cond_destroy(&log_queue_cond);
+    fc_destroy_mutex(&log_io_mutex);
+    fc_destroy_mutex(&log_queue_mutex);
+    FC_FREE(log_batch);
+    FC_FREE(log_queue);
+    return;
+  }
+
+  if (!atexit_set) {
+    /* Don't lose the last lines if the program exit()s. */
+    atexit(log_flush);
+    atexit_set = TRUE;
+  }
+}
+
+/**************************************************************************
+  Stop the log file writer thread, writing out what it has queued.
+**************************************************************************/
+static void log_writer_stop_wait(void)
+{
+  if (NULL == log_queue) {
+    return;
+  }
+
+  fc_allocate_mutex(&log_queue_mutex);
+  log_writer_stop = TRUE;
+  fc_thread_cond_signal(&log_queue_cond);
+  fc_release_mutex(&log_queue_mutex);
+  fc_thread_wait(&log_writer);
+
+  fc_thread_cond_destroy(&log_queue_cond);
+  fc_destroy_mutex(&log_io_mutex);
+  fc_destroy_mutex(&log_queue_mutex);
+  FC_FREE(log_batch);
+  FC_FREE(log_queue);
+}
+
+/**************************************************************************
+  Write out all queued log lines before returning. Called before the
+  program may die, e.g. on fatal messages and failed assertions.
+**************************************************************************/
+void log_flush(void)
+{
+  if (NULL == log_queue) {
+    return;
+  }
+
+  fc_allocate_mutex(&log_queue_mutex);
+  log_queue_drain();
+  fc_release_mutex(&log_queue_mutex);
+}
+
 /**************************************************************************
   Initialise the log module. Either 'filename' or 'callback' may be NULL.
   If both are NULL, print to stderr. If both are non-NULL, both callback, 
@@ -257,6 +450,11 @@ void log_init(const char *filename, enum log_level initial_level,
   log_prefix = prefix;
   fc_fatal_assertions = fatal_assertions;
   fc_init_mutex(&logfile_mutex);
+  log_thread = fc_thread_self();
+  log_thread_set = TRUE;
+  if (NULL != log_filename) {
+    log_writer_start();
+  }
   log_verbose("log started");
   log_debug("LOG_DEBUG test");
 }
@@ -266,9 +464,21 @@ void log_init(const char *filename, enum log_level initial_level,
 **************************************************************************/
 void log_close(void)
 {
+  log_writer_stop_wait();
+  log_thread_set = FALSE;
   fc_destroy_mutex(&logfile_mutex);
 }
 
+/**************************************************************************
+  Is the calling thread the one which initialised logging? The log
+  callbacks, which usually write to the user interface, are only called
+  from that thread.
+**************************************************************************/
+bool log_in_main_thread(void)
+{
+  return !log_thread_set || fc_thread_equal(fc_thread_self(), log_thread);
+}
+
 /*****************************************************************************
   Adjust the log preparation callback function.
 *****************************************************************************/
@@ -363,7 +573,9 @@ bool log_do_output_for_level_at_location(enum log_level level,
 static void log_write(FILE *fs, enum log_level level, bool print_from_where,
                       const char *where, const char *message)
 {
-  if (log_filename || (!log_callback)) {
+  bool use_callback = (NULL != log_callback && log_in_main_thread());
+
+  if (log_filename || !use_callback) {
     char prefix[128];
 
     if (log_prefix) {
@@ -373,15 +585,36 @@ static void log_write(FILE *fs, enum log_level level, bool print_from_where,
       prefix[0] = '\0';
     }
 
-    if (log_filename || (print_from_where && where)) {
+    if (NULL == fs) {
+      /* Queued for the writer thread. */
+      char line[MAX_LEN_LOG_LINE];
+      char local[MAX_LEN_LOG_LINE];
+      size_t len;
+
+      if (log_filename || (print_from_where && where)) {
+        fc_snprintf(line, sizeof(line), "%d: %s%s%s\n",
+                    level, prefix, where, message);
+      } else {
+        fc_snprintf(line, sizeof(line), "%d: %s%s\n",
+                    level, prefix, message);
+      }
+      internal_to_local_string_output(line, local, sizeof(local));
+      len = strlen(local);
+      if (0 < len && '\n' != local[len - 1]) {
+        /* Truncated. */
+        local[len - 1] = '\n';
+      }
+      log_queue_push(level, local, len);
+    } else if (log_filename || (print_from_where && where)) {
       fc_fprintf(fs, "%d: %s%s%s\n", level, prefix, where, message);
+      fflush(fs);
     } else {
       fc_fprintf(fs, "%d: %s%s\n", level, prefix, message);
+      fflush(fs);
     }
-    fflush(fs);
   }
 
-  if (log_callback) {
+  if (use_callback) {
     if (print_from_where) {
       char buf[MAX_LEN_LOG_LINE];
 
@@ -423,6 +656,7 @@ void vdo_log(const char *file, const char *function, int line,
   For repeat message, may wait and print instead "last message repeated ..."
   at some later time.
   Calls log_callback if non-null, else prints to stderr.
+  When there is a log file writer thread, the file lines go to its queue.
 *****************************************************************************/
 static void log_real(enum log_level level, bool print_from_where,
                      const char *where, const char *msg)
@@ -434,11 +668,17 @@ static void log_real(enum log_level level, bool print_from_where,
   /* only count as repeat if same level */
   static enum log_level prev_level = -1;
   char buf[MAX_LEN_LOG_LINE];
+  /* The repeat counting above is shared by all threads. */
+  bool locked = log_thread_set;
   FILE *fs;
 
-  if (log_filename) {
+  if (locked) {
     fc_allocate_mutex(&logfile_mutex);
-    if (!(fs = fc_fopen(log_filename, "a"))) {
+  }
+  if (log_filename) {
+    if (NULL != log_queue) {
+      fs = NULL;
+    } else if (!(fs = fc_fopen(log_filename, "a"))) {
       fc_fprintf(stderr,
                  _("Couldn't open logfile: %s for appending \"%s\".\n"), 
                  log_filename, msg);
@@ -493,9 +733,16 @@ static void log_real(enum log_level level, bool print_from_where,
   /* Save last message. */
   sz_strlcpy(last_msg, msg);
 
-  fflush(fs);
-  if (log_filename) {
-    fclose(fs);
+  if (NULL != fs) {
+    fflush(fs);
+    if (log_filename) {
+      fclose(fs);
+    }
+  } else if (LOG_FATAL == level) {
+    /* The program is about to die. */
+    log_flush();
+  }
+  if (locked) {
     fc_release_mutex(&logfile_mutex);
   }
 }
@@ -561,6 +808,7 @@ void fc_assert_fail(const char *file, const char *function, int line,
 
   if (0 <= fc_fatal_assertions) {
     /* Emit a signal. */
+    log_flush();
     raise(fc_fatal_assertions);
   }
 }
@@ -58,7 +58,9 @@ void log_init(const char *filename, enum log_level initial_level,
               log_callback_fn callback, log_prefix_fn prefix,
               int fatal_assertions);
 void log_close(void);
+void log_flush(void);
 bool log_parse_level_str(const char *level_str, enum log_level *ret_level);
+bool log_in_main_thread(void);
 
 log_pre_callback_fn log_set_pre_callback(log_pre_callback_fn precallback);
 log_callback_fn log_set_callback(log_callback_fn callback);
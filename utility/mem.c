@@ -26,11 +26,41 @@
 
 /* utility */
 #include "fcintl.h"
+#include "fcthread.h"
 #include "log.h"
 #include "shared.h"		/* TRUE, FALSE */
 
 #include "mem.h"
 
+#ifdef FREECIV_MEMSTATS
+/* Size of the cache from file name pointers to tags. Power of 2. */
+#define MEM_STATS_NAME_CACHE 4096
+
+struct mem_block {
+  const void *ptr;              /* NULL for an empty slot. */
+  size_t size;
+  int tag;
+};
+
+static bool mem_stats_initialized = FALSE;
+static fc_mutex mem_stats_mutex;
+static struct mem_stats mem_stats_tags[MEM_STATS_MAX_TAGS];
+static int mem_stats_num_tags = 0;
+static struct mem_stats mem_stats_total;
+
+/* __FILE__ is not always the same pointer for the same file. */
+static struct {
+  const char *file;
+  int tag;
+} mem_stats_names[MEM_STATS_NAME_CACHE];
+static int mem_stats_num_names = 0;
+
+/* All live blocks, in an open addressing hash table. */
+static struct mem_block *mem_blocks = NULL;
+static size_t mem_blocks_size = 0;
+static size_t mem_blocks_num = 0;
+#endif /* FREECIV_MEMSTATS */
+
 /**********************************************************************
  Do whatever we should do when malloc fails.
  At the moment this just prints a log message and calls exit(EXIT_FAILURE)
@@ -43,6 +73,285 @@ static void handle_alloc_failure(size_t size, const char *called_as,
   exit(EXIT_FAILURE);
 }
 
+#ifdef FREECIV_MEMSTATS
+/**************************************************************************
+  Return the tag name for a source file name: its last two components,
+  so that "../../server/maphand.c" becomes "server/maphand.c".
+**************************************************************************/
+static const char *mem_stats_tag_name(const char *file)
+{
+  const char *p;
+  int seps = 0;
+
+  for (p = file + strlen(file); p > file; p--) {
+    if ((p[-1] == '/' || p[-1] == '\\') && ++seps == 2) {
+      return p;
+    }
+  }
+
+  return file;
+}
+
+/**************************************************************************
+  Return the tag of allocations made in the given source file.
+**************************************************************************/
+static int mem_stats_tag(const char *file)
+{
+  size_t i = ((uintptr_t) file >> 3) & (MEM_STATS_NAME_CACHE - 1);
+  const char *name;
+  int tag;
+
+  while (mem_stats_names[i].file != NULL) {
+    if (mem_stats_names[i].file == file) {
+      return mem_stats_names[i].tag;
+    }
+    i = (i + 1) & (MEM_STATS_NAME_CACHE - 1);
+  }
+
+  name = mem_stats_tag_name(file);
+  for (tag = 0; tag < mem_stats_num_tags; tag++) {
+    if (0 == strcmp(mem_stats_tags[tag].tag, name)) {
+      break;
+    }
+  }
+  if (tag == mem_stats_num_tags) {
+    if (mem_stats_num_tags < MEM_STATS_MAX_TAGS - 1) {
+      mem_stats_tags[tag].tag = name;
+      mem_stats_num_tags++;
+    } else {
+      tag = MEM_STATS_MAX_TAGS - 1;
+    }
+  }
+
+  /* Keep the cache at most half full, so that lookups end. */
+  if (mem_stats_num_names < MEM_STATS_NAME_CACHE / 2) {
+    mem_stats_names[i].file = file;
+    mem_stats_names[i].tag = tag;
+    mem_stats_num_names++;
+  }
+
+  return tag;
+}
+
+/**************************************************************************
+  Return the home slot of a block in the table of live blocks.
+**************************************************************************/
+static inline size_t mem_block_hash(const void *ptr)
+{
+  uintptr_t h = (uintptr_t) ptr >> 4;
+
+  h ^= h >> 15;
+  h *= 2654435761u;
+  h ^= h >> 13;
+
+  return h & (mem_blocks_size - 1);
+}
+
+/**************************************************************************
+  Return the slot of the block at ptr, or the empty slot where it would
+  be inserted.
+**************************************************************************/
+static size_t mem_block_find(const void *ptr)
+{
+  size_t i = mem_block_hash(ptr);
+
+  while (mem_blocks[i].ptr != NULL && mem_blocks[i].ptr != ptr) {
+    i = (i + 1) & (mem_blocks_size - 1);
+  }
+
+  return i;
+}
+
+/**************************************************************************
+  Double the size of the table of live blocks.
+**************************************************************************/
+static void mem_blocks_grow(void)
+{
+  struct mem_block *old_blocks = mem_blocks;
+  size_t old_size = mem_blocks_size;
+  size_t i;
+
+  mem_blocks_size = MAX(2 * old_size, 1 << 16);
+  mem_blocks = calloc(mem_blocks_size, sizeof(*mem_blocks));
+  if (mem_blocks == NULL) {
+    handle_alloc_failure(mem_blocks_size * sizeof(*mem_blocks), "calloc",
+                         __FC_LINE__, __FILE__);
+  }
+
+  for (i = 0; i < old_size; i++) {
+    if (old_blocks[i].ptr != NULL) {
+      mem_blocks[mem_block_find(old_blocks[i].ptr)] = old_blocks[i];
+    }
+  }
+  (free)(old_blocks);
+}
+
+/**************************************************************************
+  Take the block in the given slot out of the counts, and empty the slot
+  unless it is about to be reused.
+**************************************************************************/
+static void mem_block_forget(size_t i, bool empty)
+{
+  struct mem_stats *ptag = mem_stats_tags + mem_blocks[i].tag;
+  size_t mask = mem_blocks_size - 1;
+  size_t j, home;
+
+  ptag->live_bytes -= mem_blocks[i].size;
+  ptag->live_blocks--;
+  mem_stats_total.live_bytes -= mem_blocks[i].size;
+  mem_stats_total.live_blocks--;
+
+  if (!empty) {
+    return;
+  }
+
+  /* Move back the following blocks that can't be found past the
+   * emptied slot any more. */
+  for (j = (i + 1) & mask; mem_blocks[j].ptr != NULL; j = (j + 1) & mask) {
+    home = mem_block_hash(mem_blocks[j].ptr);
+    if ((i < j) ? (home <= i || home > j) : (home <= i && home > j)) {
+      mem_blocks[i] = mem_blocks[j];
+      i = j;
+    }
+  }
+  mem_blocks[i].ptr = NULL;
+  mem_blocks_num--;
+}
+
+/**************************************************************************
+  Count a newly allocated block. The caller holds the mutex.
+**************************************************************************/
+static void mem_stats_add(const void *ptr, size_t size, const char *file)
+{
+  struct mem_stats *ptag;
+  size_t i;
+
+  if (2 * (mem_blocks_num + 1) > mem_blocks_size) {
+    mem_blocks_grow();
+  }
+
+  i = mem_block_find(ptr);
+  if (mem_blocks[i].ptr == ptr) {
+    /* Freed without going through fc_real_free(). */
+    mem_block_forget(i, FALSE);
+  } else {
+    mem_blocks_num++;
+  }
+
+  mem_blocks[i].ptr = ptr;
+  mem_blocks[i].size = size;
+  mem_blocks[i].tag = mem_stats_tag(file);
+
+  ptag = mem_stats_tags + mem_blocks[i].tag;
+  ptag->live_bytes += size;
+  ptag->peak_bytes = MAX(ptag->peak_bytes, ptag->live_bytes);
+  ptag->live_blocks++;
+  ptag->allocs++;
+  mem_stats_total.live_bytes += size;
+  mem_stats_total.peak_bytes = MAX(mem_stats_total.peak_bytes,
+                                   mem_stats_total.live_bytes);
+  mem_stats_total.live_blocks++;
+  mem_stats_total.allocs++;
+}
+
+/**************************************************************************
+  Stop counting a block. The caller holds the mutex.
+**************************************************************************/
+static void mem_stats_remove(const void *ptr)
+{
+  size_t i;
+
+  if (mem_blocks_num == 0) {
+    return;
+  }
+
+  i = mem_block_find(ptr);
+  if (mem_blocks[i].ptr == ptr) {
+    mem_block_forget(i, TRUE);
+  }
+}
+
+/**************************************************************************
+  Take the accounting mutex, initializing everything on the first call.
+  The first allocation is made before any other thread is started.
+**************************************************************************/
+static void mem_stats_lock(void)
+{
+  if (!mem_stats_initialized) {
+    fc_init_mutex(&mem_stats_mutex);
+    mem_stats_tags[MEM_STATS_MAX_TAGS - 1].tag = "other";
+    mem_stats_total.tag = "total";
+    mem_stats_initialized = TRUE;
+  }
+  fc_allocate_mutex(&mem_stats_mutex);
+}
+
+/**************************************************************************
+  Compare the live bytes of two tags, for sorting in decreasing order.
+**************************************************************************/
+static int mem_stats_cmp(const void *a, const void *b)
+{
+  const struct mem_stats *pa = a, *pb = b;
+
+  if (pa->live_bytes != pb->live_bytes) {
+    return pa->live_bytes < pb->live_bytes ? 1 : -1;
+  }
+
+  return pa->peak_bytes < pb->peak_bytes ? 1
+         : (pa->peak_bytes > pb->peak_bytes ? -1 : 0);
+}
+
+/**************************************************************************
+  Fill stats with the tags using the most memory, by live bytes, and
+  return their number. If total is not NULL, it is filled with the sums
+  over all tags; its peak is the highest total, not the sum of peaks.
+**************************************************************************/
+int mem_stats_get(struct mem_stats *stats, int max_stats,
+                  struct mem_stats *total)
+{
+  struct mem_stats tags[MEM_STATS_MAX_TAGS];
+  int num = 0;
+  int i;
+
+  mem_stats_lock();
+  for (i = 0; i < MEM_STATS_MAX_TAGS; i++) {
+    if (mem_stats_tags[i].allocs > 0) {
+      tags[num++] = mem_stats_tags[i];
+    }
+  }
+  if (total != NULL) {
+    *total = mem_stats_total;
+  }
+  fc_release_mutex(&mem_stats_mutex);
+
+  qsort(tags, num, sizeof(*tags), mem_stats_cmp);
+  num = MIN(num, max_stats);
+  memcpy(stats, tags, num * sizeof(*stats));
+
+  return num;
+}
+
+/**************************************************************************
+  Function used by the free macro, free() replacement.
+**************************************************************************/
+void fc_real_free(void *ptr)
+{
+  if (ptr == NULL) {
+    return;
+  }
+
+  if (mem_stats_initialized) {
+    /* Forget the block before freeing it, or another thread could be
+     * given the same address in between. */
+    fc_allocate_mutex(&mem_stats_mutex);
+    mem_stats_remove(ptr);
+    fc_release_mutex(&mem_stats_mutex);
+  }
+
+  (free)(ptr);
+}
+#endif /* FREECIV_MEMSTATS */
+
 #ifdef FREECIV_DEBUG
 /****************************************************************************
   Check the size for sanity.  The program will exit rather than allocate a
@@ -91,6 +400,12 @@ void *fc_real_malloc(size_t size,
     handle_alloc_failure(size, called_as, line, file);
   }
 
+#ifdef FREECIV_MEMSTATS
+  mem_stats_lock();
+  mem_stats_add(ptr, size, file);
+  fc_release_mutex(&mem_stats_mutex);
+#endif /* FREECIV_MEMSTATS */
+
   return ptr;
 }
 
@@ -111,10 +426,23 @@ void *fc_real_realloc(void *ptr, size_t size,
   sanity_check_size(size, called_as, line, file);
 #endif /* FREECIV_DEBUG */
 
+#ifdef FREECIV_MEMSTATS
+  /* Hold the mutex, so that no other thread is given the old address
+   * before the new block is counted. */
+  mem_stats_lock();
+  mem_stats_remove(ptr);
+#endif /* FREECIV_MEMSTATS */
+
   new_ptr = realloc(ptr, size);
   if (!new_ptr) {
     handle_alloc_failure(size, called_as, line, file);
   }
+
+#ifdef FREECIV_MEMSTATS
+  mem_stats_add(new_ptr, size, file);
+  fc_release_mutex(&mem_stats_mutex);
+#endif /* FREECIV_MEMSTATS */
+
   return new_ptr;
 }
 
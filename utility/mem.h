@@ -61,6 +61,38 @@ char *real_fc_strdup(const char *str,
                      const char *called_as, int line, const char *file)
                      fc__warn_unused_result;
 
+#ifdef FREECIV_MEMSTATS
+/* Memory accounting (configure --enable-memstats): every block allocated
+ * with the macros above is recorded under the source file that allocated
+ * it, until it is freed. Blocks freed without going through free() as
+ * redefined below (e.g. from C++ code) are only forgotten when their
+ * address is used again. Where a free function is passed as a pointer,
+ * pass fc_real_free, not free. */
+
+/* Max number of different tags. Files after that are counted together
+ * as "other". */
+#define MEM_STATS_MAX_TAGS 1024
+
+struct mem_stats {
+  const char *tag;              /* Source file, e.g. "common/map.c". */
+  size_t live_bytes;
+  size_t peak_bytes;
+  unsigned long live_blocks;
+  unsigned long allocs;         /* Allocations since the start. */
+};
+
+void fc_real_free(void *ptr);
+
+int mem_stats_get(struct mem_stats *stats, int max_stats,
+                  struct mem_stats *total);
+
+#ifndef __cplusplus
+#define free(ptr) fc_real_free(ptr)
+#endif
+#else  /* FREECIV_MEMSTATS */
+#define fc_real_free free
+#endif /* FREECIV_MEMSTATS */
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -0,0 +1,362 @@
+/***********************************************************************
+ Freeciv - Copyright (C) 1996 - A Kjeldberg, L Gregersen, P Unold
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2, or (at your option)
+   any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+***********************************************************************/
+
+/***********************************************************************
+  Performance zones.
+
+  Each thread keeps a stack of the zones it has begun. Ending a zone
+  pops it and appends a complete event (name, thread, start, duration)
+  to a common buffer, which perfzone_trace_turn() writes out once per
+  turn, together with a counter event holding the total time of each
+  zone name during the turn.
+
+  The output is a JSON array of trace events. The closing bracket is
+  only written by perfzone_trace_close(), but the viewers accept the
+  file without it, e.g. after a crash.
+***********************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include <fc_config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef HAVE_GETTIMEOFDAY
+#include <sys/time.h>
+#endif
+
+/* Define this to read the time from the CPU time stamp counter instead of
+ * the system clock. It is cheaper, but only right on CPUs with a constant
+ * rate counter, and only as precise as the calibration against the system
+ * clock done over each turn. */
+/* #define PERFZONE_RDTSC */
+
+#if defined(PERFZONE_RDTSC) && (defined(__i386__) || defined(__x86_64__))
+#include <x86intrin.h>
+#else
+#undef PERFZONE_RDTSC
+#endif
+
+/* utility */
+#include "fcthread.h"
+#include "log.h"
+#include "mem.h"
+#include "shared.h"
+#include "support.h"
+
+#include "perfzone.h"
+
+/* Deeper zones are counted but not recorded. */
+#define PERFZONE_MAX_DEPTH 32
+/* Max number of different zone names in a turn summary. */
+#define PERFZONE_MAX_SUMMARY 64
+
+struct perfzone_event {
+  const char *name;
+  int tid;
+  double start;                 /* In clock ticks. */
+  double duration;
+};
+
+struct perfzone_stack {
+  int tid;
+  int generation;
+  int depth;
+  struct {
+    const char *name;
+    double start;
+  } zones[PERFZONE_MAX_DEPTH];
+};
+
+bool perfzone_enabled = FALSE;
+
+static FILE *perfzone_file = NULL;
+/* Created by the first perfzone_trace_open() and never destroyed, as
+ * other threads may still be inside a zone when the trace is closed. */
+static fc_mutex perfzone_mutex;
+static bool perfzone_mutex_ready = FALSE;
+static struct perfzone_event *perfzone_events = NULL;
+static int perfzone_events_num = 0;
+static int perfzone_events_size = 0;
+static int perfzone_threads = 0;
+/* Increased on every open, so that stacks left over from an earlier
+ * trace are reset. */
+static int perfzone_generation = 0;
+
+/* Clock ticks at the beginning of the trace. */
+static double perfzone_origin;
+#ifdef PERFZONE_RDTSC
+/* System clock at the beginning of the trace, in microseconds. */
+static double perfzone_origin_usec;
+#endif
+
+#ifdef FREECIV_C11_THREAD_LOCAL
+static _Thread_local struct perfzone_stack perfzone_stack;
+#else
+/* Only one thread can record zones. */
+static struct perfzone_stack perfzone_stack;
+#endif
+
+/**************************************************************************
+  Return the system clock in microseconds.
+**************************************************************************/
+static double perfzone_clock_usec(void)
+{
+#if defined(CLOCK_MONOTONIC)
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+#elif defined(HAVE_GETTIMEOFDAY)
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec * 1e6 + tv.tv_usec;
+#else
+  return clock() * (1e6 / CLOCKS_PER_SEC);
+#endif
+}
+
+/**************************************************************************
+  Return the current time in clock ticks.
+**************************************************************************/
+static inline double perfzone_now(void)
+{
+#ifdef PERFZONE_RDTSC
+  return (double) __rdtsc();
+#else
+  return perfzone_clock_usec();
+#endif
+}
+
+/**************************************************************************
+  Return the number of microseconds per clock tick.
+**************************************************************************/
+static double perfzone_usec_per_tick(void)
+{
+#ifdef PERFZONE_RDTSC
+  double ticks = perfzone_now() - perfzone_origin;
+
+  if (ticks <= 0) {
+    return 0.0;
+  }
+
+  return (perfzone_clock_usec() - perfzone_origin_usec) / ticks;
+#else
+  return 1.0;
+#endif
+}
+
+/**************************************************************************
+  Start recording zones, writing them to the given file. Any previously
+  opened trace file is closed first.
+**************************************************************************/
+bool perfzone_trace_open(const char *filename)
+{
+  perfzone_trace_close();
+
+  perfzone_file = fc_fopen(filename, "w");
+  if (perfzone_file == NULL) {
+    log_error("Can't open trace file \"%s\".", filename);
+    return FALSE;
+  }
+  fprintf(perfzone_file, "[\n");
+
+  if (!perfzone_mutex_ready) {
+    fc_init_mutex(&perfzone_mutex);
+    perfzone_mutex_ready = TRUE;
+  }
+  fc_allocate_mutex(&perfzone_mutex);
+  perfzone_events_num = 0;
+  perfzone_threads = 0;
+  perfzone_generation++;
+  perfzone_origin = perfzone_now();
+#ifdef PERFZONE_RDTSC
+  perfzone_origin_usec = perfzone_clock_usec();
+#endif
+  fc_release_mutex(&perfzone_mutex);
+  perfzone_enabled = TRUE;
+
+  return TRUE;
+}
+
+/**************************************************************************
+  Write out the remaining zones and close the trace file.
+**************************************************************************/
+void perfzone_trace_close(void)
+{
+  if (perfzone_file == NULL) {
+    return;
+  }
+
+  perfzone_enabled = FALSE;
+  perfzone_trace_turn(-1);
+
+  /* Zones still ending on other threads see the file closed and are
+   * dropped. */
+  fc_allocate_mutex(&perfzone_mutex);
+  fprintf(perfzone_file,
+          "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,"
+          "\"args\":{\"name\":\"freeciv\"}}\n]\n");
+  fclose(perfzone_file);
+  perfzone_file = NULL;
+
+  FC_FREE(perfzone_events);
+  perfzone_events_num = 0;
+  perfzone_events_size = 0;
+  fc_release_mutex(&perfzone_mutex);
+}
+
+/**************************************************************************
+  Is a trace being recorded?
+**************************************************************************/
+bool perfzone_trace_is_open(void)
+{
+  return perfzone_file != NULL;
+}
+
+/**************************************************************************
+  Write the zones ended since the last call to the trace file, followed
+  by the total time of each zone name. Pass -1 for the turn if the zones
+  don't belong to a game turn.
+**************************************************************************/
+void perfzone_trace_turn(int turn)
+{
+  struct {
+    const char *name;
+    double usec;
+  } summary[PERFZONE_MAX_SUMMARY];
+  int num_summary = 0;
+  double scale, now;
+  int i, j;
+
+  if (perfzone_file == NULL) {
+    return;
+  }
+
+  fc_allocate_mutex(&perfzone_mutex);
+  scale = perfzone_usec_per_tick();
+  now = (perfzone_now() - perfzone_origin) * scale;
+
+  for (i = 0; i < perfzone_events_num; i++) {
+    const struct perfzone_event *pevent = perfzone_events + i;
+    double duration = pevent->duration * scale;
+
+    fprintf(perfzone_file,
+            "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,"
+            "\"ts\":%.3f,\"dur\":%.3f},\n",
+            pevent->name, pevent->tid,
+            (pevent->start - perfzone_origin) * scale, duration);
+
+    for (j = 0; j < num_summary; j++) {
+      if (0 == strcmp(summary[j].name, pevent->name)) {
+        break;
+      }
+    }
+    if (j < num_summary) {
+      summary[j].usec += duration;
+    } else if (num_summary < ARRAY_SIZE(summary)) {
+      summary[num_summary].name = pevent->name;
+      summary[num_summary].usec = duration;
+      num_summary++;
+    }
+  }
+
+  if (0 < num_summary) {
+    /* Shown as a stacked graph of the milliseconds per zone. */
+    fprintf(perfzone_file,
+            "{\"name\":\"turn zones (ms)\",\"ph\":\"C\",\"pid\":1,"
+            "\"ts\":%.3f,\"args\":{", now);
+    for (j = 0; j < num_summary; j++) {
+      fprintf(perfzone_file, "%s\"%s\":%.3f", j > 0 ? "," : "",
+              summary[j].name, summary[j].usec / 1e3);
+    }
+    fprintf(perfzone_file, "}},\n");
+  }
+  if (0 <= turn) {
+    fprintf(perfzone_file,
+            "{\"name\":\"turn %d\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,"
+            "\"tid\":1,\"ts\":%.3f},\n", turn, now);
+  }
+  fflush(perfzone_file);
+
+  perfzone_events_num = 0;
+  fc_release_mutex(&perfzone_mutex);
+}
+
+/**************************************************************************
+  Begin a zone on the current thread.
+**************************************************************************/
+void perfzone_begin_real(const char *name)
+{
+  struct perfzone_stack *pstack = &perfzone_stack;
+
+  if (pstack->generation != perfzone_generation) {
+    fc_allocate_mutex(&perfzone_mutex);
+    pstack->tid = ++perfzone_threads;
+    fc_release_mutex(&perfzone_mutex);
+    pstack->generation = perfzone_generation;
+    pstack->depth = 0;
+  }
+
+  if (pstack->depth < PERFZONE_MAX_DEPTH) {
+    pstack->zones[pstack->depth].name = name;
+    pstack->zones[pstack->depth].start = perfzone_now();
+  }
+  pstack->depth++;
+}
+
+/**************************************************************************
+  End the innermost zone of the current thread, which must have the
+  given name.
+**************************************************************************/
+void perfzone_end_real(const char *name)
+{
+  struct perfzone_stack *pstack = &perfzone_stack;
+  struct perfzone_event *pevent;
+  double end = perfzone_now();
+
+  if (pstack->generation != perfzone_generation || pstack->depth == 0) {
+    /* Begun before the trace was opened. */
+    return;
+  }
+
+  pstack->depth--;
+  if (pstack->depth >= PERFZONE_MAX_DEPTH) {
+    return;
+  }
+  fc_assert_ret_msg(0 == strcmp(pstack->zones[pstack->depth].name, name),
+                    "Ending zone \"%s\" inside \"%s\".",
+                    name, pstack->zones[pstack->depth].name);
+
+  fc_allocate_mutex(&perfzone_mutex);
+  if (perfzone_file == NULL) {
+    /* The trace was closed while the zone was running. */
+    fc_release_mutex(&perfzone_mutex);
+    return;
+  }
+  if (perfzone_events_num == perfzone_events_size) {
+    perfzone_events_size = MAX(2 * perfzone_events_size, 1024);
+    perfzone_events = fc_realloc(perfzone_events,
+                                 perfzone_events_size
+                                 * sizeof(*perfzone_events));
+  }
+  pevent = perfzone_events + perfzone_events_num++;
+  pevent->name = name;
+  pevent->tid = pstack->tid;
+  pevent->start = pstack->zones[pstack->depth].start;
+  pevent->duration = end - pevent->start;
+  fc_release_mutex(&perfzone_mutex);
+}
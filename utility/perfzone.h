@@ -0,0 +1,58 @@
+/***********************************************************************
+ Freeciv - Copyright (C) 1996 - A Kjeldberg, L Gregersen, P Unold
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2, or (at your option)
+   any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+***********************************************************************/
+#ifndef FC__PERFZONE_H
+#define FC__PERFZONE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include "support.h"            /* bool type */
+
+/* Performance zones: named, nested intervals of wall clock time, written
+ * per turn to a trace file in the Chrome trace event format, which can be
+ * loaded in chrome://tracing, Perfetto and similar viewers.
+ *
+ * Zones are only recorded while a trace file is open, so the macros below
+ * cost a flag check otherwise. Zone names must be string literals (or
+ * otherwise live until the trace file is written). Each zone must be ended
+ * on the thread that began it. */
+
+bool perfzone_trace_open(const char *filename);
+void perfzone_trace_close(void);
+bool perfzone_trace_is_open(void);
+void perfzone_trace_turn(int turn);
+
+void perfzone_begin_real(const char *name);
+void perfzone_end_real(const char *name);
+
+extern bool perfzone_enabled;
+
+#define PERF_ZONE_BEGIN(name)                                               \
+{                                                                           \
+  if (perfzone_enabled) {                                                   \
+    perfzone_begin_real(name);                                              \
+  }                                                                         \
+}
+#define PERF_ZONE_END(name)                                                 \
+{                                                                           \
+  if (perfzone_enabled) {                                                   \
+    perfzone_end_real(name);                                                \
+  }                                                                         \
+}
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif  /* FC__PERFZONE_H */
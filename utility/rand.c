@@ -29,12 +29,20 @@
    
    Original author for this code: Cedric Tefft <cedric@earthling.net>
    Modified to use rand_state struct by David Pfitzner <dwp@mso.anu.edu.au>
+
+   The global generator stays as it is, as savegames and replays of
+   existing games depend on its sequence. Code which needs numbers of
+   its own, e.g. to run in parallel with the rest of the game, uses the
+   independent xoshiro256** streams further below instead.
 *************************************************************************/
 
 #ifdef HAVE_CONFIG_H
 #include <fc_config.h>
 #endif
 
+#include <stdio.h>
+#include <string.h>
+
 /* utility */
 #include "log.h"
 #include "shared.h"
@@ -251,6 +259,275 @@ void test_random1(int n)
   fc_rand_set_state(saved_state);
 }
 
+/*************************************************************************
+  Return the next value of the splitmix64 sequence at *px, and advance
+  it. Only used to fill the initial state of the streams, as xoshiro
+  needs well mixed, nonzero state words.
+*************************************************************************/
+static uint64_t splitmix64(uint64_t *px)
+{
+  uint64_t z = (*px += 0x9e3779b97f4a7c15ULL);
+
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+
+  return z ^ (z >> 31);
+}
+
+/*************************************************************************
+  Rotate left.
+*************************************************************************/
+static inline uint64_t rotl64(uint64_t x, int k)
+{
+  return (x << k) | (x >> (64 - k));
+}
+
+/*************************************************************************
+  Return the next 64 bit value of the xoshiro256** generator by David
+  Blackman and Sebastiano Vigna, and advance the state.
+*************************************************************************/
+static inline uint64_t xoshiro256ss_next(uint64_t *s)
+{
+  const uint64_t result = rotl64(s[1] * 5, 7) * 9;
+  const uint64_t t = s[1] << 17;
+
+  s[2] ^= s[0];
+  s[3] ^= s[1];
+  s[1] ^= s[2];
+  s[0] ^= s[3];
+  s[2] ^= t;
+  s[3] = rotl64(s[3], 45);
+
+  return result;
+}
+
+/*************************************************************************
+  Initialize the stream from the seed (usually the game or map seed) and
+  the id of the stream. Streams with different seeds or ids start from
+  unrelated states of the 2^256 - 1 long xoshiro sequence.
+*************************************************************************/
+void fc_rand_stream_init(struct fc_rand_stream *pstream, RANDOM_TYPE seed,
+                         RANDOM_TYPE id)
+{
+  uint64_t x = ((uint64_t) seed << 32) | id;
+  int i;
+
+  /* Mix once more, so that neighbouring seeds and ids don't start a few
+   * steps apart on the splitmix sequence. */
+  x = splitmix64(&x);
+  for (i = 0; i < ARRAY_SIZE(pstream->s); i++) {
+    pstream->s[i] = splitmix64(&x);
+  }
+}
+
+/*************************************************************************
+  Advance the stream by 2^128 values, i.e. past everything that will
+  ever be drawn from it.
+*************************************************************************/
+void fc_rand_stream_jump(struct fc_rand_stream *pstream)
+{
+  static const uint64_t jump[] = {
+    0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL,
+    0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL
+  };
+  uint64_t s[4] = { 0, 0, 0, 0 };
+  int i, b;
+
+  for (i = 0; i < ARRAY_SIZE(jump); i++) {
+    for (b = 0; b < 64; b++) {
+      if (jump[i] & ((uint64_t) 1 << b)) {
+        s[0] ^= pstream->s[0];
+        s[1] ^= pstream->s[1];
+        s[2] ^= pstream->s[2];
+        s[3] ^= pstream->s[3];
+      }
+      (void) xoshiro256ss_next(pstream->s);
+    }
+  }
+
+  memcpy(pstream->s, s, sizeof(pstream->s));
+}
+
+/*************************************************************************
+  Split a new stream off the given one: the child is seeded through
+  splitmix64 from the next values of the parent, so it starts from a
+  state unrelated to the parent and to any other child, however the
+  splits are nested. The result depends only on the order of the splits
+  and draws, and the children can draw from their streams in any order,
+  or in parallel.
+*************************************************************************/
+void fc_rand_stream_split(struct fc_rand_stream *pstream,
+                          struct fc_rand_stream *pchild)
+{
+  uint64_t x = 0;
+  int i;
+
+  /* A plain copy plus a jump of the parent would not do: splitting the
+   * child in the same way would jump it to where the parent already is. */
+  for (i = 0; i < ARRAY_SIZE(pchild->s); i++) {
+    x ^= xoshiro256ss_next(pstream->s);
+    pchild->s[i] = splitmix64(&x);
+  }
+}
+
+/*************************************************************************
+  Returns a new random value from the stream, in the interval 0 to
+  (size-1) inclusive, like fc_rand() does from the global state.
+
+  The high 32 bits of the next value are scaled to the range with a
+  multiplication, rejecting the few values which would make the result
+  biased (Lemire's method), instead of the division of fc_rand().
+*************************************************************************/
+RANDOM_TYPE fc_rand_stream_debug(struct fc_rand_stream *pstream,
+                                 RANDOM_TYPE size, const char *called_as,
+                                 int line, const char *file)
+{
+  uint64_t m;
+  RANDOM_TYPE new_rand;
+
+  /* Even when the result is known, advance the stream so that it
+   * proceeds equally for all sizes. */
+  m = (xoshiro256ss_next(pstream->s) >> 32) * (uint64_t) size;
+
+  if (size > 1) {
+    if ((RANDOM_TYPE) m < size) {
+      RANDOM_TYPE threshold = (RANDOM_TYPE) -size % size;
+
+      while ((RANDOM_TYPE) m < threshold) {
+        m = (xoshiro256ss_next(pstream->s) >> 32) * (uint64_t) size;
+      }
+    }
+    new_rand = m >> 32;
+  } else {
+    new_rand = 0;
+  }
+
+  log_rand("%s(%lu) = %lu at %s:%d",
+           called_as, (unsigned long) size,
+           (unsigned long) new_rand, file, line);
+
+  return new_rand;
+}
+
+/*************************************************************************
+  Write the state of the stream to buf as eight 32 bit hex numbers, in
+  the style of the tables of the global state in savegames. bufsz should
+  be at least FC_RAND_STREAM_STR_LEN.
+*************************************************************************/
+void fc_rand_stream_state_str(const struct fc_rand_stream *pstream,
+                              char *buf, size_t bufsz)
+{
+  fc_snprintf(buf, bufsz, "%08x %08x %08x %08x %08x %08x %08x %08x",
+              (unsigned) (pstream->s[0] >> 32), (unsigned) pstream->s[0],
+              (unsigned) (pstream->s[1] >> 32), (unsigned) pstream->s[1],
+              (unsigned) (pstream->s[2] >> 32), (unsigned) pstream->s[2],
+              (unsigned) (pstream->s[3] >> 32), (unsigned) pstream->s[3]);
+}
+
+/*************************************************************************
+  Set the state of the stream from a string written by
+  fc_rand_stream_state_str(). Returns FALSE, leaving the stream as it
+  was, if the string isn't a valid state.
+*************************************************************************/
+bool fc_rand_stream_set_state_str(struct fc_rand_stream *pstream,
+                                  const char *str)
+{
+  unsigned int w[8];
+  uint64_t s[4];
+  int i;
+
+  if (8 != sscanf(str, "%8x %8x %8x %8x %8x %8x %8x %8x",
+                  &w[0], &w[1], &w[2], &w[3], &w[4], &w[5], &w[6], &w[7])) {
+    return FALSE;
+  }
+
+  for (i = 0; i < ARRAY_SIZE(s); i++) {
+    s[i] = ((uint64_t) w[2 * i] << 32) | w[2 * i + 1];
+  }
+  if (0 == (s[0] | s[1] | s[2] | s[3])) {
+    /* The one state xoshiro never leaves. */
+    return FALSE;
+  }
+
+  memcpy(pstream->s, s, sizeof(pstream->s));
+
+  return TRUE;
+}
+
+/*************************************************************************
+  Test the streams, using n numbers from each test. Reports results to
+  LOG_TEST:
+  - the test of test_random1(), where same and change should be about
+    the same size;
+  - a chi-square test of n values in 16 buckets, which should be about
+    15, and above 31 less than once in a hundred runs;
+  - how often two streams agree on a random bit, for each pair of a
+    stream, a child split off it, a grandchild split off the child, and
+    a second child split off the stream after the grandchild. All should
+    be about n / 2.
+  Uses its own streams, so doesn't change any game state.
+*************************************************************************/
+void test_random_stream(int n)
+{
+  struct fc_rand_stream streams[4];
+  int buckets[16];
+  int values[ARRAY_SIZE(streams)];
+  int agree[ARRAY_SIZE(streams)][ARRAY_SIZE(streams)];
+  int i, j, k, old_value = 0, new_value;
+  bool didchange, olddidchange = FALSE;
+  int behaviourchange = 0, behavioursame = 0;
+  double chi2 = 0.0, expected = (double) n / ARRAY_SIZE(buckets);
+
+  fc_rand_stream_init(&streams[0], n, 0);
+
+  for (i = 0; i < n + 2; i++) {
+    new_value = fc_rand_stream(&streams[0], 2);
+    if (i > 0) {
+      didchange = (new_value != old_value);
+      if (i > 1) {
+        if (didchange != olddidchange) {
+          behaviourchange++;
+        } else {
+          behavioursame++;
+        }
+      }
+      olddidchange = didchange;
+    }
+    old_value = new_value;
+  }
+
+  memset(buckets, 0, sizeof(buckets));
+  for (i = 0; i < n; i++) {
+    buckets[fc_rand_stream(&streams[0], ARRAY_SIZE(buckets))]++;
+  }
+  for (i = 0; i < ARRAY_SIZE(buckets); i++) {
+    chi2 += (buckets[i] - expected) * (buckets[i] - expected) / expected;
+  }
+
+  fc_rand_stream_split(&streams[0], &streams[1]);
+  fc_rand_stream_split(&streams[1], &streams[2]);
+  fc_rand_stream_split(&streams[0], &streams[3]);
+  memset(agree, 0, sizeof(agree));
+  for (i = 0; i < n; i++) {
+    for (j = 0; j < ARRAY_SIZE(streams); j++) {
+      values[j] = fc_rand_stream(&streams[j], 2);
+      for (k = 0; k < j; k++) {
+        if (values[j] == values[k]) {
+          agree[j][k]++;
+        }
+      }
+    }
+  }
+
+  log_test("test_random_stream(%d) same: %d, change: %d, "
+           "chi-square: %.1f, split agree: child %d, grandchild %d, "
+           "second child %d, child-grandchild %d, child-second child %d, "
+           "grandchild-second child %d",
+           n, behavioursame, behaviourchange, chi2,
+           agree[1][0], agree[2][0], agree[3][0], agree[2][1],
+           agree[3][1], agree[3][2]);
+}
+
 /*************************************************************************
   Local pseudo-random function for repeatedly reaching the same result,
   instead of fc_rand().  Primarily needed for tiles.
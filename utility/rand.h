@@ -47,6 +47,46 @@ void test_random1(int n);
 
 /*===*/
 
+/* Independent random streams (xoshiro256**). Unlike fc_rand(), which all
+ * of the game shares and whose sequence existing savegames and replays
+ * depend on, each stream has its own state, so that a subsystem, or an
+ * entity, drawing from it doesn't change the numbers seen by anyone else.
+ * Streams of different ids made from the same seed, and streams split
+ * off one another at any depth, start from unrelated states of the
+ * 2^256 - 1 long sequence, so in practice they never overlap.
+ *
+ * No game code draws from a stream yet, so savegames don't store any. A
+ * subsystem moved to a stream has to save its state, in the string form
+ * below, in the [random] section, next to the tables of fc_rand(). */
+struct fc_rand_stream {
+  uint64_t s[4];
+};
+
+/* Length of the string form of a stream state, including the '\0'. */
+#define FC_RAND_STREAM_STR_LEN (8 * 9)
+
+#define fc_rand_stream(_pstream, _size) \
+  fc_rand_stream_debug((_pstream), (_size), "fc_rand_stream", \
+                       __FC_LINE__, __FILE__)
+
+void fc_rand_stream_init(struct fc_rand_stream *pstream, RANDOM_TYPE seed,
+                         RANDOM_TYPE id);
+void fc_rand_stream_split(struct fc_rand_stream *pstream,
+                          struct fc_rand_stream *pchild);
+void fc_rand_stream_jump(struct fc_rand_stream *pstream);
+RANDOM_TYPE fc_rand_stream_debug(struct fc_rand_stream *pstream,
+                                 RANDOM_TYPE size, const char *called_as,
+                                 int line, const char *file);
+
+void fc_rand_stream_state_str(const struct fc_rand_stream *pstream,
+                              char *buf, size_t bufsz);
+bool fc_rand_stream_set_state_str(struct fc_rand_stream *pstream,
+                                  const char *str);
+
+void test_random_stream(int n);
+
+/*===*/
+
 #define fc_randomly(_seed, _size) \
   fc_randomly_debug((_seed), (_size), "fc_randomly", __FC_LINE__, __FILE__)
 
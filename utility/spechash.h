@@ -51,6 +51,8 @@
  *     pointer.
  *   SPECHASH_UDATA_TO_IDATA - A function or macro to convert a pointer
  *     to data.
+ *   SPECHASH_FLAT - Create flat (open addressing) tables, without an
+ *     allocation per entry. See genhash_new_flat_full().
  * At the end of this file, these (and other defines) are undef-ed.
  *
  * Assuming SPECHASH_TAG were 'foo', SPECHASH_IKEY_TYPE were 'key_t', and
@@ -360,6 +362,15 @@ SPECHASH_FOO(_hash_new_full) (SPECHASH_FOO(_hash_key_val_fn_t) key_val_func,
                               SPECHASH_FOO(_hash_data_free_fn_t)
                               data_free_func)
 {
+#ifdef SPECHASH_FLAT
+  return ((SPECHASH_HASH *)
+          genhash_new_flat_full((genhash_val_fn_t) key_val_func,
+                                (genhash_comp_fn_t) key_comp_func,
+                                (genhash_copy_fn_t) key_copy_func,
+                                (genhash_free_fn_t) key_free_func,
+                                (genhash_copy_fn_t) data_copy_func,
+                                (genhash_free_fn_t) data_free_func, 0));
+#else
   return ((SPECHASH_HASH *)
           genhash_new_full((genhash_val_fn_t) key_val_func,
                            (genhash_comp_fn_t) key_comp_func,
@@ -367,6 +378,7 @@ SPECHASH_FOO(_hash_new_full) (SPECHASH_FOO(_hash_key_val_fn_t) key_val_func,
                            (genhash_free_fn_t) key_free_func,
                            (genhash_copy_fn_t) data_copy_func,
                            (genhash_free_fn_t) data_free_func));
+#endif /* SPECHASH_FLAT */
 }
 
 /****************************************************************************
@@ -401,6 +413,16 @@ SPECHASH_FOO(_hash_new_nentries_full) (SPECHASH_FOO(_hash_key_val_fn_t)
                                        SPECHASH_FOO(_hash_data_free_fn_t)
                                        data_free_func, size_t nentries)
 {
+#ifdef SPECHASH_FLAT
+  return ((SPECHASH_HASH *)
+          genhash_new_flat_full((genhash_val_fn_t) key_val_func,
+                                (genhash_comp_fn_t) key_comp_func,
+                                (genhash_copy_fn_t) key_copy_func,
+                                (genhash_free_fn_t) key_free_func,
+                                (genhash_copy_fn_t) data_copy_func,
+                                (genhash_free_fn_t) data_free_func,
+                                nentries));
+#else
   return ((SPECHASH_HASH *)
           genhash_new_nentries_full((genhash_val_fn_t) key_val_func,
                                     (genhash_comp_fn_t) key_comp_func,
@@ -409,6 +431,7 @@ SPECHASH_FOO(_hash_new_nentries_full) (SPECHASH_FOO(_hash_key_val_fn_t)
                                     (genhash_copy_fn_t) data_copy_func,
                                     (genhash_free_fn_t) data_free_func,
                                     nentries));
+#endif /* SPECHASH_FLAT */
 }
 
 /****************************************************************************
@@ -657,6 +680,7 @@ SPECHASH_FOO(_hash_value_iter_init) (SPECHASH_ITER *iter,
 #undef SPECHASH_IKEY_TO_UKEY
 #undef SPECHASH_UDATA_TO_IDATA
 #undef SPECHASH_IDATA_TO_UDATA
+#undef SPECHASH_FLAT
 #undef SPECHASH_PASTE_
 #undef SPECHASH_PASTE
 #undef SPECHASH_HASH
@@ -23,6 +23,8 @@
  *   SPECLIST_TAG - this tag will be used to form names for functions etc.
  * You may also define:
  *   SPECLIST_TYPE - the typed genlist will contain pointers to this type;
+ *   SPECLIST_MUTEXED - the lists are shared between threads and get a
+ *                      mutex (only then the *_mutex() functions exist);
  * If SPECLIST_TYPE is not defined, then 'struct SPECLIST_TAG' is used.
  * At the end of this file, these (and other defines) are undef-ed.
  *
@@ -83,8 +85,8 @@
  *       int (*compar) (const foo_t *const *, const foo_t *const *));
  *    void foo_list_shuffle(struct foo_list *plist);
  *    void foo_list_reverse(struct foo_list *plist);
- *    void foo_list_allocate_mutex(struct foo_list *plist);
- *    void foo_list_release_mutex(struct foo_list *plist);
+ *    void foo_list_allocate_mutex(struct foo_list *plist);  (mutexed only)
+ *    void foo_list_release_mutex(struct foo_list *plist);   (mutexed only)
  *    foo_t *foo_list_link_data(const struct foo_list_link *plink);
  *    struct foo_list_link *
  *        foo_list_link_prev(const struct foo_list_link *plink);
@@ -167,7 +169,11 @@ fc__warn_unused_result;
 
 static inline SPECLIST_LIST *SPECLIST_FOO(_list_new) (void)
 {
+#ifdef SPECLIST_MUTEXED
+  return (SPECLIST_LIST *) genlist_new_mutexed(NULL);
+#else
   return (SPECLIST_LIST *) genlist_new();
+#endif /* SPECLIST_MUTEXED */
 }
 
 /****************************************************************************
@@ -180,8 +186,13 @@ fc__warn_unused_result;
 static inline SPECLIST_LIST *
 SPECLIST_FOO(_list_new_full) (SPECLIST_FOO(_list_free_fn_t) free_data_func)
 {
+#ifdef SPECLIST_MUTEXED
+  return ((SPECLIST_LIST *)
+          genlist_new_mutexed((genlist_free_fn_t) free_data_func));
+#else
   return ((SPECLIST_LIST *)
           genlist_new_full((genlist_free_fn_t) free_data_func));
+#endif /* SPECLIST_MUTEXED */
 }
 
 /****************************************************************************
@@ -490,6 +501,7 @@ static inline void SPECLIST_FOO(_list_reverse) (SPECLIST_LIST *tthis)
   genlist_reverse((struct genlist *) tthis);
 }
 
+#ifdef SPECLIST_MUTEXED
 /****************************************************************************
   Allocate speclist mutex
 ****************************************************************************/
@@ -505,6 +517,7 @@ static inline void SPECLIST_FOO(_list_release_mutex) (SPECLIST_LIST *tthis)
 {
   genlist_release_mutex((struct genlist *) tthis);
 }
+#endif /* SPECLIST_MUTEXED */
 
 /****************************************************************************
   Return the data of the link.
@@ -546,6 +559,7 @@ SPECLIST_FOO(_list_link_next) (const SPECLIST_LINK *plink)
 
 #undef SPECLIST_TAG
 #undef SPECLIST_TYPE
+#undef SPECLIST_MUTEXED
 #undef SPECLIST_PASTE_
 #undef SPECLIST_PASTE
 #undef SPECLIST_LIST
@@ -20,6 +20,9 @@
      time_t time() for user-time
   If we have HAVE_GETTIMEOFDAY we use gettimeofday() for user-time
   to get (usually) better resolution than time().
+  Per-thread CPU time uses clock_gettime(CLOCK_THREAD_CPUTIME_ID) where
+  available, and falls back to clock(), i.e. the CPU time of the whole
+  process, elsewhere.
 
   As well as measuring single time intervals, these functions
   support accumulating the time from multiple separate intervals.
@@ -92,6 +95,9 @@ struct timer {
   /* this is start of current timing, if state == TIMER_STARTED: */
   union {
     clock_t c;
+#ifdef CLOCK_THREAD_CPUTIME_ID
+    struct timespec ts;
+#endif
 #ifdef HAVE_GETTIMEOFDAY
     struct timeval tv;
 #elif HAVE_FTIME
@@ -117,6 +123,23 @@ static void report_clock_failed(struct timer *t)
   t->use = TIMER_IGNORE;
 }
 
+#ifdef CLOCK_THREAD_CPUTIME_ID
+/********************************************************************** 
+  Report if clock_gettime() returns -1, but only the first time.
+  Ignore this timer from now on.
+***********************************************************************/
+static void report_thread_clock_failed(struct timer *t)
+{
+  static bool first = TRUE;
+
+  if (first) {
+    log_test("clock_gettime() returned -1, ignoring timer");
+    first = FALSE;
+  }
+  t->use = TIMER_IGNORE;
+}
+#endif /* CLOCK_THREAD_CPUTIME_ID */
+
 #ifdef HAVE_GETTIMEOFDAY
 /********************************************************************** 
   Report if gettimeofday() returns -1, but only the first time.
@@ -179,6 +202,11 @@ struct timer *timer_renew(struct timer *t, enum timer_timetype type,
   if (!t) {
     t = (struct timer *)fc_malloc(sizeof(struct timer));
   }
+#ifndef CLOCK_THREAD_CPUTIME_ID
+  if (type == TIMER_THREAD_CPU) {
+    type = TIMER_CPU;
+  }
+#endif
   t->type = type;
   t->use = use;
   timer_clear(t);
@@ -232,7 +260,14 @@ void timer_start(struct timer *t)
     log_error("tried to start already started timer");
     return;
   }
-  if (t->type == TIMER_CPU) {
+  if (t->type == TIMER_THREAD_CPU) {
+#ifdef CLOCK_THREAD_CPUTIME_ID
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t->start.ts) == -1) {
+      report_thread_clock_failed(t);
+      return;
+    }
+#endif
+  } else if (t->type == TIMER_CPU) {
     t->start.c = clock();
     if (t->start.c == (clock_t) -1) {
       report_clock_failed(t);
@@ -275,7 +310,19 @@ void timer_stop(struct timer *t)
     log_error("tried to stop already stopped timer");
     return;
   }
-  if (t->type == TIMER_CPU) {
+  if (t->type == TIMER_THREAD_CPU) {
+#ifdef CLOCK_THREAD_CPUTIME_ID
+    struct timespec now;
+
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now) == -1) {
+      report_thread_clock_failed(t);
+      return;
+    }
+    t->sec += (now.tv_sec - t->start.ts.tv_sec)
+              + (now.tv_nsec - t->start.ts.tv_nsec) / 1e9;
+    t->start.ts = now;
+#endif
+  } else if (t->type == TIMER_CPU) {
     clock_t now = clock();
     if (now == (clock_t) -1) {
       report_clock_failed(t);
@@ -38,7 +38,9 @@ extern "C" {
 
 enum timer_timetype {
   TIMER_CPU,			/* time spent by the CPU */
-  TIMER_USER			/* time as seen by the user ("wall clock") */
+  TIMER_USER,			/* time as seen by the user ("wall clock") */
+  TIMER_THREAD_CPU		/* time spent by the CPU on the calling thread;
+				   start and stop it on the same thread */
 };
 
 enum timer_use {